@@ -0,0 +1,299 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        args.c                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "options.h"
+#include "outbuf.h"
+#include "walk.h"
+#include "args.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/* States of an argument */
+#define ARGS_PENDING 0  /* Nobody is listing it yet */
+#define ARGS_CLAIMED 1  /* Being listed */
+#define ARGS_DONE 2     /* Listed by a thread, waiting to be printed */
+
+/**
+ * @brief One directory given on the command line.
+ */
+typedef struct
+{
+    char *dir;
+    OutBuf_t out;       /* Its listing, when a thread made it */
+    atomic_int state;   /* ARGS_PENDING, ARGS_CLAIMED or ARGS_DONE */
+} ArgSlot_t;
+
+/**
+ * @brief State shared by the printer and the listing threads.
+ */
+typedef struct
+{
+    const Options_t *options;       /* Options of the listings */
+    ArgSlot_t *slots;
+    int count;
+    int metadata_jobs;              /* Metadata threads per argument (0: automatic) */
+
+    pthread_mutex_t lock;           /* Protects the fields below and the DONE transition */
+    pthread_cond_t done_cond;       /* Signaled when an argument becomes DONE */
+    pthread_cond_t space_cond;      /* Signaled when a buffered listing is printed */
+    int next;                       /* Next argument for the threads to take */
+    int printed;                    /* Number of arguments printed */
+    size_t buffered_bytes;          /* Memory held by the DONE listings */
+    int finished;
+} ArgLister_t;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+void Args_ListOne(const Options_t *options, char *dir)
+{
+    /* -d shows the directory itself => nothing to descend into */
+    if (options->flags[RECURSIVE_OPTION_R] && !options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        Walk_Recursive(options, dir);
+    }
+    else
+    {
+        do_ls(options, dir);
+    }
+}
+
+/**
+ * @brief Lists one argument with its header and trailing blank line (records have neither).
+ *
+ * A listing made straight to the output may be a recursive one (-R is only listed serially).
+ *
+ * @param options The options of the listing.
+ * @param out The buffer receiving the listing.
+ * @param dir The directory path.
+ * @param jobs Metadata threads for the listing (0: automatic).
+ */
+static void ListFramed(const Options_t *options, OutBuf_t *out, char *dir, int jobs)
+{
+    if (options->output_format == OUTPUT_FORMAT_TEXT)
+    {
+        OutBuf_PutLiteral(out, "Directory listing of ");
+        OutBuf_Puts(out, dir);
+        OutBuf_PutLiteral(out, ":\n");
+    }
+
+    if (out == &Output && options->flags[RECURSIVE_OPTION_R] && !options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        Walk_Recursive(options, dir);
+    }
+    else
+    {
+        do_ls_into(options, out, dir, jobs);
+    }
+
+    if (options->output_format == OUTPUT_FORMAT_TEXT)
+    {
+        OutBuf_Putc(out, '\n');
+    }
+}
+
+/**
+ * @brief Body of a listing thread: lists the arguments in order, ahead of the printer.
+ */
+static void *ArgWorker(void *arg)
+{
+    ArgLister_t *lister = arg;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&lister->lock);
+
+        /* Do not run too far ahead of the printer */
+        while (!lister->finished && lister->next < lister->count &&
+               (lister->next >= lister->printed + ARGS_MAX_IN_FLIGHT || lister->buffered_bytes >= ARGS_MAX_BUFFERED_BYTES))
+        {
+            pthread_cond_wait(&lister->space_cond, &lister->lock);
+        }
+
+        if (lister->finished || lister->next >= lister->count)
+        {
+            pthread_mutex_unlock(&lister->lock);
+            break;
+        }
+
+        ArgSlot_t *slot = &lister->slots[lister->next++];
+        pthread_mutex_unlock(&lister->lock);
+
+        /* The printer may have reached the argument and listed it itself */
+        int expected = ARGS_PENDING;
+        if (atomic_compare_exchange_strong(&slot->state, &expected, ARGS_CLAIMED))
+        {
+            ListFramed(lister->options, &slot->out, slot->dir, lister->metadata_jobs);
+
+            pthread_mutex_lock(&lister->lock);
+            atomic_store(&slot->state, ARGS_DONE);
+            lister->buffered_bytes += slot->out.capacity;
+            pthread_cond_broadcast(&lister->done_cond);
+            pthread_mutex_unlock(&lister->lock);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Prints an argument's listing, listing the directory first if nobody started it.
+ */
+static void PrintSlot(ArgLister_t *lister, ArgSlot_t *slot)
+{
+    int expected = ARGS_PENDING;
+
+    if (atomic_compare_exchange_strong(&slot->state, &expected, ARGS_CLAIMED))
+    {
+        /* Straight to the output => streamed listings stay streamed */
+        ListFramed(lister->options, &Output, slot->dir, lister->metadata_jobs);
+        return;
+    }
+
+    pthread_mutex_lock(&lister->lock);
+    while (atomic_load(&slot->state) != ARGS_DONE)
+    {
+        pthread_cond_wait(&lister->done_cond, &lister->lock);
+    }
+    pthread_mutex_unlock(&lister->lock);
+
+    if (slot->out.len > 0)
+    {
+        OutBuf_Write(&Output, slot->out.data, slot->out.len);
+    }
+
+    pthread_mutex_lock(&lister->lock);
+    lister->buffered_bytes -= slot->out.capacity;
+    pthread_mutex_unlock(&lister->lock);
+
+    OutBuf_Free(&slot->out);
+}
+
+/**
+ * @brief Chooses the number of listing threads.
+ */
+static int JobCount(const Options_t *options, int count)
+{
+    long jobs;
+
+    if (options->jobs > 0)
+    {
+        /* The printer lists directories too */
+        jobs = options->jobs - 1;
+    }
+    else
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = ((cpus > 0) ? cpus : 1) * ARGS_AUTO_JOBS_PER_CPU;
+    }
+
+    /* The printer takes the first argument => at most one thread per other argument */
+    if (jobs > count - 1)
+        jobs = count - 1;
+    if (jobs > ARGS_MAX_JOBS)
+        jobs = ARGS_MAX_JOBS;
+
+    return (int)jobs;
+}
+
+void Args_ListAll(const Options_t *options, char *dirs[], int count)
+{
+    int jobs = JobCount(options, count);
+
+    /* -R parallelizes inside each tree; a single thread has nothing to overlap */
+    if (jobs < 1 || (options->flags[RECURSIVE_OPTION_R] && !options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d]))
+    {
+        for (int i = 0; i < count; i++)
+        {
+            ListFramed(options, &Output, dirs[i], options->jobs);
+        }
+        return;
+    }
+
+    ArgLister_t lister;
+    pthread_t threads[ARGS_MAX_JOBS];
+    int started[ARGS_MAX_JOBS];
+
+    lister.slots = malloc(count * sizeof(ArgSlot_t));
+    if (lister.slots == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        lister.slots[i].dir = dirs[i];
+        OutBuf_Init(&lister.slots[i].out, -1, 0);
+        atomic_init(&lister.slots[i].state, ARGS_PENDING);
+    }
+
+    lister.options = options;
+    lister.count = count;
+    lister.next = 1;    /* The first argument is the printer's */
+    lister.printed = 0;
+    lister.buffered_bytes = 0;
+    lister.finished = 0;
+    pthread_mutex_init(&lister.lock, NULL);
+    pthread_cond_init(&lister.done_cond, NULL);
+    pthread_cond_init(&lister.space_cond, NULL);
+
+    /* The arguments are the parallel layer: the metadata of a directory is gathered by the
+       thread listing it, with extra threads only for huge directories (automatic rule); an
+       explicit --jobs is spent on the listing threads */
+    lister.metadata_jobs = (options->jobs > 0) ? 1 : 0;
+
+    for (int i = 0; i < jobs; i++)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, ArgWorker, &lister) == 0);
+    }
+
+    /* Reorder stage: print in argument order */
+    for (int i = 0; i < count; i++)
+    {
+        PrintSlot(&lister, &lister.slots[i]);
+
+        pthread_mutex_lock(&lister.lock);
+        lister.printed = i + 1;
+        pthread_cond_broadcast(&lister.space_cond);
+        pthread_mutex_unlock(&lister.lock);
+    }
+
+    pthread_mutex_lock(&lister.lock);
+    lister.finished = 1;
+    pthread_cond_broadcast(&lister.space_cond);
+    pthread_mutex_unlock(&lister.lock);
+
+    for (int i = 0; i < jobs; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        OutBuf_Free(&lister.slots[i].out);
+    }
+
+    pthread_cond_destroy(&lister.space_cond);
+    pthread_cond_destroy(&lister.done_cond);
+    pthread_mutex_destroy(&lister.lock);
+    free(lister.slots);
+}
@@ -0,0 +1,57 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        args.h                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _ARGS_H_
+#define _ARGS_H_
+
+#include "options.h"
+
+/* Upper bounds of the directories listed ahead of the one being printed; a thread reaching
+   one of them waits until the printer catches up */
+#define ARGS_MAX_IN_FLIGHT 64
+#define ARGS_MAX_BUFFERED_BYTES (64 * 1024 * 1024)
+
+/* With an automatic job count, this many threads are started per online CPU (listing is
+   latency bound, on network file systems especially) */
+#define ARGS_AUTO_JOBS_PER_CPU 4
+
+/* Hard upper bound of the number of threads */
+#define ARGS_MAX_JOBS 64
+
+/**
+ * @brief Lists the directories given on the command line, each with its header in text format.
+ *
+ * The output is the same as listing them one after another. Without -R, the directories are
+ * read, stat'ed and formatted by several threads, each one into its own memory buffer; the
+ * calling thread prints the buffers in argument order, and lists a directory itself (straight
+ * to the output) when no thread has started it yet, so it never waits for work that is still
+ * queued. The directories listed ahead and the memory they hold are bounded
+ * (ARGS_MAX_IN_FLIGHT, ARGS_MAX_BUFFERED_BYTES). With -R, each tree is walked in parallel by
+ * Walk_Recursive instead, one argument after another.
+ *
+ * The number of threads is --jobs when given (`--jobs=1` lists serially), otherwise
+ * ARGS_AUTO_JOBS_PER_CPU per online CPU, and never more than the number of directories.
+ *
+ * @param options The options of the listing.
+ * @param dirs The directories.
+ * @param count Number of directories.
+ */
+void Args_ListAll(const Options_t *options, char *dirs[], int count);
+
+/**
+ * @brief Lists one directory given on the command line, recursively with -R.
+ *
+ * @param options The options of the listing.
+ * @param dir The directory; its header must already be printed.
+ */
+void Args_ListOne(const Options_t *options, char *dir);
+
+#endif
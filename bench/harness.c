@@ -0,0 +1,482 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        harness.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Runs myls (and GNU ls, when available) with a set of option combinations on a fixture and
+ * reports wall time, peak RSS, system call count and output throughput.
+ *
+ * usage: bench/harness [-r runs] [-m myls] [-g ls] [-c "opts"]... DIR
+ *
+ *   -r N      timed runs per combination; the median is reported (default: 5)
+ *   -m PATH   myls binary (default: ./myls)
+ *   -g PATH   GNU ls binary (default: ls from PATH; skipped if it is not GNU ls)
+ *   -c OPTS   option combination to run, e.g. -c "-lt" (repeatable; default: a built-in set)
+ *
+ * Every combination is run once untimed (warm-up; a cold-cache run when the page cache can be
+ * dropped, i.e. /proc/sys/vm/drop_caches is writable), then `runs` times. The output goes
+ * through a pipe read by the harness, which counts the bytes. System calls are counted in one
+ * extra run under ptrace (all threads included); the column shows "-" when ptrace is not
+ * permitted. GNU ls gets --color=always so that both programs do the same work (myls always
+ * colors).
+ */
+
+/******************************            INCLUDES           ***********************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/ptrace.h>
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Measurements of one program with one option combination.
+ */
+typedef struct
+{
+    double cold_ms;         /* First run after dropping the caches (< 0 => not measured) */
+    double warm_ms;         /* Median of the timed runs */
+    long peak_rss_kib;      /* Largest peak RSS of the timed runs */
+    long long syscalls;     /* System calls of one traced run (< 0 => not measured) */
+    long long out_bytes;    /* Bytes written to stdout by one run */
+} Result_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* Combinations measured when no -c is given */
+static const char *const DefaultCombinations[] =
+{
+    "-1", "-l", "-lt", "-lS", "-la", "-i", "-f", "-1U", "-lU", "-R", "-lR",
+};
+
+#define DEFAULT_COMBINATION_COUNT (sizeof(DefaultCombinations) / sizeof(DefaultCombinations[0]))
+#define MAX_COMBINATIONS 64
+#define MAX_ARGS 32
+#define MAX_RUNS 101
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Returns a monotonic time in milliseconds.
+ */
+static double NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Builds the argument vector: program, extra option, combination words, directory.
+ *
+ * @return Number of arguments (argv is NULL-terminated).
+ */
+static int BuildArgs(char *argv[], char *words, const char *program, const char *extra,
+                     const char *combination, const char *dir)
+{
+    int argc = 0;
+
+    argv[argc++] = (char *)program;
+    if (extra != NULL)
+    {
+        argv[argc++] = (char *)extra;
+    }
+
+    strncpy(words, combination, 255);
+    words[255] = '\0';
+    for (char *word = strtok(words, " "); word != NULL && argc < MAX_ARGS - 2; word = strtok(NULL, " "))
+    {
+        argv[argc++] = word;
+    }
+
+    argv[argc++] = (char *)dir;
+    argv[argc] = NULL;
+    return argc;
+}
+
+/**
+ * @brief Drops the page, dentry and inode caches.
+ *
+ * @return 0 on success, -1 if not permitted.
+ */
+static int DropCaches(void)
+{
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    sync();
+    int status = (write(fd, "3", 1) == 1) ? 0 : -1;
+    close(fd);
+    return status;
+}
+
+/**
+ * @brief Runs a program once with its output read through a pipe.
+ *
+ * @param argv The argument vector.
+ * @param out_bytes Receives the number of bytes written to stdout.
+ * @param peak_rss_kib Receives the peak RSS of the program.
+ *
+ * @return The wall time in milliseconds, or -1 if the program could not be run.
+ */
+static double RunOnce(char *const argv[], long long *out_bytes, long *peak_rss_kib)
+{
+    static char buffer[1 << 16];
+    int pipe_fds[2];
+    int status;
+    struct rusage usage;
+
+    if (pipe(pipe_fds) < 0)
+    {
+        perror("pipe");
+        return -1;
+    }
+
+    double start = NowMs();
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        int null_fd = open("/dev/null", O_WRONLY);
+
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    close(pipe_fds[1]);
+
+    long long total = 0;
+    ssize_t len;
+    while ((len = read(pipe_fds[0], buffer, sizeof(buffer))) != 0)
+    {
+        if (len < 0 && errno != EINTR)
+        {
+            break;
+        }
+        total += (len > 0) ? len : 0;
+    }
+    close(pipe_fds[0]);
+
+    if (wait4(pid, &status, 0, &usage) < 0)
+    {
+        perror("wait4");
+        return -1;
+    }
+
+    double elapsed = NowMs() - start;
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        return -1;
+    }
+
+    *out_bytes = total;
+    *peak_rss_kib = usage.ru_maxrss;
+    return elapsed;
+}
+
+/**
+ * @brief Counts the system calls of one run with ptrace, following every thread and child.
+ *
+ * @return The number of system calls, or -1 if tracing is not permitted.
+ */
+static long long CountSyscalls(char *const argv[])
+{
+    int status;
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        return -1;
+    }
+
+    if (pid == 0)
+    {
+        int null_fd = open("/dev/null", O_WRONLY);
+
+        /* Output to /dev/null: the tracer does not drain a pipe */
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+
+        if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
+        {
+            _exit(126);
+        }
+
+        raise(SIGSTOP);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+    {
+        /* PTRACE_TRACEME failed => the child exited */
+        return -1;
+    }
+
+    ptrace(PTRACE_SETOPTIONS, pid, NULL,
+           (void *)(long)(PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_TRACEFORK |
+                          PTRACE_O_TRACEVFORK | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL));
+    ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+
+    long long entries = 0;
+    long long stops = 0;
+    int has_info = 1;
+    pid_t tid;
+
+    while ((tid = waitpid(-1, &status, __WALL)) > 0)
+    {
+        if (!WIFSTOPPED(status))
+        {
+            continue;
+        }
+
+        int signal = WSTOPSIG(status);
+        int deliver = 0;
+
+        if (signal == (SIGTRAP | 0x80))
+        {
+            struct ptrace_syscall_info info;
+
+            stops++;
+            if (has_info && ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void *)sizeof(info), &info) > 0)
+            {
+                entries += (info.op == PTRACE_SYSCALL_INFO_ENTRY);
+            }
+            else
+            {
+                has_info = 0;
+            }
+        }
+
+        /* Ptrace events (clone, exec...) and the initial stops of new threads are swallowed;
+           any other signal is passed on */
+        else if ((status >> 16) == 0 && signal != SIGTRAP && signal != SIGSTOP)
+        {
+            deliver = signal;
+        }
+
+        ptrace(PTRACE_SYSCALL, tid, NULL, (void *)(long)deliver);
+    }
+
+    /* Without PTRACE_GET_SYSCALL_INFO: every call stops on entry and on exit */
+    return has_info ? entries : stops / 2;
+}
+
+/**
+ * @brief Compares two doubles for qsort.
+ */
+static int CompareDouble(const void *p1, const void *p2)
+{
+    double d1 = *(const double *)p1;
+    double d2 = *(const double *)p2;
+
+    return (d1 > d2) - (d1 < d2);
+}
+
+/**
+ * @brief Measures one program with one option combination.
+ *
+ * @return 0 on success, -1 if the program failed to run.
+ */
+static int Measure(const char *program, const char *extra, const char *combination, const char *dir,
+                   int runs, Result_t *result)
+{
+    char *argv[MAX_ARGS];
+    char words[256];
+    double times[MAX_RUNS];
+    long rss;
+
+    BuildArgs(argv, words, program, extra, combination, dir);
+
+    /* Warm-up run, cold when the caches can be dropped */
+    int cold = (DropCaches() == 0);
+    double elapsed = RunOnce(argv, &result->out_bytes, &rss);
+    if (elapsed < 0)
+    {
+        return -1;
+    }
+    result->cold_ms = cold ? elapsed : -1;
+
+    result->peak_rss_kib = 0;
+    for (int i = 0; i < runs; i++)
+    {
+        times[i] = RunOnce(argv, &result->out_bytes, &rss);
+        if (times[i] < 0)
+        {
+            return -1;
+        }
+
+        if (rss > result->peak_rss_kib)
+        {
+            result->peak_rss_kib = rss;
+        }
+    }
+
+    qsort(times, runs, sizeof(double), CompareDouble);
+    result->warm_ms = times[runs / 2];
+
+    result->syscalls = CountSyscalls(argv);
+    return 0;
+}
+
+/**
+ * @brief Tells whether a program is GNU ls.
+ */
+static int IsGnuLs(const char *program)
+{
+    char command[4096];
+    char line[256] = "";
+
+    snprintf(command, sizeof(command), "'%s' --version 2>/dev/null", program);
+    FILE *pipe = popen(command, "r");
+    if (pipe == NULL)
+    {
+        return 0;
+    }
+
+    if (fgets(line, sizeof(line), pipe) == NULL)
+    {
+        line[0] = '\0';
+    }
+    pclose(pipe);
+
+    return strstr(line, "GNU coreutils") != NULL;
+}
+
+/**
+ * @brief Prints one result row.
+ */
+static void PrintRow(const char *name, const char *combination, const Result_t *result, double ratio)
+{
+    char cold[32] = "-";
+    char syscalls[32] = "-";
+    char versus[32] = "";
+
+    if (result->cold_ms >= 0)
+        snprintf(cold, sizeof(cold), "%.1f", result->cold_ms);
+    if (result->syscalls >= 0)
+        snprintf(syscalls, sizeof(syscalls), "%lld", result->syscalls);
+    if (ratio > 0)
+        snprintf(versus, sizeof(versus), "%.2fx", ratio);
+
+    double throughput = (result->warm_ms > 0) ? result->out_bytes / (result->warm_ms * 1e3) : 0;
+
+    printf("%-6s %-10s %10s %10.1f %10ld %10s %12lld %8.1f %8s\n", name, combination, cold,
+           result->warm_ms, result->peak_rss_kib, syscalls, result->out_bytes, throughput, versus);
+}
+
+/**************************              MAIN FUNCTION            *******************************/
+
+int main(int argc, char *argv[])
+{
+    const char *combinations[MAX_COMBINATIONS];
+    size_t combination_count = 0;
+    const char *myls = "./myls";
+    const char *gnu_ls = "ls";
+    int runs = 5;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:m:g:c:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':   runs = atoi(optarg);    break;
+            case 'm':   myls = optarg;          break;
+            case 'g':   gnu_ls = optarg;        break;
+
+            case 'c':
+                if (combination_count < MAX_COMBINATIONS)
+                {
+                    combinations[combination_count++] = optarg;
+                }
+                break;
+
+            default:    return 2;
+        }
+    }
+
+    if (optind != argc - 1 || runs < 1 || runs > MAX_RUNS)
+    {
+        fprintf(stderr, "usage: %s [-r runs (1-%d)] [-m myls] [-g ls] [-c \"options\"]... DIR\n", argv[0], MAX_RUNS);
+        return 2;
+    }
+
+    if (combination_count == 0)
+    {
+        for (size_t i = 0; i < DEFAULT_COMBINATION_COUNT; i++)
+        {
+            combinations[combination_count++] = DefaultCombinations[i];
+        }
+    }
+
+    const char *dir = argv[optind];
+    int compare = IsGnuLs(gnu_ls);
+
+    printf("fixture: %s, %d runs (median), caches %s, GNU ls %s\n", dir, runs,
+           (access("/proc/sys/vm/drop_caches", W_OK) == 0) ? "dropped before the first run" : "not dropped (not permitted)",
+           compare ? "found" : "not found");
+    printf("%-6s %-10s %10s %10s %10s %10s %12s %8s %8s\n", "prog", "options", "cold ms", "warm ms",
+           "RSS KiB", "syscalls", "out bytes", "MB/s", "vs GNU");
+
+    for (size_t i = 0; i < combination_count; i++)
+    {
+        Result_t mine;
+        Result_t gnu;
+
+        if (Measure(myls, NULL, combinations[i], dir, runs, &mine) < 0)
+        {
+            printf("%-6s %-10s failed\n", "myls", combinations[i]);
+            continue;
+        }
+
+        if (compare && Measure(gnu_ls, "--color=always", combinations[i], dir, runs, &gnu) == 0)
+        {
+            PrintRow("myls", combinations[i], &mine, mine.warm_ms / gnu.warm_ms);
+            PrintRow("ls", combinations[i], &gnu, 0);
+        }
+        else
+        {
+            PrintRow("myls", combinations[i], &mine, 0);
+        }
+
+        fflush(stdout);
+    }
+
+    return 0;
+}
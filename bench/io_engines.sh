@@ -0,0 +1,71 @@
+#!/bin/sh
+# Compares the synchronous and io_uring metadata engines of myls (--io=sync / --io=uring)
+# on a time-sorted listing (every entry is stat'ed).
+#
+# usage: bench/io_engines.sh [entries] [runs]
+#
+# A fixture of <entries> files is created on tmpfs (/dev/shm) and on the file system holding
+# $BENCH_DISK_DIR (default: /var/tmp). When /proc/sys/vm/drop_caches is writable (root, not in
+# a container), caches are dropped before every run so the disk numbers are cold-cache numbers.
+
+MYLS=${MYLS:-./myls}
+ENTRIES=${1:-100000}
+RUNS=${2:-5}
+DISK_DIR=${BENCH_DISK_DIR:-/var/tmp}
+
+make_fixture()
+{
+    dir=$1
+    if [ "$(ls -f "$dir" 2>/dev/null | wc -l)" -ne $((ENTRIES + 2)) ]; then
+        rm -rf "$dir"
+        mkdir -p "$dir"
+        (cd "$dir" && seq -f "entry_%08g" 1 "$ENTRIES" | xargs touch)
+    fi
+}
+
+drop_caches()
+{
+    if [ -w /proc/sys/vm/drop_caches ]; then
+        sync
+        echo 3 > /proc/sys/vm/drop_caches
+        echo cold
+    else
+        echo warm
+    fi
+}
+
+now_ns()
+{
+    date +%s%N
+}
+
+run()
+{
+    label=$1
+    dir=$2
+    engine=$3
+    total=0
+    cache=warm
+
+    for i in $(seq 1 "$RUNS"); do
+        cache=$(drop_caches)
+        start=$(now_ns)
+        "$MYLS" -1t --io="$engine" "$dir" > /dev/null
+        end=$(now_ns)
+        total=$((total + end - start))
+    done
+
+    awk -v l="$label" -v e="$engine" -v c="$cache" -v n="$ENTRIES" -v t="$total" -v r="$RUNS" \
+        'BEGIN { printf "%-8s %-6s %-5s %8d entries  %8.1f ms/run\n", l, e, c, n, t / r / 1000000 }'
+}
+
+make_fixture /dev/shm/myls_bench_io
+make_fixture "$DISK_DIR/myls_bench_io"
+
+for engine in sync uring; do
+    run tmpfs /dev/shm/myls_bench_io "$engine"
+done
+
+for engine in sync uring; do
+    run disk "$DISK_DIR/myls_bench_io" "$engine"
+done
@@ -0,0 +1,404 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        mkfixture.c            ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/*
+ * Creates a reproducible directory fixture for the benchmarks.
+ *
+ * usage: bench/mkfixture [options] DIR
+ *
+ *   -n N      number of top level entries (default: 100000)
+ *   -m LEN    shortest name (default: 8)
+ *   -M LEN    longest name (default: 32)
+ *   -e EXP    name length skew: length = m + (M - m) * u^EXP with u uniform in [0, 1)
+ *             (1 => uniform, larger => mostly short names; default: 2)
+ *   -l PCT    percentage of symbolic links (default: 10)
+ *   -b PCT    percentage of those links that are broken (default: 20)
+ *   -u PCT    percentage of setuid/setgid executables (default: 2)
+ *   -x PCT    percentage of executables (default: 10)
+ *   -d PCT    percentage of subdirectories (default: 2)
+ *   -k N      files in every subdirectory (default: 16)
+ *   -z SIZE   largest file size in bytes; files are sparse (default: 65536)
+ *   -s SEED   random seed (default: 1)
+ *
+ * The same options always produce the same names, types, modes and sizes. The options are
+ * recorded in DIR.params: running the tool again with the same options does nothing, and a
+ * non-empty DIR created with other options is left alone (remove it first).
+ */
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <math.h>
+#include <sys/stat.h>
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Parameters of a fixture.
+ */
+typedef struct
+{
+    long entries;
+    int min_len;
+    int max_len;
+    double skew;
+    int link_pct;
+    int broken_pct;
+    int setuid_pct;
+    int exec_pct;
+    int dir_pct;
+    long dir_files;
+    long max_size;
+    unsigned long seed;
+} Fixture_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* State of the xorshift64* generator */
+static uint64_t RandomState;
+
+/* Characters used in the names (the index part uses the first 36) */
+static const char NameChars[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_-.";
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Returns the next pseudo-random number (same sequence on every machine).
+ */
+static uint64_t Random(void)
+{
+    RandomState ^= RandomState >> 12;
+    RandomState ^= RandomState << 25;
+    RandomState ^= RandomState >> 27;
+    return RandomState * UINT64_C(2685821657736338717);
+}
+
+/**
+ * @brief Returns a pseudo-random number in [0, 1).
+ */
+static double RandomUnit(void)
+{
+    return (Random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief Builds the unique name of entry `index`.
+ *
+ * The name ends with the index in base 36, so names never collide; the rest is random.
+ */
+static void MakeName(const Fixture_t *fixture, long index, char *name)
+{
+    char digits[16];
+    int digit_count = 0;
+
+    do
+    {
+        digits[digit_count++] = NameChars[index % 36];
+        index /= 36;
+    } while (index > 0);
+
+    int len = fixture->min_len + (int)((fixture->max_len - fixture->min_len + 1) * pow(RandomUnit(), fixture->skew));
+    if (len > fixture->max_len)
+        len = fixture->max_len;
+    if (len < digit_count + 1)
+        len = digit_count + 1;
+
+    int prefix_len = len - digit_count;
+    for (int i = 0; i < prefix_len; i++)
+    {
+        /* Letters and digits only in front: no hidden files, nothing looking like an option */
+        size_t range = (i == 0) ? 62 : sizeof(NameChars) - 1;
+        name[i] = NameChars[Random() % range];
+    }
+
+    /* '~' separates the random part from the index, so "ab"+"c1" never equals "abc"+"1" */
+    name[prefix_len - 1] = '~';
+    for (int i = 0; i < digit_count; i++)
+    {
+        name[prefix_len + i] = digits[digit_count - 1 - i];
+    }
+    name[len] = '\0';
+}
+
+/**
+ * @brief Creates a regular file with a mode and a sparse size.
+ */
+static int CreateFile(int dir_fd, const char *name, mode_t mode, off_t size)
+{
+    int fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_EXCL, 0644);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    /* The mode is set explicitly: the umask would clear setuid/setgid bits at creation */
+    if (fchmod(fd, mode) < 0 || (size > 0 && ftruncate(fd, size) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return close(fd);
+}
+
+/**
+ * @brief Returns a random file size up to the fixture's maximum.
+ */
+static off_t RandomSize(const Fixture_t *fixture)
+{
+    return (fixture->max_size > 0) ? (off_t)(Random() % (uint64_t)(fixture->max_size + 1)) : 0;
+}
+
+/**
+ * @brief Creates a subdirectory holding `dir_files` regular files.
+ */
+static int CreateDirectory(int dir_fd, const char *name, const Fixture_t *fixture)
+{
+    char file_name[64];
+
+    if (mkdirat(dir_fd, name, 0755) < 0)
+    {
+        return -1;
+    }
+
+    int sub_fd = openat(dir_fd, name, O_RDONLY | O_DIRECTORY);
+    if (sub_fd < 0)
+    {
+        return -1;
+    }
+
+    for (long i = 0; i < fixture->dir_files; i++)
+    {
+        snprintf(file_name, sizeof(file_name), "file_%06ld", i);
+        if (CreateFile(sub_fd, file_name, 0644, RandomSize(fixture)) < 0)
+        {
+            close(sub_fd);
+            return -1;
+        }
+    }
+
+    return close(sub_fd);
+}
+
+/**
+ * @brief Creates every entry of the fixture in an empty directory.
+ */
+static int Generate(int dir_fd, const Fixture_t *fixture)
+{
+    char name[256];
+    char target[256];
+    char last_file[256] = "";
+
+    RandomState = fixture->seed * UINT64_C(0x9E3779B97F4A7C15) + 1;
+
+    for (long i = 0; i < fixture->entries; i++)
+    {
+        int pick = (int)(Random() % 100);
+        int status;
+
+        MakeName(fixture, i, name);
+
+        if (pick < fixture->dir_pct)
+        {
+            status = CreateDirectory(dir_fd, name, fixture);
+        }
+        else if ((pick -= fixture->dir_pct) < fixture->link_pct)
+        {
+            /* Links point to the previous regular file, or to a missing one */
+            if (last_file[0] == '\0' || (int)(Random() % 100) < fixture->broken_pct)
+            {
+                snprintf(target, sizeof(target), "missing_%ld", i);
+            }
+            else
+            {
+                strcpy(target, last_file);
+            }
+
+            status = symlinkat(target, dir_fd, name);
+        }
+        else if ((pick -= fixture->link_pct) < fixture->setuid_pct)
+        {
+            status = CreateFile(dir_fd, name, (Random() & 1) ? 04755 : 02755, RandomSize(fixture));
+        }
+        else
+        {
+            pick -= fixture->setuid_pct;
+            status = CreateFile(dir_fd, name, (pick < fixture->exec_pct) ? 0755 : 0644, RandomSize(fixture));
+            strcpy(last_file, name);
+        }
+
+        if (status < 0)
+        {
+            perror(name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Tells whether a directory has no entries besides . and ..
+ */
+static int IsEmptyDirectory(const char *path)
+{
+    DIR *dp = opendir(path);
+    struct dirent *entry;
+    int empty = 1;
+
+    if (dp == NULL)
+    {
+        return 0;
+    }
+
+    while ((entry = readdir(dp)) != NULL)
+    {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+        {
+            empty = 0;
+            break;
+        }
+    }
+
+    closedir(dp);
+    return empty;
+}
+
+/**
+ * @brief Parses a non-negative number option, exiting on error.
+ */
+static long ParseNumber(const char *arg, char option)
+{
+    char *end;
+    long value = strtol(arg, &end, 10);
+
+    if (end == arg || *end != '\0' || value < 0)
+    {
+        fprintf(stderr, "mkfixture: invalid value for -%c: %s\n", option, arg);
+        exit(2);
+    }
+
+    return value;
+}
+
+/**************************              MAIN FUNCTION            *******************************/
+
+int main(int argc, char *argv[])
+{
+    Fixture_t fixture = { 100000, 8, 32, 2.0, 10, 20, 2, 10, 2, 16, 65536, 1 };
+    char params[512];
+    char params_path[4096];
+    char recorded[512];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:M:e:l:b:u:x:d:k:z:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':   fixture.entries = ParseNumber(optarg, opt);             break;
+            case 'm':   fixture.min_len = (int)ParseNumber(optarg, opt);        break;
+            case 'M':   fixture.max_len = (int)ParseNumber(optarg, opt);        break;
+            case 'e':   fixture.skew = atof(optarg);                            break;
+            case 'l':   fixture.link_pct = (int)ParseNumber(optarg, opt);       break;
+            case 'b':   fixture.broken_pct = (int)ParseNumber(optarg, opt);     break;
+            case 'u':   fixture.setuid_pct = (int)ParseNumber(optarg, opt);     break;
+            case 'x':   fixture.exec_pct = (int)ParseNumber(optarg, opt);       break;
+            case 'd':   fixture.dir_pct = (int)ParseNumber(optarg, opt);        break;
+            case 'k':   fixture.dir_files = ParseNumber(optarg, opt);           break;
+            case 'z':   fixture.max_size = ParseNumber(optarg, opt);            break;
+            case 's':   fixture.seed = (unsigned long)ParseNumber(optarg, opt); break;
+            default:    return 2;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-n entries] [-m min_len] [-M max_len] [-e skew] [-l link%%] [-b broken%%]\n"
+                        "       [-u setuid%%] [-x exec%%] [-d dir%%] [-k files_per_dir] [-z max_size] [-s seed] DIR\n", argv[0]);
+        return 2;
+    }
+
+    if (fixture.min_len < 1 || fixture.max_len > 255 || fixture.min_len > fixture.max_len || fixture.skew <= 0 ||
+        fixture.dir_pct + fixture.link_pct + fixture.setuid_pct > 100)
+    {
+        fprintf(stderr, "mkfixture: inconsistent options\n");
+        return 2;
+    }
+
+    const char *dir = argv[optind];
+    snprintf(params, sizeof(params), "n=%ld m=%d M=%d e=%g l=%d b=%d u=%d x=%d d=%d k=%ld z=%ld s=%lu\n",
+             fixture.entries, fixture.min_len, fixture.max_len, fixture.skew, fixture.link_pct, fixture.broken_pct,
+             fixture.setuid_pct, fixture.exec_pct, fixture.dir_pct, fixture.dir_files, fixture.max_size, fixture.seed);
+    snprintf(params_path, sizeof(params_path), "%s.params", dir);
+
+    /* Same parameters as the existing fixture => nothing to do */
+    FILE *file = fopen(params_path, "r");
+    if (file != NULL)
+    {
+        int same = (fgets(recorded, sizeof(recorded), file) != NULL && strcmp(recorded, params) == 0);
+        fclose(file);
+
+        if (same)
+        {
+            printf("%s is up to date: %s", dir, params);
+            return 0;
+        }
+    }
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+    {
+        perror(dir);
+        return 1;
+    }
+
+    if (!IsEmptyDirectory(dir))
+    {
+        fprintf(stderr, "mkfixture: %s exists with other parameters; remove it first\n", dir);
+        return 1;
+    }
+
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (dir_fd < 0)
+    {
+        perror(dir);
+        return 1;
+    }
+
+    /* The parameters are recorded only once the fixture is complete */
+    unlink(params_path);
+    umask(0);
+
+    if (Generate(dir_fd, &fixture) < 0)
+    {
+        close(dir_fd);
+        return 1;
+    }
+
+    close(dir_fd);
+
+    file = fopen(params_path, "w");
+    if (file == NULL || fputs(params, file) == EOF || fclose(file) == EOF)
+    {
+        perror(params_path);
+        return 1;
+    }
+
+    printf("created %s: %s", dir, params);
+    return 0;
+}
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Measures the output throughput of myls (bytes/s written to /dev/null) on a large listing.
+#
+# usage: bench/output_throughput.sh [entries] [runs]
+#
+# The fixture is created under $BENCH_DIR (default: /var/tmp; tmpfs usually runs out of inodes
+# before 1M files). After the first run it is fully cached, so the formatting/output path
+# dominates. Set MYLS_BASELINE to another myls binary to compare both.
+
+MYLS=${MYLS:-./myls}
+ENTRIES=${1:-1000000}
+RUNS=${2:-3}
+DIR=${BENCH_DIR:-/var/tmp}/myls_bench_output
+
+if [ "$(ls -f "$DIR" 2>/dev/null | wc -l)" -ne $((ENTRIES + 2)) ]; then
+    rm -rf "$DIR"
+    mkdir -p "$DIR"
+    (cd "$DIR" && seq -f "entry_%08g" 1 "$ENTRIES" | xargs touch)
+fi
+
+now_ns()
+{
+    date +%s%N
+}
+
+measure()
+{
+    binary=$1
+    options=$2
+    bytes=$("$binary" $options "$DIR" | wc -c)
+    total=0
+
+    for i in $(seq 1 "$RUNS"); do
+        start=$(now_ns)
+        "$binary" $options "$DIR" > /dev/null
+        end=$(now_ns)
+        total=$((total + end - start))
+    done
+
+    awk -v b="$binary" -v o="$options" -v n="$bytes" -v t="$total" -v r="$RUNS" \
+        'BEGIN { s = t / r / 1e9; printf "%-24s %-20s %12d bytes  %8.3f s  %8.1f MB/s\n", b, o, n, s, n / s / 1e6 }'
+}
+
+for options in "-1 --no-exec-color" -l -f; do
+    measure "$MYLS" "$options"
+    if [ -n "$MYLS_BASELINE" ]; then
+        measure "$MYLS_BASELINE" "$options"
+    fi
+done
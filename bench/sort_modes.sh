@@ -0,0 +1,58 @@
+#!/bin/sh
+# Measures every sort mode of myls on a large directory.
+#
+# usage: bench/sort_modes.sh [entries] [runs]
+#
+# The fixture is created under $BENCH_DIR (default: /var/tmp) with mixed case names, several
+# extensions and version-like numbers. Set MYLS_BASELINE to another myls binary (e.g. one built
+# before the sort engine, which uses qsort) to compare both; modes the baseline does not
+# support are skipped for it. `-1U` (no sorting) is listed as the cost of everything but the
+# sort itself.
+
+MYLS=${MYLS:-./myls}
+ENTRIES=${1:-1000000}
+RUNS=${2:-3}
+DIR=${BENCH_DIR:-/var/tmp}/myls_bench_sort
+
+if [ "$(ls -f "$DIR" 2>/dev/null | wc -l)" -ne $((ENTRIES + 2)) ]; then
+    rm -rf "$DIR"
+    mkdir -p "$DIR"
+    (cd "$DIR" && awk -v n="$ENTRIES" 'BEGIN {
+        split("c txt tar.gz log so", ext, " ")
+        for (i = 1; i <= n; i++)
+            printf "%s_%d.v%d.%s\n", (i % 2 ? "File" : "file"), (i * 7919) % n, i % 13, ext[i % 5 + 1]
+    }' | xargs touch)
+fi
+
+now_ns()
+{
+    date +%s%N
+}
+
+measure()
+{
+    binary=$1
+    options=$2
+
+    # Skip the modes a binary does not support
+    "$binary" $options "$DIR" > /dev/null 2>&1 || return 0
+
+    total=0
+    for i in $(seq 1 "$RUNS"); do
+        start=$(now_ns)
+        "$binary" $options "$DIR" > /dev/null
+        end=$(now_ns)
+        total=$((total + end - start))
+    done
+
+    awk -v b="$binary" -v o="$options" -v t="$total" -v r="$RUNS" \
+        'BEGIN { printf "%-24s %-28s %8.3f s\n", b, o, t / r / 1e9 }'
+}
+
+for options in "-1U --no-exec-color" "-1 --no-exec-color" "-1r --no-exec-color" "-1X --no-exec-color" \
+               "-1v --no-exec-color" "-1U" "-1t" "-1tu" "-1S"; do
+    measure "$MYLS" "$options"
+    if [ -n "$MYLS_BASELINE" ]; then
+        measure "$MYLS_BASELINE" "$options"
+    fi
+done
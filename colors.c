@@ -0,0 +1,368 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        colors.c               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "utils.h"
+#include "options.h"
+#include "colors.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/* Bits of the second index of ModeTable */
+#define SPECIAL_SETUID 0x01
+#define SPECIAL_SETGID 0x02
+#define SPECIAL_EXEC 0x04
+#define SPECIAL_STICKY 0x08
+#define SPECIAL_OTHER_WRITABLE 0x10
+#define SPECIAL_BROKEN_LINK 0x20
+#define SPECIAL_COMBINATIONS 0x40
+
+/* Number of file types (S_IFMT >> 12) */
+#define FILE_TYPES 16
+
+/**
+ * @brief Color classes, in the order of their LS_COLORS keys (ClassKeys).
+ */
+typedef enum
+{
+    COLOR_NORMAL,
+    COLOR_FILE,
+    COLOR_DIR,
+    COLOR_LINK,
+    COLOR_FIFO,
+    COLOR_SOCK,
+    COLOR_BLK,
+    COLOR_CHR,
+    COLOR_ORPHAN,
+    COLOR_MISSING,
+    COLOR_EXEC,
+    COLOR_SETUID,
+    COLOR_SETGID,
+    COLOR_STICKY,
+    COLOR_OTHER_WRITABLE,
+    COLOR_STICKY_OTHER_WRITABLE,
+    COLOR_RESET,
+    COLOR_CLASS_COUNT
+} ColorClass_t;
+
+/**
+ * @brief One `*suffix=code` rule.
+ */
+typedef struct ExtensionRule
+{
+    const char *suffix;             /* Suffix to match (without the '*') */
+    size_t len;                     /* Length of suffix */
+    ColorSequence_t color;
+    struct ExtensionRule *next;     /* Next rule in the same hash slot (longer suffixes first) */
+} ExtensionRule_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+ColorSequence_t ColorReset = { reset, sizeof(reset) - 1 };
+
+/* LS_COLORS keys of the color classes */
+static const char *const ClassKeys[COLOR_CLASS_COUNT] =
+{
+    "no", "fi", "di", "ln", "pi", "so", "bd", "cd", "or", "mi", "ex", "su", "sg", "st", "ow", "tw", "rs"
+};
+
+/* Built-in colors (NULL => fall back to the directory color) */
+static const char *const DefaultColors[COLOR_CLASS_COUNT] =
+{
+    white, REGULAR_FILE, DIRECTORY, SOFT_LINK, NAMED_PIPE, SOCKET, BLOCK_SPECIAL_FILE,
+    CHARACTER_SPECIAL_FILE, RED_HIGHLIGHT, RED_HIGHLIGHT, EXECUTABLE_FILE,
+    WHITE_TEXT_RED_HIGHLIGHT, BLACK_TEXT_YELLOW_HIGHLIGHT, NULL, NULL, NULL, reset
+};
+
+static ColorSequence_t ClassColors[COLOR_CLASS_COUNT];
+
+/* Color of every (file type, permission bits) combination */
+static const ColorSequence_t *ModeTable[FILE_TYPES][SPECIAL_COMBINATIONS];
+
+/* Extension rules hashed on the text after the last '.', and the other suffix rules */
+static ExtensionRule_t *ExtensionSlots[COLORS_EXTENSION_SLOTS];
+static ExtensionRule_t *OtherSuffixRules;
+static int HaveSuffixRules;
+
+/* Storage for the parsed sequences and rules */
+static Arena_t ColorArena;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Case-insensitive FNV-1a hash of an extension.
+ */
+static size_t HashExtension(const char *ext, size_t len)
+{
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)tolower((unsigned char)ext[i]);
+        hash *= 16777619U;
+    }
+
+    return hash & (COLORS_EXTENSION_SLOTS - 1);
+}
+
+/**
+ * @brief Returns the position of the last '.' of a name, or -1.
+ */
+static long LastDot(const char *name, size_t len)
+{
+    for (size_t i = len; i > 0; i--)
+    {
+        if (name[i - 1] == '.')
+        {
+            return (long)(i - 1);
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Wraps an SGR code such as "01;34" into a full escape sequence.
+ */
+static ColorSequence_t MakeSequence(const char *code, size_t len)
+{
+    ColorSequence_t color;
+    char *seq = Arena_Alloc(&ColorArena, len + 4);
+
+    seq[0] = '\033';
+    seq[1] = '[';
+    memcpy(seq + 2, code, len);
+    seq[len + 2] = 'm';
+    seq[len + 3] = '\0';
+
+    color.seq = seq;
+    color.len = len + 3;
+
+    return color;
+}
+
+/**
+ * @brief Inserts a `*suffix=code` rule, keeping longer suffixes first in their slot.
+ */
+static void AddSuffixRule(const char *suffix, size_t len, ColorSequence_t color)
+{
+    ExtensionRule_t *rule = Arena_Alloc(&ColorArena, sizeof(ExtensionRule_t));
+    ExtensionRule_t **link;
+    long dot = LastDot(suffix, len);
+
+    rule->suffix = Arena_StrDup(&ColorArena, suffix, len);
+    rule->len = len;
+    rule->color = color;
+
+    if (dot >= 0)
+    {
+        link = &ExtensionSlots[HashExtension(suffix + dot + 1, len - dot - 1)];
+    }
+    else
+    {
+        link = &OtherSuffixRules;
+    }
+
+    while (*link != NULL && (*link)->len > len)
+    {
+        link = &(*link)->next;
+    }
+
+    rule->next = *link;
+    *link = rule;
+    HaveSuffixRules = 1;
+}
+
+/**
+ * @brief Applies the LS_COLORS environment variable on top of the built-in colors.
+ */
+static void ParseLsColors(const char *ls_colors)
+{
+    const char *item = ls_colors;
+
+    while (*item != '\0')
+    {
+        const char *end = strchr(item, ':');
+        const char *equal = memchr(item, '=', (end != NULL) ? (size_t)(end - item) : strlen(item));
+        size_t item_len = (end != NULL) ? (size_t)(end - item) : strlen(item);
+
+        if (equal != NULL)
+        {
+            size_t key_len = equal - item;
+            const char *code = equal + 1;
+            size_t code_len = item_len - key_len - 1;
+            ColorSequence_t color = MakeSequence(code, code_len);
+
+            if (key_len > 1 && item[0] == '*')
+            {
+                AddSuffixRule(item + 1, key_len - 1, color);
+            }
+            else if (key_len == 2 && strncmp(item, "ln", 2) == 0 && code_len == 6 && strncmp(code, "target", 6) == 0)
+            {
+                /* ln=target (color a link as its target) is not supported => keep the link color */
+            }
+            else if (key_len == 2)
+            {
+                /* Unknown two-letter keys (lc, rc, ec, do, ...) are ignored */
+                for (int i = 0; i < COLOR_CLASS_COUNT; i++)
+                {
+                    if (strncmp(item, ClassKeys[i], 2) == 0)
+                    {
+                        ClassColors[i] = color;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (end == NULL)
+        {
+            break;
+        }
+
+        item = end + 1;
+    }
+}
+
+/**
+ * @brief Chooses the color class of one (file type, permission bits) combination.
+ *
+ * The precedence is: setuid, setgid, executable, then the file type.
+ */
+static ColorClass_t ClassifyMode(mode_t type, int special, int permission_colors)
+{
+    if (permission_colors && (special & SPECIAL_SETUID))
+        return COLOR_SETUID;
+    if (permission_colors && (special & SPECIAL_SETGID))
+        return COLOR_SETGID;
+
+    switch (type)
+    {
+        case S_IFREG:
+            return (permission_colors && (special & SPECIAL_EXEC)) ? COLOR_EXEC : COLOR_FILE;
+
+        case S_IFDIR:
+            if ((special & SPECIAL_STICKY) && (special & SPECIAL_OTHER_WRITABLE) && ClassColors[COLOR_STICKY_OTHER_WRITABLE].seq != NULL)
+                return COLOR_STICKY_OTHER_WRITABLE;
+            if ((special & SPECIAL_OTHER_WRITABLE) && ClassColors[COLOR_OTHER_WRITABLE].seq != NULL)
+                return COLOR_OTHER_WRITABLE;
+            if ((special & SPECIAL_STICKY) && ClassColors[COLOR_STICKY].seq != NULL)
+                return COLOR_STICKY;
+            return COLOR_DIR;
+
+        case S_IFCHR:   return COLOR_CHR;
+        case S_IFBLK:   return COLOR_BLK;
+        case S_IFIFO:   return COLOR_FIFO;
+        case S_IFSOCK:  return COLOR_SOCK;
+        case S_IFLNK:   return (special & SPECIAL_BROKEN_LINK) ? COLOR_ORPHAN : COLOR_LINK;
+        default:        return COLOR_NORMAL;
+    }
+}
+
+void Colors_Init(const Options_t *options)
+{
+    for (int i = 0; i < COLOR_CLASS_COUNT; i++)
+    {
+        ClassColors[i].seq = DefaultColors[i];
+        ClassColors[i].len = (DefaultColors[i] != NULL) ? strlen(DefaultColors[i]) : 0;
+    }
+
+    const char *ls_colors = getenv("LS_COLORS");
+    if (ls_colors != NULL)
+    {
+        ParseLsColors(ls_colors);
+    }
+
+    ColorReset = ClassColors[COLOR_RESET];
+
+    /* Permission based colors can be disabled so that regular files need no stat */
+    int permission_colors = !options->flags[NO_EXEC_COLOR_OPTION];
+
+    /* Compile every combination once, so that a lookup is a single table probe */
+    for (int type = 0; type < FILE_TYPES; type++)
+    {
+        for (int special = 0; special < SPECIAL_COMBINATIONS; special++)
+        {
+            ModeTable[type][special] = &ClassColors[ClassifyMode((mode_t)type << 12, special, permission_colors)];
+        }
+    }
+}
+
+/**
+ * @brief Finds the suffix rule matching a name, if any.
+ */
+static const ColorSequence_t *MatchSuffix(const char *name, size_t name_len)
+{
+    long dot = LastDot(name, name_len);
+
+    if (dot >= 0)
+    {
+        const ExtensionRule_t *rule = ExtensionSlots[HashExtension(name + dot + 1, name_len - dot - 1)];
+
+        for (; rule != NULL; rule = rule->next)
+        {
+            if (rule->len <= name_len && strncasecmp(name + name_len - rule->len, rule->suffix, rule->len) == 0)
+            {
+                return &rule->color;
+            }
+        }
+    }
+
+    for (const ExtensionRule_t *rule = OtherSuffixRules; rule != NULL; rule = rule->next)
+    {
+        if (rule->len <= name_len && strncasecmp(name + name_len - rule->len, rule->suffix, rule->len) == 0)
+        {
+            return &rule->color;
+        }
+    }
+
+    return NULL;
+}
+
+int Colors_NeedsDirMode(void)
+{
+    return ClassColors[COLOR_STICKY].seq != NULL || ClassColors[COLOR_OTHER_WRITABLE].seq != NULL ||
+           ClassColors[COLOR_STICKY_OTHER_WRITABLE].seq != NULL;
+}
+
+const ColorSequence_t *Colors_ForEntry(const FileEntry_t *entry, size_t name_len)
+{
+    mode_t mode = entry->buf.st_mode;
+    int special = ((mode & S_ISUID) ? SPECIAL_SETUID : 0) |
+                  ((mode & S_ISGID) ? SPECIAL_SETGID : 0) |
+                  ((mode & (S_IXUSR | S_IXGRP | S_IXOTH)) ? SPECIAL_EXEC : 0) |
+                  ((mode & S_ISVTX) ? SPECIAL_STICKY : 0) |
+                  ((mode & S_IWOTH) ? SPECIAL_OTHER_WRITABLE : 0) |
+                  ((entry->link_status == BROKEN_LINK) ? SPECIAL_BROKEN_LINK : 0);
+
+    const ColorSequence_t *color = ModeTable[(mode & S_IFMT) >> 12][special];
+
+    /* Extension rules only apply to plain regular files */
+    if (color == &ClassColors[COLOR_FILE] && HaveSuffixRules)
+    {
+        const ColorSequence_t *suffix_color = MatchSuffix(entry->name, name_len);
+        if (suffix_color != NULL)
+        {
+            return suffix_color;
+        }
+    }
+
+    return color;
+}
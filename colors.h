@@ -0,0 +1,68 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        colors.h               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _COLORS_H_
+#define _COLORS_H_
+
+#include <stddef.h>
+
+#include "entries.h"
+#include "options.h"
+
+/* Number of slots of the extension hash table (must be a power of two) */
+#define COLORS_EXTENSION_SLOTS 1024
+
+/**
+ * @brief A ready-to-print escape sequence.
+ */
+typedef struct
+{
+    const char *seq;    /* Full escape sequence, e.g. "\033[1;34m" */
+    size_t len;         /* Length of seq */
+} ColorSequence_t;
+
+/* Sequence printed after a colored name */
+extern ColorSequence_t ColorReset;
+
+/**
+ * @brief Builds the color lookup tables.
+ *
+ * Starts from the built-in colors, then applies the LS_COLORS environment variable (standard
+ * `key=code` pairs separated by ':', including `*suffix=code` extension rules). The result is
+ * compiled into a dense table indexed by file type and permission bits, plus a hash table of
+ * extensions, so Colors_ForEntry costs one table probe per entry. Must be called once after
+ * the options are parsed.
+ *
+ * @param options The options (--no-exec-color drops the permission based colors).
+ */
+void Colors_Init(const Options_t *options);
+
+/**
+ * @brief Tells whether directory colors depend on the permission bits.
+ *
+ * True when LS_COLORS sets `st`, `ow` or `tw`: directories must then be stat'ed for their
+ * sticky and other-writable bits, which their directory record does not give.
+ *
+ * @return 1 if directories need their mode, 0 otherwise.
+ */
+int Colors_NeedsDirMode(void);
+
+/**
+ * @brief Returns the color of an entry.
+ *
+ * @param entry The entry record (mode and symbolic link state are used).
+ * @param name_len Length of the entry name.
+ *
+ * @return The escape sequence to print before the name.
+ */
+const ColorSequence_t *Colors_ForEntry(const FileEntry_t *entry, size_t name_len);
+
+#endif
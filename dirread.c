@@ -0,0 +1,224 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        dirread.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "dirread.h"
+#include "stats.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+#if defined(__linux__) && defined(SYS_getdents64)
+#define DIRREAD_HAVE_GETDENTS64 1
+
+/* Layout of the records returned by getdents64 */
+struct linux_dirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+int DirReader_ParseSize(const char *str, size_t *size)
+{
+    char *end;
+    unsigned long long unit = 1;
+
+    /* strtoull would accept (and negate) a sign and skip leading spaces */
+    if (str[0] < '0' || str[0] > '9')
+    {
+        return -1;
+    }
+
+    errno = 0;
+    unsigned long long value = strtoull(str, &end, 10);
+
+    if (errno == ERANGE)
+    {
+        return -1;
+    }
+
+    switch (*end)
+    {
+        case 'k': case 'K':     unit = 1024ULL;                     end++;  break;
+        case 'm': case 'M':     unit = 1024ULL * 1024;              end++;  break;
+        case 'g': case 'G':     unit = 1024ULL * 1024 * 1024;       end++;  break;
+        default:                                                            break;
+    }
+
+    /* getdents64 takes the buffer size as an unsigned int, and fails above INT_MAX */
+    if (*end != '\0' || value > INT_MAX / unit)
+    {
+        return -1;
+    }
+
+    value *= unit;
+
+    *size = (size_t)value;
+    return 0;
+}
+
+int DirReader_Open(DirReader_t *reader, const char *dir, size_t buffer_size)
+{
+    reader->dp = NULL;
+    reader->buffer = NULL;
+    reader->buffer_size = 0;
+    reader->pos = 0;
+    reader->len = 0;
+
+    reader->fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (reader->fd < 0)
+    {
+        return -1;
+    }
+
+#ifdef DIRREAD_HAVE_GETDENTS64
+    if (buffer_size > 0)
+    {
+        if (buffer_size < DIR_BUFFER_MIN_SIZE)
+        {
+            buffer_size = DIR_BUFFER_MIN_SIZE;
+        }
+
+        reader->buffer = malloc(buffer_size);
+        if (reader->buffer != NULL)
+        {
+            reader->buffer_size = buffer_size;
+            return 0;
+        }
+    }
+#endif
+
+    /* Fallback: portable readdir on top of the same descriptor */
+    reader->dp = fdopendir(reader->fd);
+    if (reader->dp == NULL)
+    {
+        int saved_errno = errno;
+        close(reader->fd);
+        errno = saved_errno;
+        return -1;
+    }
+
+    return 0;
+}
+
+int DirReader_Next(DirReader_t *reader, DirRecord_t *record)
+{
+#ifdef DIRREAD_HAVE_GETDENTS64
+    if (reader->dp == NULL)
+    {
+        /* Refill the buffer once every record in it was consumed */
+        if (reader->pos >= reader->len)
+        {
+            long nread = syscall(SYS_getdents64, reader->fd, reader->buffer, reader->buffer_size);
+            STATS_COUNT(STATS_GETDENTS, 1);
+
+            if (nread < 0)
+            {
+                if (errno != ENOSYS)
+                {
+                    return -1;
+                }
+
+                /* Kernel without getdents64 => switch to readdir for the rest of the stream */
+                free(reader->buffer);
+                reader->buffer = NULL;
+                reader->dp = fdopendir(reader->fd);
+                if (reader->dp == NULL)
+                {
+                    return -1;
+                }
+
+                return DirReader_Next(reader, record);
+            }
+
+            if (nread == 0)
+            {
+                return 0;
+            }
+
+            reader->pos = 0;
+            reader->len = (size_t)nread;
+        }
+
+        /* Parse the record in place: nothing is copied here */
+        struct linux_dirent64 *dirent = (struct linux_dirent64 *)(reader->buffer + reader->pos);
+        reader->pos += dirent->d_reclen;
+
+        record->name = dirent->d_name;
+        record->name_len = strlen(dirent->d_name);
+        record->d_type = dirent->d_type;
+        record->d_ino = (ino_t)dirent->d_ino;
+
+        return 1;
+    }
+#endif
+
+    errno = 0;
+    struct dirent *entry = readdir(reader->dp);
+    if (entry == NULL)
+    {
+        return (errno == 0) ? 0 : -1;
+    }
+
+    record->name = entry->d_name;
+    record->name_len = strlen(entry->d_name);
+#ifdef _DIRENT_HAVE_D_TYPE
+    record->d_type = entry->d_type;
+#else
+    record->d_type = DT_UNKNOWN;
+#endif
+    record->d_ino = entry->d_ino;
+
+    return 1;
+}
+
+int DirReader_BatchDone(const DirReader_t *reader)
+{
+    return (reader->dp == NULL && reader->pos >= reader->len);
+}
+
+void DirReader_Close(DirReader_t *reader)
+{
+    if (reader->dp != NULL)
+    {
+        /* closedir also closes the underlying descriptor */
+        closedir(reader->dp);
+    }
+    else if (reader->fd >= 0)
+    {
+        close(reader->fd);
+    }
+
+    free(reader->buffer);
+
+    reader->dp = NULL;
+    reader->fd = -1;
+    reader->buffer = NULL;
+}
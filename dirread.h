@@ -0,0 +1,107 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        dirread.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _DIRREAD_H_
+#define _DIRREAD_H_
+
+#include <stddef.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+/* Default size of the getdents64 buffer (can be changed with --dirbuf) */
+#define DIR_BUFFER_DEFAULT_SIZE (256 * 1024)
+
+/* Smallest buffer accepted: it must hold at least one maximal record */
+#define DIR_BUFFER_MIN_SIZE 4096
+
+/**
+ * @brief One raw directory record.
+ *
+ * The name points into the reader's buffer and is only valid until the next call to
+ * DirReader_Next, so it has to be copied if the entry is kept.
+ */
+typedef struct
+{
+    const char *name;       /* Null-terminated entry name (not owned) */
+    size_t name_len;        /* Length of the name */
+    unsigned char d_type;   /* File type as reported by the file system (DT_*) */
+    ino_t d_ino;            /* Inode number as reported by the file system */
+} DirRecord_t;
+
+/**
+ * @brief State of an open directory stream.
+ *
+ * On Linux, records are read with the getdents64 system call into a large buffer and parsed
+ * in place. Elsewhere, or when the buffer size is 0, the reader falls back to readdir.
+ */
+typedef struct
+{
+    int fd;             /* Directory file descriptor */
+    DIR *dp;            /* readdir stream, used by the fallback backend only */
+    char *buffer;       /* getdents64 buffer */
+    size_t buffer_size; /* Capacity of the buffer */
+    size_t pos;         /* Offset of the next record in the buffer */
+    size_t len;         /* Number of valid bytes in the buffer */
+} DirReader_t;
+
+/**
+ * @brief Parses a buffer size such as "65536", "64K" or "1M".
+ *
+ * @param str The string to parse.
+ * @param size Output: the size in bytes.
+ *
+ * @return 0 on success, -1 if the string is not a valid size (a sign, trailing characters, or
+ *         more than INT_MAX bytes, which getdents64 rejects).
+ */
+int DirReader_ParseSize(const char *str, size_t *size);
+
+/**
+ * @brief Opens a directory for reading.
+ *
+ * @param reader The reader state to initialize.
+ * @param dir The directory path.
+ * @param buffer_size Size of the getdents64 buffer; 0 selects the readdir backend.
+ *
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int DirReader_Open(DirReader_t *reader, const char *dir, size_t buffer_size);
+
+/**
+ * @brief Reads the next record of a directory.
+ *
+ * @param reader The reader state.
+ * @param record Output: the next record.
+ *
+ * @return 1 if a record was returned, 0 at the end of the directory, -1 on error.
+ */
+int DirReader_Next(DirReader_t *reader, DirRecord_t *record);
+
+/**
+ * @brief Tells whether every record already read from the kernel was returned.
+ *
+ * With the getdents64 backend, this marks the end of a batch: the next DirReader_Next has to
+ * ask the kernel for more records. The readdir backend hides its batches, so it always
+ * returns 0 there.
+ *
+ * @param reader The reader state.
+ *
+ * @return 1 if the buffer is consumed, 0 otherwise.
+ */
+int DirReader_BatchDone(const DirReader_t *reader);
+
+/**
+ * @brief Closes a directory and frees the reader's buffer.
+ *
+ * @param reader The reader state.
+ */
+void DirReader_Close(DirReader_t *reader);
+
+#endif
@@ -0,0 +1,477 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        du.c                   ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "options.h"
+#include "metadata.h"
+#include "utils.h"
+#include "du.h"
+#include "tree.h"
+#include "stats.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Totals of one thread, on their own cache line so that threads never share one.
+ */
+typedef struct
+{
+    _Alignas(64) unsigned long long blocks;    /* 512-byte units */
+} DuTotals_t;
+
+/**
+ * @brief State shared by the threads of a walk.
+ */
+typedef struct
+{
+    const Options_t *options;             /* Options of the walk (buffer size, --dont-sync, --jobs) */
+    int jobs;                             /* Threads besides the caller */
+    TreeQueue_t queues[DU_MAX_JOBS + 1];  /* Index 0 belongs to the caller */
+    DuTotals_t totals[DU_MAX_JOBS + 1];
+    DuInodeSet_t *counted;                /* Inodes already counted (by any operand) */
+    StatsProfile_t *stats;                /* Profile the threads count into (--stats) */
+
+    pthread_mutex_t lock;                 /* Protects the fields below */
+    pthread_cond_t work_cond;             /* Signaled when directories are queued or the walk ends */
+    size_t queued;                        /* Directories in the queues */
+    int active;                           /* Threads reading a directory */
+    int finished;
+} DuWalker_t;
+
+/**
+ * @brief Arguments of a thread.
+ */
+typedef struct
+{
+    DuWalker_t *walker;
+    int id;             /* Index of its queue and totals */
+} DuWorker_t;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Hashes an inode identity (the low bits pick the shard, the high bits the slot).
+ */
+static uint64_t HashInode(dev_t dev, ino_t ino)
+{
+    uint64_t hash = ((uint64_t)ino ^ ((uint64_t)dev << 32 | (uint64_t)dev >> 32)) * 0x9E3779B97F4A7C15ULL;
+
+    return hash ^ (hash >> 29);
+}
+
+/**
+ * @brief Finds the slot holding an inode, or the free slot where it belongs.
+ */
+static DuInode_t *FindSlot(DuShard_t *shard, dev_t dev, ino_t ino, uint64_t hash)
+{
+    size_t index = (size_t)(hash >> 16) & (shard->capacity - 1);
+
+    while (shard->slots[index].ino != 0 && (shard->slots[index].ino != ino || shard->slots[index].dev != dev))
+    {
+        index = (index + 1) & (shard->capacity - 1);
+    }
+
+    return &shard->slots[index];
+}
+
+/**
+ * @brief Doubles a shard once it is 70% full (and allocates it on first use).
+ */
+static void Reserve(DuShard_t *shard)
+{
+    if (shard->slots != NULL && (shard->count + 1) * 10 < shard->capacity * 7)
+    {
+        return;
+    }
+
+    DuShard_t grown = *shard;
+    grown.capacity = (shard->slots == NULL) ? DU_SET_INITIAL_CAPACITY : shard->capacity * 2;
+    grown.slots = calloc(grown.capacity, sizeof(DuInode_t));
+
+    if (grown.slots == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < shard->capacity; i++)
+    {
+        if (shard->slots[i].ino != 0)
+        {
+            *FindSlot(&grown, shard->slots[i].dev, shard->slots[i].ino,
+                      HashInode(shard->slots[i].dev, shard->slots[i].ino)) = shard->slots[i];
+        }
+    }
+
+    free(shard->slots);
+    shard->slots = grown.slots;
+    shard->capacity = grown.capacity;
+}
+
+/**
+ * @brief Adds an inode to the set of counted inodes.
+ *
+ * @return 1 if it was not in the set (its blocks are to be counted), 0 otherwise.
+ */
+static int MarkCounted(DuInodeSet_t *set, dev_t dev, ino_t ino)
+{
+    uint64_t hash = HashInode(dev, ino);
+    DuShard_t *shard = &set->shards[hash & (DU_SET_SHARDS - 1)];
+    int added = 0;
+
+    pthread_mutex_lock(&shard->lock);
+
+    Reserve(shard);
+    DuInode_t *slot = FindSlot(shard, dev, ino, hash);
+    if (slot->ino == 0)
+    {
+        slot->dev = dev;
+        slot->ino = ino;
+        shard->count++;
+        added = 1;
+    }
+
+    pthread_mutex_unlock(&shard->lock);
+
+    return added;
+}
+
+/**
+ * @brief Tells whether a file counts only once: a hard-linked one, or any one when the set
+ *        tracks every inode.
+ */
+static int IsTracked(const DuInodeSet_t *set, const struct stat *buf)
+{
+    /* Directories cannot be hard linked; their link count is their number of subdirectories */
+    return set->all || (buf->st_nlink > 1 && !S_ISDIR(buf->st_mode));
+}
+
+/**
+ * @brief Adds the blocks of one file to a thread's totals, unless it was already counted.
+ *
+ * @return 1 if it was counted, 0 if it was already (then a directory is not to be scanned).
+ */
+static int CountFile(DuWalker_t *walker, DuTotals_t *totals, const struct stat *buf)
+{
+    if (IsTracked(walker->counted, buf) && !MarkCounted(walker->counted, buf->st_dev, buf->st_ino))
+    {
+        return 0;
+    }
+
+    totals->blocks += buf->st_blocks;
+
+    return 1;
+}
+
+/**
+ * @brief Counts the entries of one directory and queues its subdirectories.
+ *
+ * @param walker The walk.
+ * @param path The directory.
+ * @param id Index of the calling thread's queue and totals.
+ */
+static void ScanDirectory(DuWalker_t *walker, const char *path, int id)
+{
+    DirReader_t reader;
+    DirRecord_t record;
+    DuTotals_t *totals = &walker->totals[id];
+    unsigned int mask = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_INO | STATX_BLOCKS;
+    void **subdirs = NULL;
+    size_t subdir_count = 0;
+    size_t subdir_capacity = 0;
+    int status;
+
+    if (DirReader_Open(&reader, path, walker->options->dir_buffer_size) < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", path);
+        return;
+    }
+
+    while ((status = DirReader_Next(&reader, &record)) > 0)
+    {
+        struct stat buf;
+
+        if (record.name[0] == '.' && (record.name[1] == '\0' || (record.name[1] == '.' && record.name[2] == '\0')))
+        {
+            continue;
+        }
+
+        if (Metadata_Fetch(walker->options, reader.fd, record.name, mask, &buf) < 0)
+        {
+            fprintf(stderr, "Cannot access: %s/%s\n", path, record.name);
+            continue;
+        }
+
+        STATS_COUNT(STATS_ENTRIES, 1);
+
+        if (CountFile(walker, totals, &buf) && S_ISDIR(buf.st_mode))
+        {
+            if (subdir_count == subdir_capacity)
+            {
+                subdir_capacity = (subdir_capacity > 0) ? subdir_capacity * 2 : TREE_QUEUE_INITIAL_CAPACITY;
+                void **grown = realloc(subdirs, subdir_capacity * sizeof(void *));
+                if (grown == NULL)
+                {
+                    perror("Memory allocation failed");
+                    exit(1);
+                }
+                subdirs = grown;
+            }
+
+            subdirs[subdir_count++] = Tree_JoinPath(path, record.name);
+        }
+    }
+
+    if (status < 0)
+    {
+        perror("Error reading directory");
+    }
+
+    DirReader_Close(&reader);
+
+    if (subdir_count == 0)
+    {
+        return;
+    }
+
+    Tree_QueuePush(&walker->queues[id], subdirs, subdir_count);
+    free(subdirs);
+
+    pthread_mutex_lock(&walker->lock);
+    walker->queued += subdir_count;
+    pthread_cond_broadcast(&walker->work_cond);
+    pthread_mutex_unlock(&walker->lock);
+}
+
+/**
+ * @brief Body of a thread (the caller included): scans queued directories until none is
+ *        queued or being read.
+ */
+static void *DuWorker(void *arg)
+{
+    DuWorker_t *worker = arg;
+    DuWalker_t *walker = worker->walker;
+    int queue_count = walker->jobs + 1;
+
+    /* The caller already counts into the profile */
+    if (worker->id != 0)
+    {
+        STATS_ATTACH(walker->stats);
+    }
+
+    for (;;)
+    {
+        char *path = Tree_QueuePopNewest(&walker->queues[worker->id]);
+
+        /* Own queue is empty => steal from the others */
+        for (int i = 1; path == NULL && i < queue_count; i++)
+        {
+            path = Tree_QueueStealOldest(&walker->queues[(worker->id + i) % queue_count]);
+        }
+
+        pthread_mutex_lock(&walker->lock);
+
+        if (path == NULL)
+        {
+            while (!walker->finished && walker->queued == 0)
+            {
+                pthread_cond_wait(&walker->work_cond, &walker->lock);
+            }
+
+            int finished = walker->finished;
+            pthread_mutex_unlock(&walker->lock);
+
+            if (finished)
+            {
+                break;
+            }
+            continue;
+        }
+
+        walker->queued--;
+        walker->active++;
+        pthread_mutex_unlock(&walker->lock);
+
+        ScanDirectory(walker, path, worker->id);
+        free(path);
+
+        /* Nothing queued and nobody left to queue more => the tree is done */
+        pthread_mutex_lock(&walker->lock);
+        walker->active--;
+        if (walker->queued == 0 && walker->active == 0)
+        {
+            walker->finished = 1;
+            pthread_cond_broadcast(&walker->work_cond);
+        }
+        pthread_mutex_unlock(&walker->lock);
+    }
+
+    if (worker->id != 0)
+    {
+        STATS_DETACH();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Chooses the number of threads besides the caller.
+ */
+static int JobCount(const Options_t *options)
+{
+    long jobs;
+
+    if (options->jobs > 0)
+    {
+        /* The caller scans directories too */
+        jobs = options->jobs - 1;
+    }
+    else
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = ((cpus > 0) ? cpus : 1) * DU_AUTO_JOBS_PER_CPU;
+    }
+
+    if (jobs > DU_MAX_JOBS)
+        jobs = DU_MAX_JOBS;
+
+    return (int)jobs;
+}
+
+void Du_InitInodeSet(DuInodeSet_t *set, int all)
+{
+    set->all = all;
+
+    for (int i = 0; i < DU_SET_SHARDS; i++)
+    {
+        pthread_mutex_init(&set->shards[i].lock, NULL);
+        set->shards[i].slots = NULL;
+        set->shards[i].capacity = 0;
+        set->shards[i].count = 0;
+    }
+}
+
+void Du_FreeInodeSet(DuInodeSet_t *set)
+{
+    for (int i = 0; i < DU_SET_SHARDS; i++)
+    {
+        free(set->shards[i].slots);
+        set->shards[i].slots = NULL;
+        pthread_mutex_destroy(&set->shards[i].lock);
+    }
+}
+
+int Du_Summarize(const Options_t *options, OutBuf_t *out, char *dir, DuInodeSet_t *counted)
+{
+    StatsProfile_t stats;
+    struct stat root;
+
+    /* The argument itself is followed, as it is for a listing */
+    STATS_COUNT(STATS_STAT, 1);
+    if (stat(dir, &root) < 0)
+    {
+        fprintf(stderr, "Cannot access: %s\n", dir);
+        return -1;
+    }
+
+    /* Already counted under an earlier operand => no line at all, as du does */
+    if (IsTracked(counted, &root) && !MarkCounted(counted, root.st_dev, root.st_ino))
+    {
+        return 0;
+    }
+
+    STATS_BEGIN(&stats, dir);
+
+    DuWalker_t *walker = Tree_Malloc(sizeof(DuWalker_t));
+    DuWorker_t workers[DU_MAX_JOBS + 1];
+    pthread_t threads[DU_MAX_JOBS + 1];
+    int started[DU_MAX_JOBS + 1];
+
+    walker->options = options;
+    walker->jobs = S_ISDIR(root.st_mode) ? JobCount(options) : 0;
+    walker->counted = counted;
+    walker->stats = STATS_CURRENT();
+    walker->queued = 0;
+    walker->active = 0;
+    walker->finished = 0;
+    pthread_mutex_init(&walker->lock, NULL);
+    pthread_cond_init(&walker->work_cond, NULL);
+
+    for (int i = 0; i <= walker->jobs; i++)
+    {
+        Tree_QueueInit(&walker->queues[i]);
+        walker->totals[i].blocks = 0;
+    }
+
+    walker->totals[0].blocks = root.st_blocks;
+
+    if (S_ISDIR(root.st_mode))
+    {
+        /* Seed the caller's queue with the root, then scan along with the other threads */
+        void *root_path = Tree_JoinPath(dir, "");
+        Tree_QueuePush(&walker->queues[0], &root_path, 1);
+        walker->queued = 1;
+
+        for (int i = 0; i <= walker->jobs; i++)
+        {
+            workers[i].walker = walker;
+            workers[i].id = i;
+        }
+
+        for (int i = 1; i <= walker->jobs; i++)
+        {
+            started[i] = (pthread_create(&threads[i], NULL, DuWorker, &workers[i]) == 0);
+        }
+
+        DuWorker(&workers[0]);
+
+        for (int i = 1; i <= walker->jobs; i++)
+        {
+            if (started[i])
+            {
+                pthread_join(threads[i], NULL);
+            }
+        }
+    }
+
+    /* Merge the per-thread totals */
+    struct stat sum;
+    sum.st_blocks = 0;
+
+    for (int i = 0; i <= walker->jobs; i++)
+    {
+        sum.st_blocks += walker->totals[i].blocks;
+        Tree_QueueFree(&walker->queues[i]);
+    }
+
+    pthread_cond_destroy(&walker->work_cond);
+    pthread_mutex_destroy(&walker->lock);
+    free(walker);
+
+    STATS_SWITCH(STATS_PHASE_FORMAT);
+    OutBuf_PutUInt(out, GetDiskBlocks(&sum), 0);
+    OutBuf_Putc(out, '\t');
+    OutBuf_Puts(out, dir);
+    OutBuf_Putc(out, '\n');
+
+    STATS_END();
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        du.h                   ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _DU_H_
+#define _DU_H_
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "outbuf.h"
+#include "options.h"
+
+/* With an automatic job count, this many threads are started per online CPU (the walk waits
+   on directory reads and stat calls, so more threads than CPUs still help) */
+#define DU_AUTO_JOBS_PER_CPU 4
+
+/* Hard upper bound of the number of threads */
+#define DU_MAX_JOBS 256
+
+/* The set of counted inodes is split into this many independently locked shards, so that
+   threads inserting different inodes rarely wait for each other */
+#define DU_SET_SHARDS 64
+
+/* Initial number of slots of a shard */
+#define DU_SET_INITIAL_CAPACITY 256
+
+/**
+ * @brief Identity of a hard-linked inode (ino 0 marks a free slot).
+ */
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+} DuInode_t;
+
+/**
+ * @brief One shard of a set of counted inodes: an open-addressed (linear probing) table.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    DuInode_t *slots;
+    size_t capacity;    /* Number of slots, a power of two */
+    size_t count;       /* Number of used slots */
+} DuShard_t;
+
+/**
+ * @brief Set of the inodes already counted, sharded by inode.
+ *
+ * One set serves every operand of a `--du` invocation, so that a file linked from two of them
+ * is counted in the first one only, as `du -s` does.
+ */
+typedef struct
+{
+    DuShard_t shards[DU_SET_SHARDS];
+    int all;    /* Every inode is tracked, not only the ones of hard-linked files */
+} DuInodeSet_t;
+
+/**
+ * @brief Initializes an empty set of counted inodes.
+ *
+ * @param set The set.
+ * @param all Nonzero to track every inode, directories included, as du does with several
+ *            operands: then a tree (or file) met again below another operand is skipped.
+ */
+void Du_InitInodeSet(DuInodeSet_t *set, int all);
+
+/**
+ * @brief Releases the memory of a set of counted inodes.
+ */
+void Du_FreeInodeSet(DuInodeSet_t *set);
+
+/**
+ * @brief Prints the disk usage of a tree (`--du`), as `du -s` does: the number of 1K blocks
+ *        allocated to the directory and everything below it, a tab and the path.
+ *
+ * Symbolic links are not followed (dir itself is, as for a listing), mount points are crossed
+ * and a file with several hard links is counted once, however many of its names are found:
+ * a file already in counted (found under an earlier operand) adds nothing, and a directory
+ * already in it is not read again. An operand that is already in it prints no line.
+ *
+ * The tree is read by a pool of threads: each one keeps a queue of the directories it
+ * discovered, works on the newest one and steals the oldest directories of the other threads
+ * when its own queue is empty. Every thread adds to its own totals, which are merged once the
+ * walk is over; the only shared state is the queues and the set of inodes already counted,
+ * sharded by inode. The number of threads is --jobs when given, otherwise DU_AUTO_JOBS_PER_CPU
+ * per online CPU.
+ *
+ * @param options The options of the listing.
+ * @param out The buffer receiving the summary line.
+ * @param dir The root of the tree.
+ * @param counted The inodes counted so far by this invocation (see Du_InitInodeSet); the
+ *                ones found are added to it.
+ *
+ * @return 0 on success, -1 if dir cannot be accessed.
+ */
+int Du_Summarize(const Options_t *options, OutBuf_t *out, char *dir, DuInodeSet_t *counted);
+
+#endif
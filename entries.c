@@ -0,0 +1,164 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        entries.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "entries.h"
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+void *Arena_Alloc(Arena_t *arena, size_t size)
+{
+    ArenaBlock_t *block = arena->head;
+
+    /* Keep every allocation aligned for any type */
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (block == NULL || block->size - block->used < size)
+    {
+        size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+
+        block = malloc(sizeof(ArenaBlock_t) + block_size);
+        if (block == NULL)
+        {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+
+        block->used = 0;
+        block->size = block_size;
+
+        /* An oversized block is filled at once => keep filling the current one afterwards */
+        if (arena->head != NULL && block_size > ARENA_BLOCK_SIZE)
+        {
+            block->next = arena->head->next;
+            arena->head->next = block;
+        }
+        else
+        {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+
+    return ptr;
+}
+
+char *Arena_StrDup(Arena_t *arena, const char *str, size_t len)
+{
+    char *copy = Arena_Alloc(arena, len + 1);
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+void Arena_Release(Arena_t *arena)
+{
+    ArenaBlock_t *block = arena->head;
+
+    while (block != NULL)
+    {
+        ArenaBlock_t *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    arena->head = NULL;
+}
+
+void Arena_Merge(Arena_t *dst, Arena_t *src)
+{
+    ArenaBlock_t *tail = src->head;
+
+    if (tail == NULL)
+    {
+        return;
+    }
+
+    while (tail->next != NULL)
+    {
+        tail = tail->next;
+    }
+
+    /* Chain the blocks behind the current head so dst keeps filling its own block */
+    if (dst->head == NULL)
+    {
+        dst->head = src->head;
+    }
+    else
+    {
+        tail->next = dst->head->next;
+        dst->head->next = src->head;
+    }
+
+    src->head = NULL;
+}
+
+void EntryTable_Init(EntryTable_t *table)
+{
+    table->items = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->names.head = NULL;
+    table->sorted = NULL;
+}
+
+FileEntry_t *EntryTable_Append(EntryTable_t *table, const char *name, size_t len)
+{
+    /* Grow geometrically so that appending stays amortized O(1) */
+    if (table->count == table->capacity)
+    {
+        size_t new_capacity = (table->capacity == 0) ? ENTRY_TABLE_INITIAL_CAPACITY : table->capacity * 2;
+        FileEntry_t *items = realloc(table->items, new_capacity * sizeof(FileEntry_t));
+
+        if (items == NULL)
+        {
+            perror("Memory allocation failed");
+            exit(1);
+        }
+
+        table->items = items;
+        table->capacity = new_capacity;
+    }
+
+    FileEntry_t *entry = &table->items[table->count++];
+    entry->name = Arena_StrDup(&table->names, name, len);
+    entry->link_target = NULL;
+    entry->link_status = PROPER_LINK;
+    entry->valid = 1;
+
+    return entry;
+}
+
+void EntryTable_Clear(EntryTable_t *table)
+{
+    free(table->sorted);
+    table->sorted = NULL;
+    table->count = 0;
+    Arena_Release(&table->names);
+}
+
+void EntryTable_Free(EntryTable_t *table)
+{
+    free(table->items);
+    free(table->sorted);
+    Arena_Release(&table->names);
+    EntryTable_Init(table);
+}
@@ -0,0 +1,154 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        entries.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _ENTRIES_H_
+#define _ENTRIES_H_
+
+#include <stddef.h>
+#include <sys/stat.h>
+
+/* Size of one arena block used to pack entry names */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Initial number of records reserved by an entry table */
+#define ENTRY_TABLE_INITIAL_CAPACITY 256
+
+/* State of a symbolic link's target */
+#define BROKEN_LINK 0
+#define PROPER_LINK 1
+
+/**
+ * @brief One directory entry together with its metadata.
+ *
+ * The record is created during the readdir pass of `do_ls` and completed once by the
+ * metadata phase (stat and symbolic link resolution), so that sorting and printing never
+ * have to call `lstat` or `readlink` again.
+ */
+typedef struct
+{
+    char *name;             /* Entry name, relative to the listed directory (arena owned) */
+    unsigned char d_type;   /* File type from the directory record (DT_*) */
+    ino_t d_ino;            /* Inode number from the directory record */
+    struct stat buf;        /* Result of lstat() on the entry */
+    char *link_target;      /* Target of a symbolic link, read in long format only (arena owned) */
+    int link_status;        /* BROKEN_LINK or PROPER_LINK for symbolic links */
+    int valid;              /* 0 once gathering the metadata failed */
+} FileEntry_t;
+
+/**
+ * @brief One block of a bump allocator.
+ */
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next; /* Previously filled block */
+    size_t used;             /* Bytes handed out from data[] */
+    size_t size;             /* Capacity of data[] */
+    char data[];
+} ArenaBlock_t;
+
+/**
+ * @brief Bump allocator whose memory is released all at once.
+ */
+typedef struct
+{
+    ArenaBlock_t *head; /* Block currently being filled */
+} Arena_t;
+
+/**
+ * @brief Growable vector of entry records with arena-backed names.
+ */
+typedef struct
+{
+    FileEntry_t *items; /* Entry records */
+    size_t count;       /* Number of used records */
+    size_t capacity;    /* Number of allocated records */
+    Arena_t names;      /* Storage for the entry names */
+    FileEntry_t **sorted; /* Records in display order, once sorted (see Sort_Entries) */
+} EntryTable_t;
+
+/**
+ * @brief Allocates memory from an arena.
+ *
+ * Allocations are served from the current block; a new block is chained when it runs out.
+ * Requests bigger than a block get a dedicated block. The program exits on allocation failure.
+ *
+ * @param arena The arena to allocate from.
+ * @param size Number of bytes needed.
+ *
+ * @return Pointer to the allocated bytes (valid until Arena_Release).
+ */
+void *Arena_Alloc(Arena_t *arena, size_t size);
+
+/**
+ * @brief Copies a string of known length into an arena.
+ *
+ * @param arena The arena to allocate from.
+ * @param str The string to copy.
+ * @param len Length of the string, excluding the terminating null byte.
+ *
+ * @return Pointer to the null-terminated copy.
+ */
+char *Arena_StrDup(Arena_t *arena, const char *str, size_t len);
+
+/**
+ * @brief Releases every block owned by an arena.
+ *
+ * @param arena The arena to release; it is left empty and can be reused.
+ */
+void Arena_Release(Arena_t *arena);
+
+/**
+ * @brief Moves every block of an arena into another one.
+ *
+ * Used to hand over memory allocated by a worker thread to the entry table.
+ *
+ * @param dst The arena receiving the blocks.
+ * @param src The arena giving the blocks; it is left empty.
+ */
+void Arena_Merge(Arena_t *dst, Arena_t *src);
+
+/**
+ * @brief Initializes an empty entry table.
+ *
+ * @param table The table to initialize.
+ */
+void EntryTable_Init(EntryTable_t *table);
+
+/**
+ * @brief Appends a new record to an entry table.
+ *
+ * The name is copied into the table's arena. The record's metadata is left for the caller to fill.
+ *
+ * @param table The table to append to.
+ * @param name The entry name.
+ * @param len Length of the entry name.
+ *
+ * @return Pointer to the new record (valid until the next append).
+ */
+FileEntry_t *EntryTable_Append(EntryTable_t *table, const char *name, size_t len);
+
+/**
+ * @brief Empties an entry table, keeping its records array for reuse.
+ *
+ * The names are released; pointers to previous records and names become invalid.
+ *
+ * @param table The table to empty.
+ */
+void EntryTable_Clear(EntryTable_t *table);
+
+/**
+ * @brief Frees the records and all names of an entry table in one go.
+ *
+ * @param table The table to free.
+ */
+void EntryTable_Free(EntryTable_t *table);
+
+#endif
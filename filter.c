@@ -0,0 +1,263 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        filter.c               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+#include <regex.h>
+
+#include "filter.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/* How a compiled pattern is matched, cheapest first */
+#define MATCH_LITERAL 0     /* No wildcard: the name is the pattern */
+#define MATCH_AFFIXES 1     /* One `*`: the prefix and the suffix decide */
+#define MATCH_GLOB 2        /* Prefix and suffix prefilter, then fnmatch */
+#define MATCH_REGEX 3       /* Prefix and suffix prefilter, then regexec */
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+void Filter_InitSet(FilterSet_t *set)
+{
+    set->patterns = NULL;
+    set->count = 0;
+    set->include_count = 0;
+    set->syntax = FILTER_SYNTAX_GLOB;
+    set->error = 0;
+    set->invalid = NULL;
+}
+
+void Filter_AddToSet(FilterSet_t *set, int kind, const char *pattern)
+{
+    FilterPattern_t *grown = realloc(set->patterns, (set->count + 1) * sizeof(FilterPattern_t));
+
+    if (grown == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    set->patterns = grown;
+    memset(&set->patterns[set->count], 0, sizeof(FilterPattern_t));
+    set->patterns[set->count].text = pattern;
+    set->patterns[set->count].kind = kind;
+    set->patterns[set->count].prefix = "";
+    set->patterns[set->count].suffix = "";
+    set->count++;
+
+    if (kind == FILTER_INCLUDE)
+    {
+        set->include_count++;
+    }
+}
+
+/**
+ * @brief Finds the literal prefix and suffix of a shell pattern and how it can be matched.
+ */
+static void CompileGlob(FilterPattern_t *pattern)
+{
+    const char *text = pattern->text;
+    size_t len = strlen(text);
+    size_t first = strcspn(text, "*?[]\\");
+    size_t last = first;
+    size_t wildcards = 0;
+
+    for (size_t i = first; i < len; i++)
+    {
+        if (strchr("*?[]\\", text[i]) != NULL)
+        {
+            last = i;
+            wildcards++;
+        }
+    }
+
+    pattern->prefix = text;
+    pattern->prefix_len = first;
+
+    if (first == len)
+    {
+        pattern->match = MATCH_LITERAL;
+        return;
+    }
+
+    pattern->suffix = text + last + 1;
+    pattern->suffix_len = len - last - 1;
+
+    /* `pre*suf`: the star takes whatever is between the prefix and the suffix */
+    pattern->match = (wildcards == 1 && text[first] == '*') ? MATCH_AFFIXES : MATCH_GLOB;
+}
+
+/**
+ * @brief Compiles a regular expression and finds the literal text its anchors imply.
+ *
+ * `^abc` gives the prefix "abc" and `xyz$` the suffix "xyz", as long as the literal run is
+ * not followed by a quantifier and the expression has no alternation.
+ *
+ * @return 0 on success, else the regcomp error code.
+ */
+static int CompileRegex(FilterPattern_t *pattern)
+{
+    const char *text = pattern->text;
+    const char *special = ".[]()*+?{}|\\^$";
+    size_t len = strlen(text);
+    int error = regcomp(&pattern->regex, text, REG_EXTENDED | REG_NOSUB);
+
+    if (error != 0)
+    {
+        return error;
+    }
+
+    pattern->match = MATCH_REGEX;
+
+    if (strchr(text, '|') != NULL)
+    {
+        return 0;
+    }
+
+    if (text[0] == '^')
+    {
+        size_t run = strcspn(text + 1, special);
+
+        /* A quantifier applies to the last character of the run */
+        if (run > 0 && text[1 + run] != '\0' && strchr("*+?{", text[1 + run]) != NULL)
+        {
+            run--;
+        }
+
+        pattern->prefix = text + 1;
+        pattern->prefix_len = run;
+    }
+
+    if (len >= 2 && text[len - 1] == '$' && text[len - 2] != '\\')
+    {
+        size_t run = 0;
+
+        while (run < len - 1 && strchr(special, text[len - 2 - run]) == NULL)
+        {
+            run++;
+        }
+
+        pattern->suffix = text + len - 1 - run;
+        pattern->suffix_len = run;
+    }
+
+    /* `^abc$`: the prefix and the suffix are the same text => keep one of them */
+    if (pattern->prefix_len > 0 && pattern->suffix_len > 0 && pattern->prefix + pattern->prefix_len > pattern->suffix)
+    {
+        pattern->suffix_len = 0;
+    }
+
+    return 0;
+}
+
+int Filter_CompileSet(FilterSet_t *set, int syntax)
+{
+    set->syntax = syntax;
+
+    for (size_t i = 0; i < set->count; i++)
+    {
+        if (syntax == FILTER_SYNTAX_REGEX)
+        {
+            set->error = CompileRegex(&set->patterns[i]);
+
+            if (set->error != 0)
+            {
+                /* Only the expressions compiled so far are freed */
+                set->invalid = set->patterns[i].text;
+                set->count = i;
+                return -1;
+            }
+        }
+        else
+        {
+            CompileGlob(&set->patterns[i]);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Tells whether a name matches a compiled pattern.
+ */
+static int Matches(const FilterPattern_t *pattern, const char *name, size_t name_len)
+{
+    if (pattern->match == MATCH_LITERAL)
+    {
+        return name_len == pattern->prefix_len && memcmp(name, pattern->prefix, name_len) == 0;
+    }
+
+    /* Prefilter: most names are rejected by their first or last bytes */
+    if (name_len < pattern->prefix_len + pattern->suffix_len ||
+        memcmp(name, pattern->prefix, pattern->prefix_len) != 0 ||
+        memcmp(name + name_len - pattern->suffix_len, pattern->suffix, pattern->suffix_len) != 0)
+    {
+        return 0;
+    }
+
+    switch (pattern->match)
+    {
+        /* A leading period is never matched by the star (FNM_PERIOD) */
+        case MATCH_AFFIXES: return pattern->prefix_len > 0 || name[0] != '.';
+        case MATCH_GLOB:    return fnmatch(pattern->text, name, FNM_PERIOD) == 0;
+        default:            return regexec(&pattern->regex, name, 0, NULL, 0) == 0;
+    }
+}
+
+int Filter_Matches(const FilterSet_t *set, const char *name, size_t name_len, int show_hidden)
+{
+    if (!show_hidden && (name[0] == '.'))
+    {
+        return 0;
+    }
+
+    int included = (set->include_count == 0);
+
+    for (size_t i = 0; i < set->count; i++)
+    {
+        const FilterPattern_t *pattern = &set->patterns[i];
+
+        /* Hide patterns only apply to the names that -a would not show anyway */
+        if ((pattern->kind == FILTER_HIDE && show_hidden) || (pattern->kind == FILTER_INCLUDE && included))
+        {
+            continue;
+        }
+
+        if (Matches(pattern, name, name_len))
+        {
+            if (pattern->kind != FILTER_INCLUDE)
+            {
+                return 0;
+            }
+            included = 1;
+        }
+    }
+
+    return included;
+}
+
+void Filter_FreeSet(FilterSet_t *set)
+{
+    if (set->syntax == FILTER_SYNTAX_REGEX)
+    {
+        for (size_t i = 0; i < set->count; i++)
+        {
+            regfree(&set->patterns[i].regex);
+        }
+    }
+
+    free(set->patterns);
+    Filter_InitSet(set);
+}
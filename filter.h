@@ -0,0 +1,107 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        filter.h               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _FILTER_H_
+#define _FILTER_H_
+
+#include <stddef.h>
+#include <regex.h>
+
+/* What a name matching a pattern does */
+#define FILTER_INCLUDE 0    /* --include: only matching names are listed */
+#define FILTER_EXCLUDE 1    /* --exclude, -I, --ignore: matching names are never listed */
+#define FILTER_HIDE 2       /* --hide: matching names are not listed, unless -a */
+
+/* Pattern syntaxes */
+#define FILTER_SYNTAX_GLOB 0    /* Shell patterns, as fnmatch with FNM_PERIOD */
+#define FILTER_SYNTAX_REGEX 1   /* POSIX extended regular expressions, unanchored (--regex) */
+
+/**
+ * @brief One pattern, compiled.
+ */
+typedef struct
+{
+    const char *text;       /* The pattern as given */
+    int kind;               /* FILTER_INCLUDE, FILTER_EXCLUDE or FILTER_HIDE */
+    int match;              /* How it is matched (see filter.c) */
+    const char *prefix;     /* Literal text every matching name starts with (points into text) */
+    size_t prefix_len;
+    const char *suffix;     /* Literal text every matching name ends with (points into text) */
+    size_t suffix_len;
+    regex_t regex;          /* Compiled expression (regular expression syntax) */
+} FilterPattern_t;
+
+/**
+ * @brief A set of patterns, applied together.
+ */
+typedef struct
+{
+    FilterPattern_t *patterns;
+    size_t count;
+    size_t include_count;   /* Number of include patterns (0 => every name is included) */
+    int syntax;             /* FILTER_SYNTAX_* they were compiled with */
+    int error;              /* regcomp error code of the invalid expression, 0 if none */
+    const char *invalid;    /* The invalid expression, NULL if none */
+} FilterSet_t;
+
+/**
+ * @brief Initializes an empty set (it accepts every name).
+ *
+ * @param set The set.
+ */
+void Filter_InitSet(FilterSet_t *set);
+
+/**
+ * @brief Adds a pattern to a set.
+ *
+ * @param set The set.
+ * @param kind FILTER_INCLUDE, FILTER_EXCLUDE or FILTER_HIDE.
+ * @param pattern The pattern (not copied: it must outlive the set).
+ */
+void Filter_AddToSet(FilterSet_t *set, int kind, const char *pattern);
+
+/**
+ * @brief Compiles the patterns of a set, once, before it is used.
+ *
+ * Every pattern gets a literal prefix and suffix that a matching name must have; patterns
+ * such as `*.c`, `core*` or `name` are then decided by these alone, the others only reach
+ * fnmatch or regexec when the prefix and suffix are present.
+ *
+ * @param set The set.
+ * @param syntax FILTER_SYNTAX_GLOB or FILTER_SYNTAX_REGEX.
+ *
+ * @return 0 on success, -1 if a regular expression is invalid (see set->error and set->invalid).
+ */
+int Filter_CompileSet(FilterSet_t *set, int syntax);
+
+/**
+ * @brief Tells whether a name passes a set.
+ *
+ * A compiled set is only read, so it can be used from several threads at the same time.
+ *
+ * @param set The compiled set.
+ * @param name The null-terminated name.
+ * @param name_len Its length.
+ * @param show_hidden 1 if names starting with '.' are listed (-a), which also disables hide
+ *        patterns.
+ *
+ * @return 1 if the name is listed, 0 if it is filtered out.
+ */
+int Filter_Matches(const FilterSet_t *set, const char *name, size_t name_len, int show_hidden);
+
+/**
+ * @brief Frees the compiled patterns of a set.
+ *
+ * @param set The set.
+ */
+void Filter_FreeSet(FilterSet_t *set);
+
+#endif
@@ -0,0 +1,288 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        idcache.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pwd.h>
+#include <grp.h>
+#include <pthread.h>
+
+#include "idcache.h"
+#include "stats.h"
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* Caches of the command line listings, shared by their threads */
+static IdCacheSet_t ProcessCaches;
+
+/* Serializes ProcessCaches */
+static pthread_mutex_t IdCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Spreads consecutive ids over the table (multiplicative hashing).
+ */
+static size_t HashId(unsigned int id, size_t capacity)
+{
+    return (size_t)((id * 2654435761U) & (capacity - 1));
+}
+
+/**
+ * @brief Finds the slot holding an id, or the free slot where it belongs.
+ */
+static IdCacheSlot_t *FindSlot(IdCache_t *cache, unsigned int id)
+{
+    size_t index = HashId(id, cache->capacity);
+
+    while (cache->slots[index].name != NULL && cache->slots[index].id != id)
+    {
+        index = (index + 1) & (cache->capacity - 1);
+    }
+
+    return &cache->slots[index];
+}
+
+/**
+ * @brief Doubles the table once it is 70% full (and allocates it on first use).
+ */
+static void Reserve(IdCache_t *cache)
+{
+    if (cache->slots != NULL && (cache->count + 1) * 10 < cache->capacity * 7)
+    {
+        return;
+    }
+
+    IdCache_t grown = *cache;
+    grown.capacity = (cache->slots == NULL) ? IDCACHE_INITIAL_CAPACITY : cache->capacity * 2;
+    grown.slots = calloc(grown.capacity, sizeof(IdCacheSlot_t));
+
+    if (grown.slots == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (size_t i = 0; cache->slots != NULL && i < cache->capacity; i++)
+    {
+        if (cache->slots[i].name != NULL)
+        {
+            *FindSlot(&grown, cache->slots[i].id) = cache->slots[i];
+        }
+    }
+
+    free(cache->slots);
+    *cache = grown;
+}
+
+/**
+ * @brief Asks the name service for the name of an id (reentrant lookups, so several caches can
+ *        resolve ids at the same time).
+ *
+ * @param id The id to resolve.
+ * @param is_group 1 to ask the group database, 0 for the user database.
+ * @param buffer Scratch buffer of the lookup; the returned name may point into it.
+ * @param size Size of the buffer.
+ *
+ * @return The name, NULL if the id has none, or (char *)-1 if the buffer is too small.
+ */
+static const char *AskNameService(unsigned int id, int is_group, char *buffer, size_t size)
+{
+    int error;
+
+    if (is_group)
+    {
+        struct group grp;
+        struct group *result = NULL;
+
+        error = getgrgid_r((gid_t)id, &grp, buffer, size, &result);
+        if (result != NULL)
+            return result->gr_name;
+    }
+    else
+    {
+        struct passwd pwd;
+        struct passwd *result = NULL;
+
+        error = getpwuid_r((uid_t)id, &pwd, buffer, size, &result);
+        if (result != NULL)
+            return result->pw_name;
+    }
+
+    return (error == ERANGE) ? (const char *)-1 : NULL;
+}
+
+/**
+ * @brief Resolves an id that is not in a cache and inserts it.
+ *
+ * @param cache The cache to use.
+ * @param slot The free slot where the id belongs (see FindSlot, after Reserve).
+ * @param id The id to resolve.
+ * @param is_group 1 to ask the group database, 0 for the user database.
+ */
+static const char *Insert(IdCache_t *cache, IdCacheSlot_t *slot, unsigned int id, int is_group)
+{
+    char stack_buffer[IDCACHE_LOOKUP_BUFFER_SIZE];
+    char *buffer = stack_buffer;
+    size_t size = sizeof(stack_buffer);
+    const char *name;
+    char number[16];
+
+    STATS_COUNT(STATS_NSS_LOOKUPS, 1);
+
+    /* Entries with many members (large groups) need a bigger buffer */
+    while ((name = AskNameService(id, is_group, buffer, size)) == (const char *)-1)
+    {
+        char *grown = (buffer == stack_buffer) ? malloc(size * 2) : realloc(buffer, size * 2);
+
+        if (grown == NULL)
+        {
+            name = NULL;
+            break;
+        }
+
+        buffer = grown;
+        size *= 2;
+    }
+
+    /* Unknown id => print the number, like ls does */
+    if (name == NULL)
+    {
+        snprintf(number, sizeof(number), "%u", id);
+        name = number;
+    }
+
+    slot->id = id;
+    slot->name = Arena_StrDup(&cache->names, name, strlen(name));
+    cache->count++;
+
+    if (buffer != stack_buffer)
+    {
+        free(buffer);
+    }
+
+    /* Names live in the arena, so they stay valid when the table grows */
+    return slot->name;
+}
+
+/**
+ * @brief Looks an id up in a cache, resolving and inserting it on a miss.
+ *
+ * @param cache The cache to use.
+ * @param id The id to resolve.
+ * @param is_group 1 to ask the group database, 0 for the user database.
+ */
+static const char *Lookup(IdCache_t *cache, unsigned int id, int is_group)
+{
+    Reserve(cache);
+
+    IdCacheSlot_t *slot = FindSlot(cache, id);
+    if (slot->name != NULL)
+    {
+        STATS_COUNT(STATS_ID_CACHE_HITS, 1);
+        return slot->name;
+    }
+
+    return Insert(cache, slot, id, is_group);
+}
+
+/**
+ * @brief Looks an id up in the process-wide caches.
+ */
+static const char *LookupShared(IdCache_t *cache, unsigned int id, int is_group)
+{
+    pthread_mutex_lock(&IdCacheLock);
+    const char *name = Lookup(cache, id, is_group);
+    pthread_mutex_unlock(&IdCacheLock);
+
+    return name;
+}
+
+/**
+ * @brief Makes sure an id is in a cache, without counting a hit (IdCacheLock must be held).
+ */
+static void Prewarm(IdCache_t *cache, unsigned int id, int is_group)
+{
+    Reserve(cache);
+
+    IdCacheSlot_t *slot = FindSlot(cache, id);
+    if (slot->name == NULL)
+    {
+        Insert(cache, slot, id, is_group);
+    }
+}
+
+const char *IdCache_UserName(uid_t uid)
+{
+    return LookupShared(&ProcessCaches.users, (unsigned int)uid, 0);
+}
+
+const char *IdCache_GroupName(gid_t gid)
+{
+    return LookupShared(&ProcessCaches.groups, (unsigned int)gid, 1);
+}
+
+void IdCache_Prewarm(FileEntry_t *const entries[], size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    /* One lock for the whole table; runs of the same owner (the common case) are probed once */
+    pthread_mutex_lock(&IdCacheLock);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uid_t uid = entries[i]->buf.st_uid;
+        gid_t gid = entries[i]->buf.st_gid;
+
+        if (i == 0 || uid != entries[i - 1]->buf.st_uid)
+        {
+            Prewarm(&ProcessCaches.users, (unsigned int)uid, 0);
+        }
+
+        if (i == 0 || gid != entries[i - 1]->buf.st_gid)
+        {
+            Prewarm(&ProcessCaches.groups, (unsigned int)gid, 1);
+        }
+    }
+
+    pthread_mutex_unlock(&IdCacheLock);
+}
+
+void IdCache_InitSet(IdCacheSet_t *set)
+{
+    memset(set, 0, sizeof(*set));
+}
+
+const char *IdCache_LookupUser(IdCacheSet_t *set, uid_t uid)
+{
+    return Lookup(&set->users, (unsigned int)uid, 0);
+}
+
+const char *IdCache_LookupGroup(IdCacheSet_t *set, gid_t gid)
+{
+    return Lookup(&set->groups, (unsigned int)gid, 1);
+}
+
+void IdCache_FreeSet(IdCacheSet_t *set)
+{
+    free(set->users.slots);
+    free(set->groups.slots);
+    Arena_Release(&set->users.names);
+    Arena_Release(&set->groups.names);
+    memset(set, 0, sizeof(*set));
+}
@@ -0,0 +1,126 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        idcache.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _IDCACHE_H_
+#define _IDCACHE_H_
+
+#include <sys/types.h>
+
+#include "entries.h"
+
+/* Initial number of slots of each cache (must be a power of two) */
+#define IDCACHE_INITIAL_CAPACITY 64
+
+/* Scratch buffer of a name service lookup (doubled while the entry does not fit) */
+#define IDCACHE_LOOKUP_BUFFER_SIZE 1024
+
+/**
+ * @brief One slot of an id cache.
+ */
+typedef struct
+{
+    unsigned int id;    /* uid or gid */
+    const char *name;   /* Resolved name, NULL if the slot is free */
+} IdCacheSlot_t;
+
+/**
+ * @brief Open-addressed (linear probing) table mapping ids to names.
+ */
+typedef struct
+{
+    IdCacheSlot_t *slots;
+    size_t capacity;    /* Number of slots, a power of two */
+    size_t count;       /* Number of used slots */
+    Arena_t names;      /* Storage for the names */
+} IdCache_t;
+
+/**
+ * @brief User and group caches owned by one caller (e.g. a liblsr listing).
+ */
+typedef struct
+{
+    IdCache_t users;
+    IdCache_t groups;
+} IdCacheSet_t;
+
+/**
+ * @brief Returns the user name of a uid.
+ *
+ * The name service is asked only the first time a uid is seen; the answer is cached for the
+ * rest of the run. A uid without a name is returned as its decimal number. These process-wide
+ * caches are protected by a lock, so the function can be called from several threads.
+ *
+ * @param uid The user id.
+ *
+ * @return The user name (valid for the rest of the run).
+ */
+const char *IdCache_UserName(uid_t uid);
+
+/**
+ * @brief Returns the group name of a gid.
+ *
+ * Same behavior as IdCache_UserName, for groups.
+ *
+ * @param gid The group id.
+ *
+ * @return The group name (valid for the rest of the run).
+ */
+const char *IdCache_GroupName(gid_t gid);
+
+/**
+ * @brief Resolves the owners and groups of a set of entries ahead of formatting.
+ *
+ * Each distinct uid/gid is looked up once, under a single acquisition of the lock, so formatting
+ * afterwards only hits the cache. The probes made here are not counted as cache hits.
+ *
+ * @param entries Array of pointers to entry records.
+ * @param count Number of entries.
+ */
+void IdCache_Prewarm(FileEntry_t *const entries[], size_t count);
+
+/**
+ * @brief Prepares an empty set of caches.
+ *
+ * @param set The set.
+ */
+void IdCache_InitSet(IdCacheSet_t *set);
+
+/**
+ * @brief Returns the user name of a uid, like IdCache_UserName, from a set of caches.
+ *
+ * The set is not locked: it must not be used by several threads at the same time. The name
+ * service is asked with reentrant lookups, so different sets can be used at the same time.
+ *
+ * @param set The set.
+ * @param uid The user id.
+ *
+ * @return The user name (valid until IdCache_FreeSet).
+ */
+const char *IdCache_LookupUser(IdCacheSet_t *set, uid_t uid);
+
+/**
+ * @brief Returns the group name of a gid, like IdCache_GroupName, from a set of caches.
+ *
+ * @param set The set.
+ * @param gid The group id.
+ *
+ * @return The group name (valid until IdCache_FreeSet).
+ */
+const char *IdCache_LookupGroup(IdCacheSet_t *set, gid_t gid);
+
+/**
+ * @brief Releases the tables and names of a set.
+ *
+ * @param set The set.
+ */
+void IdCache_FreeSet(IdCacheSet_t *set);
+
+#endif
@@ -0,0 +1,188 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        linkcache.c            ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "entries.h"
+#include "linkcache.h"
+#include "stats.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief One slot of the link cache.
+ */
+typedef struct
+{
+    LinkDir_t dir;          /* Directory of the link (zero for absolute targets) */
+    const char *target;     /* Target text, NULL if the slot is free */
+    size_t hash;
+    LinkTarget_t result;
+} LinkCacheSlot_t;
+
+/**
+ * @brief Open-addressed (linear probing) table mapping link targets to their resolution.
+ */
+typedef struct
+{
+    LinkCacheSlot_t *slots;
+    size_t capacity;    /* Number of slots, a power of two */
+    size_t count;       /* Number of used slots */
+    Arena_t targets;    /* Storage for the target texts */
+} LinkCache_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+static LinkCache_t Cache;
+
+static pthread_mutex_t LinkCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Gives the key of a target: absolute targets do not depend on the directory.
+ */
+static LinkDir_t KeyDir(const LinkDir_t *dir, const char *target)
+{
+    LinkDir_t key = { 0, 0 };
+
+    if (target[0] != '/')
+    {
+        key = *dir;
+    }
+
+    return key;
+}
+
+/**
+ * @brief Hashes a key (FNV-1a over the target, mixed with the directory identity).
+ */
+static size_t HashKey(const LinkDir_t *dir, const char *target)
+{
+    uint64_t hash = 14695981039346656037ULL ^ ((uint64_t)dir->dev * 31 + (uint64_t)dir->ino);
+
+    for (const unsigned char *c = (const unsigned char *)target; *c != '\0'; c++)
+    {
+        hash = (hash ^ *c) * 1099511628211ULL;
+    }
+
+    return (size_t)hash;
+}
+
+/**
+ * @brief Finds the slot holding a key, or the free slot where it belongs.
+ */
+static LinkCacheSlot_t *FindSlot(LinkCache_t *cache, const LinkDir_t *dir, const char *target, size_t hash)
+{
+    size_t index = hash & (cache->capacity - 1);
+
+    while (cache->slots[index].target != NULL &&
+           (cache->slots[index].hash != hash || cache->slots[index].dir.dev != dir->dev ||
+            cache->slots[index].dir.ino != dir->ino || strcmp(cache->slots[index].target, target) != 0))
+    {
+        index = (index + 1) & (cache->capacity - 1);
+    }
+
+    return &cache->slots[index];
+}
+
+/**
+ * @brief Doubles the table once it is 70% full (and allocates it on first use).
+ */
+static void Reserve(LinkCache_t *cache)
+{
+    if (cache->slots != NULL && (cache->count + 1) * 10 < cache->capacity * 7)
+    {
+        return;
+    }
+
+    LinkCache_t grown = *cache;
+    grown.capacity = (cache->slots == NULL) ? LINKCACHE_INITIAL_CAPACITY : cache->capacity * 2;
+    grown.slots = calloc(grown.capacity, sizeof(LinkCacheSlot_t));
+
+    if (grown.slots == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (size_t i = 0; cache->slots != NULL && i < cache->capacity; i++)
+    {
+        const LinkCacheSlot_t *slot = &cache->slots[i];
+
+        if (slot->target != NULL)
+        {
+            *FindSlot(&grown, &slot->dir, slot->target, slot->hash) = *slot;
+        }
+    }
+
+    free(cache->slots);
+    *cache = grown;
+}
+
+int LinkCache_Find(const LinkDir_t *dir, const char *target, LinkTarget_t *result)
+{
+    LinkDir_t key = KeyDir(dir, target);
+    size_t hash = HashKey(&key, target);
+    int found = 0;
+
+    pthread_mutex_lock(&LinkCacheLock);
+
+    if (Cache.slots != NULL)
+    {
+        LinkCacheSlot_t *slot = FindSlot(&Cache, &key, target, hash);
+
+        if (slot->target != NULL)
+        {
+            *result = slot->result;
+            found = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&LinkCacheLock);
+
+    if (found)
+    {
+        STATS_COUNT(STATS_LINK_CACHE_HITS, 1);
+    }
+
+    return found;
+}
+
+void LinkCache_Store(const LinkDir_t *dir, const char *target, const LinkTarget_t *result)
+{
+    LinkDir_t key = KeyDir(dir, target);
+    size_t hash = HashKey(&key, target);
+
+    pthread_mutex_lock(&LinkCacheLock);
+
+    Reserve(&Cache);
+
+    LinkCacheSlot_t *slot = FindSlot(&Cache, &key, target, hash);
+
+    /* Another thread may have resolved the same target in the meantime */
+    if (slot->target == NULL)
+    {
+        slot->dir = key;
+        slot->target = Arena_StrDup(&Cache.targets, target, strlen(target));
+        slot->hash = hash;
+        slot->result = *result;
+        Cache.count++;
+    }
+
+    pthread_mutex_unlock(&LinkCacheLock);
+}
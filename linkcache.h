@@ -0,0 +1,65 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        linkcache.h            ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _LINKCACHE_H_
+#define _LINKCACHE_H_
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* Initial number of slots of the cache (must be a power of two) */
+#define LINKCACHE_INITIAL_CAPACITY 256
+
+/**
+ * @brief Identity of the directory holding symbolic links (relative targets depend on it).
+ */
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+} LinkDir_t;
+
+/**
+ * @brief What a symbolic link target resolves to.
+ */
+typedef struct
+{
+    int status;         /* BROKEN_LINK or PROPER_LINK */
+    struct stat buf;    /* Status of the final target (valid for PROPER_LINK) */
+} LinkTarget_t;
+
+/**
+ * @brief Looks a symbolic link target up.
+ *
+ * Targets are keyed by their text and, for relative targets, by the directory holding the
+ * link, so links of a farm pointing at the same file share one entry. A link whose target is
+ * not read is keyed by its own identity and an empty target instead (readlink never returns
+ * an empty target). The cache lives for the rest of the run and is protected by a lock, so it
+ * can be used from several threads.
+ *
+ * @param dir The directory holding the link (or the link itself, with an empty target).
+ * @param target The target, as read by readlink, or "".
+ * @param result Output: the cached resolution.
+ *
+ * @return 1 on a hit, 0 if the target is not cached.
+ */
+int LinkCache_Find(const LinkDir_t *dir, const char *target, LinkTarget_t *result);
+
+/**
+ * @brief Stores the resolution of a symbolic link target.
+ *
+ * @param dir The directory holding the link (or the link itself, with an empty target).
+ * @param target The target, as read by readlink (copied), or "".
+ * @param result Its resolution.
+ */
+void LinkCache_Store(const LinkDir_t *dir, const char *target, const LinkTarget_t *result);
+
+#endif
@@ -0,0 +1,369 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        lsr.c                  ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lsr.h"
+#include "lsrread.h"
+#include "entries.h"
+#include "filter.h"
+#include "idcache.h"
+#include "metadata.h"
+#include "options.h"
+#include "outbuf.h"
+#include "records.h"
+#include "sort.h"
+#include "timefmt.h"
+#include "utils.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/* Entries are stat'ed for every field of struct stat */
+#define LSR_STAT_MASK (STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID | STATX_ATIME | \
+                       STATX_MTIME | STATX_CTIME | STATX_INO | STATX_SIZE | STATX_BLOCKS)
+
+/**
+ * @brief State of one listing.
+ */
+struct Lsr
+{
+    Options_t options;      /* Options of the listing, as myls would have them (-a and the patterns) */
+    LsrReader_t reader;     /* Read phase, shared with myls */
+    EntryTable_t table;     /* Every entry (sorted), or the current batch (unsorted) */
+    FilterSet_t filter;     /* Patterns */
+    Arena_t patterns;       /* Copies of the pattern texts */
+    int sort;               /* LSR_SORT_* */
+    size_t next;            /* Next entry of the table to return */
+    FileEntry_t *current;   /* Last entry returned */
+    LsrEntry_t view;        /* Its public part */
+    OutBuf_t format;        /* Scratch buffer of Lsr_Format */
+    TimeFormatter_t time_formatter;     /* Timestamps of Lsr_Format */
+    IdCacheSet_t ids;                   /* Owner and group names of Lsr_Format */
+};
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+void Lsr_InitOptions(LsrOptions_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->sort = LSR_SORT_NAME;
+}
+
+/**
+ * @brief Copies patterns into the listing and adds them to its filter.
+ */
+static void AddPatterns(Lsr_t *lsr, int kind, const char *const *patterns, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        Filter_AddToSet(&lsr->filter, kind, Arena_StrDup(&lsr->patterns, patterns[i], strlen(patterns[i])));
+    }
+}
+
+/**
+ * @brief Marks the entries of the table as not stat'ed yet (no link count).
+ */
+static void ClearStatus(Lsr_t *lsr)
+{
+    for (size_t i = 0; i < lsr->table.count; i++)
+    {
+        memset(&lsr->table.items[i].buf, 0, sizeof(lsr->table.items[i].buf));
+    }
+}
+
+/**
+ * @brief Reads and sorts a whole directory (the time and size orders stat every entry).
+ *
+ * @return 0 on success, -1 on a read error.
+ */
+static int ReadSorted(Lsr_t *lsr)
+{
+    if (LsrReader_ReadAll(&lsr->reader) < 0)
+    {
+        return -1;
+    }
+
+    ClearStatus(lsr);
+
+    if (lsr->sort >= LSR_SORT_MTIME && lsr->sort <= LSR_SORT_SIZE)
+    {
+        for (size_t i = 0; i < lsr->table.count; i++)
+        {
+            FileEntry_t *entry = &lsr->table.items[i];
+
+            /* An entry that cannot be stat'ed sorts as empty and is stat'ed again if asked */
+            if (Metadata_Fetch(&lsr->options, lsr->reader.reader.fd, entry->name, LSR_STAT_MASK, &entry->buf) < 0)
+            {
+                memset(&entry->buf, 0, sizeof(entry->buf));
+            }
+        }
+    }
+
+    return 0;
+}
+
+int Lsr_Open(Lsr_t **lsr, const char *dir, const LsrOptions_t *options)
+{
+    LsrOptions_t defaults;
+
+    if (options == NULL)
+    {
+        Lsr_InitOptions(&defaults);
+        options = &defaults;
+    }
+
+    if (options->sort < LSR_SORT_NONE || options->sort > LSR_SORT_VERSION)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Lsr_t *listing = malloc(sizeof(Lsr_t));
+    if (listing == NULL)
+    {
+        return -1;
+    }
+
+    Options_Init(&listing->options);
+    listing->options.flags[SHOW_HIDDEN_OPTION_a] = options->show_hidden;
+    listing->options.filter = &listing->filter;
+    listing->sort = options->sort;
+    listing->next = 0;
+    listing->current = NULL;
+    listing->patterns.head = NULL;
+    EntryTable_Init(&listing->table);
+    OutBuf_Init(&listing->format, -1, 0);
+    Filter_InitSet(&listing->filter);
+
+    AddPatterns(listing, FILTER_INCLUDE, options->include, options->include_count);
+    AddPatterns(listing, FILTER_EXCLUDE, options->exclude, options->exclude_count);
+
+    if (Filter_CompileSet(&listing->filter, options->regex ? FILTER_SYNTAX_REGEX : FILTER_SYNTAX_GLOB) < 0)
+    {
+        Filter_FreeSet(&listing->filter);
+        Arena_Release(&listing->patterns);
+        OutBuf_Free(&listing->format);
+        EntryTable_Free(&listing->table);
+        free(listing);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (LsrReader_Open(&listing->reader, dir, &listing->options, &listing->table) < 0)
+    {
+        int error = errno;
+
+        Filter_FreeSet(&listing->filter);
+        Arena_Release(&listing->patterns);
+        OutBuf_Free(&listing->format);
+        EntryTable_Free(&listing->table);
+        free(listing);
+        errno = error;
+        return -1;
+    }
+
+    /* Own formatter and name caches => nothing is shared with other listings */
+    TimeFmt_InitFormatter(&listing->time_formatter, TIME_STYLE_DEFAULT);
+    IdCache_InitSet(&listing->ids);
+
+    if (listing->sort != LSR_SORT_NONE)
+    {
+        if (ReadSorted(listing) < 0)
+        {
+            int error = errno;
+            Lsr_Close(listing);
+            errno = error;
+            return -1;
+        }
+
+        Sort_Entries(&listing->table, listing->sort, options->reverse);
+    }
+
+    *lsr = listing;
+    return 0;
+}
+
+int Lsr_Next(Lsr_t *lsr, const LsrEntry_t **entry)
+{
+    if (lsr->sort != LSR_SORT_NONE)
+    {
+        if (lsr->next >= lsr->table.count)
+        {
+            return 0;
+        }
+
+        lsr->current = lsr->table.sorted[lsr->next++];
+    }
+    else
+    {
+        /* Directory order => forget the returned batch and read the next one */
+        while (lsr->next >= lsr->table.count)
+        {
+            if (lsr->reader.end)
+            {
+                return 0;
+            }
+
+            EntryTable_Clear(&lsr->table);
+            lsr->next = 0;
+            lsr->current = NULL;
+
+            if (LsrReader_ReadBatch(&lsr->reader, LSR_BATCH_MAX_ENTRIES) < 0)
+            {
+                return -1;
+            }
+
+            ClearStatus(lsr);
+        }
+
+        lsr->current = &lsr->table.items[lsr->next++];
+    }
+
+    lsr->view.name = lsr->current->name;
+    lsr->view.name_len = strlen(lsr->current->name);
+    lsr->view.d_type = lsr->current->d_type;
+    lsr->view.ino = lsr->current->d_ino;
+
+    *entry = &lsr->view;
+    return 1;
+}
+
+const struct stat *Lsr_Stat(Lsr_t *lsr)
+{
+    FileEntry_t *entry = lsr->current;
+
+    if (entry == NULL)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Entries that were not stat'ed yet have no link count */
+    if (entry->buf.st_nlink == 0 && Metadata_Fetch(&lsr->options, lsr->reader.reader.fd, entry->name, LSR_STAT_MASK, &entry->buf) < 0)
+    {
+        memset(&entry->buf, 0, sizeof(entry->buf));
+        return NULL;
+    }
+
+    return &entry->buf;
+}
+
+const char *Lsr_LinkTarget(Lsr_t *lsr)
+{
+    const struct stat *buf = Lsr_Stat(lsr);
+
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    if (!S_ISLNK(buf->st_mode))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    FileEntry_t *entry = lsr->current;
+
+    if (entry->link_target == NULL)
+    {
+        /* The link size is the length of its target => no fixed path limit */
+        size_t target_size = (buf->st_size > 0) ? (size_t)buf->st_size + 1 : PATH_MAX;
+        char *target = Arena_Alloc(&lsr->table.names, target_size);
+        ssize_t len = readlinkat(lsr->reader.reader.fd, entry->name, target, target_size - 1);
+
+        if (len < 0)
+        {
+            return NULL;
+        }
+
+        target[len] = '\0';
+        entry->link_target = target;
+    }
+
+    return entry->link_target;
+}
+
+long Lsr_Format(Lsr_t *lsr, int format, char *buf, size_t size)
+{
+    OutBuf_t *out = &lsr->format;
+
+    out->len = 0;
+
+    if (format == LSR_FORMAT_NAME)
+    {
+        if (lsr->current == NULL)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+
+        OutBuf_Puts(out, lsr->current->name);
+    }
+    else
+    {
+        if (Lsr_Stat(lsr) == NULL)
+        {
+            return -1;
+        }
+
+        /* A link that cannot be read is shown without its target */
+        if (S_ISLNK(lsr->current->buf.st_mode))
+        {
+            Lsr_LinkTarget(lsr);
+        }
+
+        if (format == LSR_FORMAT_LONG)
+        {
+            LongFormat_t long_format = { 0, 0, LONG_FORMAT_MTIME, 0, TIME_STYLE_DEFAULT, &lsr->time_formatter, &lsr->ids };
+            FormatEntry_Long(out, lsr->current, &long_format);
+        }
+        else
+        {
+            Records_WriteJson(out, NULL, lsr->current);
+
+            /* Lines are returned without their line break */
+            out->len--;
+        }
+    }
+
+    if (size > 0)
+    {
+        size_t copied = (out->len < size - 1) ? out->len : size - 1;
+        memcpy(buf, out->data, copied);
+        buf[copied] = '\0';
+    }
+
+    return (long)out->len;
+}
+
+void Lsr_Close(Lsr_t *lsr)
+{
+    if (lsr == NULL)
+    {
+        return;
+    }
+
+    LsrReader_Close(&lsr->reader);
+    EntryTable_Free(&lsr->table);
+    Filter_FreeSet(&lsr->filter);
+    Arena_Release(&lsr->patterns);
+    OutBuf_Free(&lsr->format);
+    IdCache_FreeSet(&lsr->ids);
+    free(lsr);
+}
@@ -0,0 +1,153 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        lsr.h                  ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _LSR_H_
+#define _LSR_H_
+
+/* liblsr: directory listings for programs that embed them instead of running myls. A listing
+   keeps all its state in its context (options, reader, entries, filter, time formatter and
+   user/group name caches) and reads the directory through the same code as myls, so any number
+   of listings can run at the same time, one per thread. Nothing is printed: errors are returned
+   through errno. */
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* Sort orders (the SORT_* values of sort.h) */
+#define LSR_SORT_NONE 0         /* Directory order: entries are read batch by batch */
+#define LSR_SORT_NAME 1         /* Name, ignoring case */
+#define LSR_SORT_MTIME 2        /* Newest modification first */
+#define LSR_SORT_ATIME 3        /* Newest access first */
+#define LSR_SORT_CTIME 4        /* Newest status change first */
+#define LSR_SORT_SIZE 5         /* Largest first */
+#define LSR_SORT_EXTENSION 6    /* Extension, then name */
+#define LSR_SORT_VERSION 7      /* Name with numbers compared by value */
+
+/* Largest batch of an unsorted listing when the directory is read with readdir; with
+   getdents64 a batch is one buffer */
+#define LSR_BATCH_MAX_ENTRIES 4096
+
+/* Formats of Lsr_Format */
+#define LSR_FORMAT_NAME 0       /* The name alone */
+#define LSR_FORMAT_LONG 1       /* The line of `myls -l`, without colors */
+#define LSR_FORMAT_JSON 2       /* The object of `myls --json`, without the "dir" field */
+
+/**
+ * @brief Options of one listing.
+ */
+typedef struct
+{
+    int show_hidden;                /* List the names starting with '.' (-a) */
+    int sort;                       /* LSR_SORT_* */
+    int reverse;                    /* Reverse the order (-r) */
+    int regex;                      /* Patterns are POSIX extended regular expressions, not globs */
+    const char *const *include;     /* Only list the names matching one of these (--include) */
+    size_t include_count;
+    const char *const *exclude;     /* Never list the names matching one of these (--exclude) */
+    size_t exclude_count;
+} LsrOptions_t;
+
+/**
+ * @brief An entry as returned by Lsr_Next, valid until the next call on the listing.
+ */
+typedef struct
+{
+    const char *name;       /* Null-terminated name */
+    size_t name_len;
+    unsigned char d_type;   /* DT_* type from the directory record (DT_UNKNOWN on some file systems) */
+    ino_t ino;              /* Inode number from the directory record */
+} LsrEntry_t;
+
+/**
+ * @brief An open listing (opaque).
+ */
+typedef struct Lsr Lsr_t;
+
+/**
+ * @brief Fills options with the defaults: visible names only, sorted by name, no patterns.
+ *
+ * @param options The options.
+ */
+void Lsr_InitOptions(LsrOptions_t *options);
+
+/**
+ * @brief Opens a listing of a directory.
+ *
+ * The patterns are copied and compiled here, so the options can be released once this
+ * returns. Sorted listings read every name now (and stat them for the time and size orders);
+ * unsorted ones read the directory batch by batch as the entries are pulled, in constant
+ * memory, and ignore `reverse`.
+ *
+ * @param lsr Output: the listing, to be closed with Lsr_Close.
+ * @param dir The directory path.
+ * @param options Its options (NULL => the defaults).
+ *
+ * @return 0 on success, -1 on failure with errno set (EINVAL for an invalid regular expression).
+ */
+int Lsr_Open(Lsr_t **lsr, const char *dir, const LsrOptions_t *options);
+
+/**
+ * @brief Pulls the next entry of a listing.
+ *
+ * @param lsr The listing.
+ * @param entry Output: the entry, valid until the next call on the listing.
+ *
+ * @return 1 if an entry was returned, 0 at the end of the listing, -1 on a read error (errno).
+ */
+int Lsr_Next(Lsr_t *lsr, const LsrEntry_t **entry);
+
+/**
+ * @brief Returns the status of the last entry pulled, as lstat gives it.
+ *
+ * The entry is stat'ed on the first call only (relative to the directory descriptor), and not
+ * at all if the caller never asks.
+ *
+ * @param lsr The listing.
+ *
+ * @return The status, valid until the next call to Lsr_Next, or NULL on failure (errno).
+ */
+const struct stat *Lsr_Stat(Lsr_t *lsr);
+
+/**
+ * @brief Returns the target of the last entry pulled, if it is a symbolic link.
+ *
+ * @param lsr The listing.
+ *
+ * @return The target, valid until the next call to Lsr_Next, or NULL if the entry is not a
+ *         link or the link cannot be read (errno).
+ */
+const char *Lsr_LinkTarget(Lsr_t *lsr);
+
+/**
+ * @brief Formats the last entry pulled, as snprintf does: at most size - 1 bytes and a null
+ *        byte are written, and the full length is returned.
+ *
+ * Lines end without a line break. The entry is stat'ed (and its link read) as the format needs.
+ * Long lines use the default time style of myls, with the time of Lsr_Open as "now".
+ *
+ * @param lsr The listing.
+ * @param format LSR_FORMAT_NAME, LSR_FORMAT_LONG or LSR_FORMAT_JSON.
+ * @param buf The destination (may be NULL if size is 0).
+ * @param size Its size.
+ *
+ * @return The length of the formatted entry, or -1 if it could not be stat'ed (errno).
+ */
+long Lsr_Format(Lsr_t *lsr, int format, char *buf, size_t size);
+
+/**
+ * @brief Closes a listing and releases everything it holds.
+ *
+ * @param lsr The listing (NULL is ignored).
+ */
+void Lsr_Close(Lsr_t *lsr);
+
+#endif
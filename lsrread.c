@@ -0,0 +1,76 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        lsrread.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdint.h>
+
+#include "lsrread.h"
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+int LsrReader_Open(LsrReader_t *reader, const char *dir, const Options_t *options, EntryTable_t *table)
+{
+    reader->options = options;
+    reader->table = table;
+    reader->end = 0;
+
+    return DirReader_Open(&reader->reader, dir, options->dir_buffer_size);
+}
+
+int LsrReader_ReadBatch(LsrReader_t *reader, size_t max_entries)
+{
+    DirRecord_t record;
+    int status;
+
+    if (reader->end)
+    {
+        return 0;
+    }
+
+    while ((status = DirReader_Next(&reader->reader, &record)) > 0)
+    {
+        /* Hidden files without -a, and names filtered out by the patterns, are skipped
+           before anything is copied or stat'ed */
+        if (Options_Accept(reader->options, record.name, record.name_len))
+        {
+            FileEntry_t *file_entry = EntryTable_Append(reader->table, record.name, record.name_len);
+            file_entry->d_type = record.d_type;
+            file_entry->d_ino = record.d_ino;
+        }
+
+        if (DirReader_BatchDone(&reader->reader) || reader->table->count >= max_entries)
+        {
+            return 1;
+        }
+    }
+
+    reader->end = 1;
+    return status;
+}
+
+int LsrReader_ReadAll(LsrReader_t *reader)
+{
+    int status;
+
+    do
+    {
+        status = LsrReader_ReadBatch(reader, SIZE_MAX);
+    }
+    while (status > 0);
+
+    return status;
+}
+
+void LsrReader_Close(LsrReader_t *reader)
+{
+    DirReader_Close(&reader->reader);
+}
@@ -0,0 +1,78 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        lsrread.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _LSRREAD_H_
+#define _LSRREAD_H_
+
+#include <stddef.h>
+
+#include "dirread.h"
+#include "entries.h"
+#include "options.h"
+
+/**
+ * @brief Read phase of a listing: the records of a directory that its options accept, copied
+ *        into a table of entries.
+ *
+ * myls (sorted, streamed and --head listings) and the liblsr contexts all read through it, so
+ * hidden names and patterns are skipped the same way everywhere, before anything is copied.
+ */
+typedef struct
+{
+    const Options_t *options;   /* Options of the listing (hidden names, patterns, buffer size) */
+    DirReader_t reader;         /* The open directory */
+    EntryTable_t *table;        /* Table receiving the entries (owned by the caller) */
+    int end;                    /* Every record was read */
+} LsrReader_t;
+
+/**
+ * @brief Opens a directory for a listing.
+ *
+ * @param reader The reader state to initialize.
+ * @param dir The directory path.
+ * @param options The options of the listing (kept until LsrReader_Close).
+ * @param table The table receiving the entries (kept until LsrReader_Close).
+ *
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int LsrReader_Open(LsrReader_t *reader, const char *dir, const Options_t *options, EntryTable_t *table);
+
+/**
+ * @brief Appends the next accepted records to the table, up to the end of a batch.
+ *
+ * A batch ends with the records returned by one getdents64 call, or when the table holds
+ * max_entries entries (the only limit of the readdir backend). The entries keep the type and
+ * inode of their record; their status is not filled.
+ *
+ * @param reader The reader state.
+ * @param max_entries Size of the table at which reading stops.
+ *
+ * @return 1 if records may remain, 0 at the end of the directory, -1 on a read error (errno).
+ */
+int LsrReader_ReadBatch(LsrReader_t *reader, size_t max_entries);
+
+/**
+ * @brief Appends every remaining accepted record to the table.
+ *
+ * @param reader The reader state.
+ *
+ * @return 0 on success, -1 on a read error (errno); the records read before it are kept.
+ */
+int LsrReader_ReadAll(LsrReader_t *reader);
+
+/**
+ * @brief Closes the directory (the table is left to the caller).
+ *
+ * @param reader The reader state.
+ */
+void LsrReader_Close(LsrReader_t *reader);
+
+#endif
@@ -17,82 +17,352 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <regex.h>
 
 #include "utils.h"
 #include "options.h"
+#include "outbuf.h"
+#include "colors.h"
+#include "timefmt.h"
+#include "walk.h"
+#include "records.h"
+#include "stats.h"
+#include "watch.h"
+#include "args.h"
+#include "du.h"
+#include "filter.h"
 
 
 /**************************            GLOBAL VARIABLES           *******************************/
 
-
 extern char *optarg;
 extern int optind, opterr, optopt;
 
-/* Array to carry the state of options */
-extern int OptionsFlags[9];
+/* Long options */
+static const struct option LongOptions[] =
+{
+    { "dirbuf",        required_argument, NULL, DIRBUF_LONG_OPTION },
+    { "dont-sync",     no_argument,       NULL, DONT_SYNC_LONG_OPTION },
+    { "no-exec-color", no_argument,       NULL, NO_EXEC_COLOR_LONG_OPTION },
+    { "jobs",          required_argument, NULL, JOBS_LONG_OPTION },
+    { "io",            required_argument, NULL, IO_LONG_OPTION },
+    { "time-style",    required_argument, NULL, TIME_STYLE_LONG_OPTION },
+    { "head",          required_argument, NULL, HEAD_LONG_OPTION },
+    { "newest",        required_argument, NULL, NEWEST_LONG_OPTION },
+    { "largest",       required_argument, NULL, LARGEST_LONG_OPTION },
+    { "zero",          no_argument,       NULL, ZERO_LONG_OPTION },
+    { "json",          no_argument,       NULL, JSON_LONG_OPTION },
+    { "binary",        no_argument,       NULL, BINARY_LONG_OPTION },
+    { "stats",         optional_argument, NULL, STATS_LONG_OPTION },
+    { "snapshot",      required_argument, NULL, SNAPSHOT_LONG_OPTION },
+    { "diff-against",  required_argument, NULL, DIFF_AGAINST_LONG_OPTION },
+    { "watch",         no_argument,       NULL, WATCH_LONG_OPTION },
+    { "du",            no_argument,       NULL, DU_LONG_OPTION },
+    { "include",       required_argument, NULL, INCLUDE_LONG_OPTION },
+    { "exclude",       required_argument, NULL, EXCLUDE_LONG_OPTION },
+    { "ignore",        required_argument, NULL, EXCLUDE_LONG_OPTION },
+    { "hide",          required_argument, NULL, HIDE_LONG_OPTION },
+    { "regex",         no_argument,       NULL, REGEX_LONG_OPTION },
+    { NULL,            0,                 NULL, 0 }
+};
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Parses a positive entry count.
+ *
+ * @return 0 on success, -1 if the argument is not a positive number.
+ */
+static int ParseCount(const char *arg, size_t *count)
+{
+    char *end;
 
+    errno = 0;
+    unsigned long long value = strtoull(arg, &end, 10);
+
+    if (errno != 0 || end == arg || *end != '\0' || value == 0 || arg[0] == '-')
+    {
+        return -1;
+    }
+
+    *count = (size_t)value;
+    return 0;
+}
 
 /**************************              MAIN FUNCTION            *******************************/
 
 int main(int argc, char *argv[])
 {
     int opt;
+    int filter_syntax = FILTER_SYNTAX_GLOB;
+    int du_enabled = 0;
+    size_t jobs;
+
+    /* Options of every listing of this run, and their name patterns */
+    Options_t options;
+    FilterSet_t filter;
+
+    Options_Init(&options);
+    Filter_InitSet(&filter);
 
 	if (argc == 1) 
     {
-		printf("Directory listing of pwd:\n");
-		do_ls(".");
+		Colors_Init(&options);
+		TimeFmt_Init();
+		OutBuf_PutLiteral(&Output, "Directory listing of pwd:\n");
+		do_ls(&options, ".");
 	} 
     
     else 
     {
         /* Parse options */
-        while ((opt = getopt(argc, argv, ":latucifd1")) != -1) 
+        while ((opt = getopt_long(argc, argv, ":latucifd1RUSXvrLHsI:", LongOptions, NULL)) != -1) 
         {
 
             switch (opt) {
-                case 'l':   OptionsFlags[LONG_FORMAT_OPTION_l] = 1;                break;
-                case 'a':   OptionsFlags[SHOW_HIDDEN_OPTION_a] = 1;                break;
-                case 't':   OptionsFlags[SORT_BY_TIME_OPTION_t] = 1;               break;
-                case 'u':   OptionsFlags[ACCESS_TIME_OPTION_u] = 1;                break;
-                case 'c':   OptionsFlags[CHANGE_TIME_OPTION_c] = 1;                break;
-                case 'i':   OptionsFlags[SHOW_INODE_OPTION_i] = 1;                 break;
-                case 'f':   OptionsFlags[DISABLE_EVERYTING_OPTION_f] = 1;          break;
-                case 'd':   OptionsFlags[SHOW_DIRECTORY_ITSELF_OPTION_d] = 1;      break;
-                case '1':   OptionsFlags[SHOW_1_FILE_IN_LINE_OPTION_1] = 1;        break;
+                case 'l':   options.flags[LONG_FORMAT_OPTION_l] = 1;                break;
+                case 'a':   options.flags[SHOW_HIDDEN_OPTION_a] = 1;                break;
+                case 't':   options.flags[SORT_BY_TIME_OPTION_t] = 1;               break;
+                case 'u':   options.flags[ACCESS_TIME_OPTION_u] = 1;                break;
+                case 'c':   options.flags[CHANGE_TIME_OPTION_c] = 1;                break;
+                case 'i':   options.flags[SHOW_INODE_OPTION_i] = 1;                 break;
+                case 'f':   options.flags[DISABLE_EVERYTING_OPTION_f] = 1;          break;
+                case 'd':   options.flags[SHOW_DIRECTORY_ITSELF_OPTION_d] = 1;      break;
+                case '1':   options.flags[SHOW_1_FILE_IN_LINE_OPTION_1] = 1;        break;
+                case 'R':   options.flags[RECURSIVE_OPTION_R] = 1;                  break;
+                case 'U':   options.flags[UNSORTED_OPTION_U] = 1;                   break;
+                case 'S':   options.flags[SORT_BY_SIZE_OPTION_S] = 1;               break;
+                case 'X':   options.flags[SORT_BY_EXTENSION_OPTION_X] = 1;          break;
+                case 'v':   options.flags[SORT_BY_VERSION_OPTION_v] = 1;            break;
+                case 'r':   options.flags[REVERSE_OPTION_r] = 1;                    break;
+                case 'L':   options.flags[DEREFERENCE_OPTION_L] = 1;                break;
+                case 'H':   options.flags[DEREFERENCE_ARGS_OPTION_H] = 1;           break;
+                case 's':   options.flags[SHOW_BLOCKS_OPTION_s] = 1;                break;
+                case 'I':   Filter_AddToSet(&filter, FILTER_EXCLUDE, optarg);      break;
+
+                case DIRBUF_LONG_OPTION:
+                    if (DirReader_ParseSize(optarg, &options.dir_buffer_size) < 0)
+                    {
+                        fprintf(stderr, "Invalid directory buffer size: %s\n", optarg);
+                        return -1;
+                    }
+                    break;
+
+                case DONT_SYNC_LONG_OPTION:         options.flags[DONT_SYNC_OPTION] = 1;         break;
+                case NO_EXEC_COLOR_LONG_OPTION:     options.flags[NO_EXEC_COLOR_OPTION] = 1;     break;
+
+                case JOBS_LONG_OPTION:
+                    if (ParseCount(optarg, &jobs) < 0 || jobs > INT_MAX)
+                    {
+                        fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+                        return -1;
+                    }
+
+                    options.jobs = (int)jobs;
+                    break;
+
+                case IO_LONG_OPTION:
+                    if (strcmp(optarg, "sync") == 0)
+                    {
+                        options.io_engine = IO_ENGINE_SYNC;
+                    }
+                    else if (strcmp(optarg, "uring") == 0)
+                    {
+                        options.io_engine = IO_ENGINE_URING;
+                    }
+                    else
+                    {
+                        fprintf(stderr, "Invalid I/O engine: %s (expected sync or uring)\n", optarg);
+                        return -1;
+                    }
+                    break;
+
+                case TIME_STYLE_LONG_OPTION:
+                    options.time_style = TimeFmt_ParseStyle(optarg);
+                    if (options.time_style < 0)
+                    {
+                        fprintf(stderr, "Invalid time style: %s (expected iso, long-iso, full-iso or locale)\n", optarg);
+                        return -1;
+                    }
+                    break;
+
+                case ZERO_LONG_OPTION:      options.output_format = OUTPUT_FORMAT_ZERO;     break;
+                case JSON_LONG_OPTION:      options.output_format = OUTPUT_FORMAT_JSON;     break;
+                case BINARY_LONG_OPTION:    options.output_format = OUTPUT_FORMAT_BINARY;   break;
+
+                case STATS_LONG_OPTION:
+                    if (!MYLS_STATS)
+                    {
+                        fprintf(stderr, "Statistics are not available: myls was built with STATS=0\n");
+                        return -1;
+                    }
+
+                    if (Stats_ParseFormat(optarg) < 0)
+                    {
+                        fprintf(stderr, "Invalid statistics format: %s (expected text or json)\n", optarg);
+                        return -1;
+                    }
+
+                    Stats_Enable(Stats_ParseFormat(optarg));
+                    break;
+
+                case SNAPSHOT_LONG_OPTION:          options.snapshot_path = optarg;         break;
+                case DIFF_AGAINST_LONG_OPTION:      options.diff_against_path = optarg;     break;
+                case WATCH_LONG_OPTION:             options.watch = 1;                      break;
+                case DU_LONG_OPTION:                du_enabled = 1;                         break;
+
+                case INCLUDE_LONG_OPTION:           Filter_AddToSet(&filter, FILTER_INCLUDE, optarg);   break;
+                case EXCLUDE_LONG_OPTION:           Filter_AddToSet(&filter, FILTER_EXCLUDE, optarg);   break;
+                case HIDE_LONG_OPTION:              Filter_AddToSet(&filter, FILTER_HIDE, optarg);      break;
+                case REGEX_LONG_OPTION:             filter_syntax = FILTER_SYNTAX_REGEX;                break;
+
+                /* --newest=N is -t --head=N, --largest=N is -S --head=N */
+                case HEAD_LONG_OPTION:
+                case NEWEST_LONG_OPTION:
+                case LARGEST_LONG_OPTION:
+                    if (ParseCount(optarg, &options.head_count) < 0)
+                    {
+                        fprintf(stderr, "Invalid number of entries: %s\n", optarg);
+                        return -1;
+                    }
+
+                    if (opt == NEWEST_LONG_OPTION)
+                    {
+                        options.flags[SORT_BY_TIME_OPTION_t] = 1;
+                    }
+                    else if (opt == LARGEST_LONG_OPTION)
+                    {
+                        options.flags[SORT_BY_SIZE_OPTION_S] = 1;
+                    }
+                    break;
             
             default:    printf("Unexpected case in switch()");  return -1;
 		    }
         }
 
+        /* if -f option is used (set before any listing, which may run on several threads) */
+        if (options.flags[DISABLE_EVERYTING_OPTION_f])
+        {
+            /* Enable hidden files */
+            options.flags[SHOW_HIDDEN_OPTION_a] = 1;
+
+            /* Disable long format option */
+            options.flags[LONG_FORMAT_OPTION_l] = 0;
+        }
+
+        /* A snapshot describes one directory (-d lists the directory itself and ignores it) */
+        if ((options.snapshot_path != NULL || options.diff_against_path != NULL) &&
+            (options.flags[RECURSIVE_OPTION_R] || (argc - optind > 1)))
+        {
+            fprintf(stderr, "--snapshot and --diff-against take a single directory and no -R\n");
+            return -1;
+        }
+
+        /* Differences are printed as marked lines */
+        if (options.diff_against_path != NULL && options.output_format != OUTPUT_FORMAT_TEXT)
+        {
+            fprintf(stderr, "--diff-against cannot be combined with --zero, --json or --binary\n");
+            return -1;
+        }
+
+        /* --watch keeps one directory listed, as text */
+        if (options.watch && (options.flags[RECURSIVE_OPTION_R] || options.flags[SHOW_DIRECTORY_ITSELF_OPTION_d] ||
+                             (argc - optind > 1) || options.output_format != OUTPUT_FORMAT_TEXT || options.head_count > 0 ||
+                             options.snapshot_path != NULL || options.diff_against_path != NULL))
+        {
+            fprintf(stderr, "--watch takes a single directory, in text format, without -R, -d, --head or snapshots\n");
+            return -1;
+        }
+
+        /* Name patterns are compiled once, whatever their order on the command line */
+        if (Filter_CompileSet(&filter, filter_syntax) < 0)
+        {
+            char message[256];
+            regerror(filter.error, NULL, message, sizeof(message));
+            fprintf(stderr, "Invalid regular expression '%s': %s\n", filter.invalid, message);
+            return -1;
+        }
+
+        options.filter = &filter;
+
+        /* --du prints one summary line per tree instead of listings */
+        if (du_enabled && (options.output_format != OUTPUT_FORMAT_TEXT || options.watch ||
+                          options.snapshot_path != NULL || options.diff_against_path != NULL))
+        {
+            fprintf(stderr, "--du cannot be combined with --zero, --json, --binary, --watch or snapshots\n");
+            return -1;
+        }
+
+        /* Compile the color tables once the options affecting them are known */
+        Colors_Init(&options);
+        TimeFmt_Init();
+
+        /* Machine-readable formats: binary header, and paths for --zero when names could clash */
+        options.qualify_names = options.flags[RECURSIVE_OPTION_R] || (argc - optind > 1);
+        Records_Init(&options, &Output);
+
+        /* --watch => list, then follow the changes until interrupted */
+        if (options.watch)
+        {
+            int status = Watch_Run(&options, (optind == argc) ? "." : argv[optind]);
+            OutBuf_Flush(&Output);
+            return status;
+        }
+
+        /* --du => summarize the trees one after the other (each one is walked in parallel) */
+        if (du_enabled)
+        {
+            DuInodeSet_t counted;
+            int status = 0;
+
+            /* One set for all the operands => a file is counted once, whatever names it has;
+               with several operands every inode is tracked, so overlapping trees count once */
+            Du_InitInodeSet(&counted, argc - optind > 1);
+
+            if (optind == argc)
+            {
+                status = Du_Summarize(&options, &Output, ".", &counted);
+            }
+
+            for (int i = optind; i < argc; i++)
+            {
+                status |= Du_Summarize(&options, &Output, argv[i], &counted);
+            }
+
+            Du_FreeInodeSet(&counted);
+            OutBuf_Flush(&Output);
+            STATS_REPORT();
+            return status;
+        }
+
         /* If no directory is passed => list the current worling directory's entries */
         if (optind == argc) 
         {
-            printf("Directory listing of pwd:\n");
-            do_ls(".");
+            if (options.output_format == OUTPUT_FORMAT_TEXT)
+            {
+                OutBuf_PutLiteral(&Output, "Directory listing of pwd:\n");
+            }
+            Args_ListOne(&options, ".");
         } 
 
         else
         {
-            int i = 0;
-            /* Loop on the passed directories */
-            while (++i < argc) 
-            {
-                /* If argv[i] is an option => ignore it */
-                if( argv[i][0] == '-' )
-                {
-                    continue;
-                }
-
-                printf("Directory listing of %s:\n", argv[i]);
-                do_ls(argv[i]);
-                printf("\n");
-            }
+            /* List the passed directories (getopt moved them after the options), in parallel
+               with the output kept in their order */
+            Args_ListAll(&options, &argv[optind], argc - optind);
         }
 
 
 	}
 
+	/* Write whatever is still buffered */
+	OutBuf_Flush(&Output);
+
+	/* --stats => totals of the run, once everything is written */
+	STATS_REPORT();
+
 	return 0;
 }
 
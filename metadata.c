@@ -0,0 +1,701 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        metadata.c             ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+/* statx() and struct statx are GNU extensions */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/sysmacros.h>
+
+#include "utils.h"
+#include "options.h"
+#include "colors.h"
+#include "metadata.h"
+#include "uring.h"
+#include "records.h"
+#include "stats.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Queue of chunk indices owned by one worker.
+ *
+ * The range [begin, end) is packed into one word (begin in the high half) so that the owner
+ * (taking from the front) and thieves (taking from the back) agree with a single CAS.
+ */
+typedef struct
+{
+    _Atomic uint64_t range;
+} ChunkQueue_t;
+
+/**
+ * @brief State shared by the metadata workers.
+ */
+typedef struct
+{
+    const Options_t *options; /* Options of the listing */
+    EntryTable_t *table;    /* Table being completed */
+    int dir_fd;             /* Directory holding the entries */
+    const LinkDir_t *link_dir; /* Its identity for the link cache (NULL => not cached) */
+    unsigned int mask;      /* statx fields needed */
+    ChunkQueue_t *queues;   /* One queue per worker */
+    Arena_t *arenas;        /* One arena per worker for link targets */
+    int jobs;               /* Number of workers */
+    StatsProfile_t *stats;  /* Profile of the calling thread's listing (--stats) */
+} MetadataPool_t;
+
+/**
+ * @brief Argument of one worker thread.
+ */
+typedef struct
+{
+    MetadataPool_t *pool;
+    int id;
+} MetadataWorker_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+#ifdef AT_STATX_SYNC_AS_STAT
+/* Cleared once the kernel reports that statx is not implemented (any thread may see it first) */
+static atomic_int StatxAvailable = 1;
+#endif
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Tells whether the listing keeps or compares a snapshot (--snapshot, --diff-against).
+ */
+static int KeepsSnapshot(const Options_t *options)
+{
+    return options->snapshot_path != NULL || options->diff_against_path != NULL;
+}
+
+/**
+ * @brief Tells whether every field of every entry is needed (records, snapshots, or --watch,
+ *        which compares them to detect changes).
+ */
+static int NeedsEverything(const Options_t *options)
+{
+    return Records_NeedMetadata(options) || KeepsSnapshot(options) || options->watch;
+}
+
+unsigned int Metadata_BuildMask(const Options_t *options)
+{
+    /* Type and permission bits are always needed for colors and file type checks */
+    unsigned int mask = STATX_TYPE | STATX_MODE;
+
+    if (options->flags[LONG_FORMAT_OPTION_l])
+    {
+        mask |= STATX_NLINK | STATX_UID | STATX_GID | STATX_SIZE;
+
+        /* Only the displayed time is needed */
+        if (options->flags[ACCESS_TIME_OPTION_u])
+            mask |= STATX_ATIME;
+        else if (options->flags[CHANGE_TIME_OPTION_c])
+            mask |= STATX_CTIME;
+        else
+            mask |= STATX_MTIME;
+    }
+
+    /* Time used as a sort key */
+    if (options->flags[SORT_BY_TIME_OPTION_t])
+        mask |= STATX_MTIME;
+    if (options->flags[ACCESS_TIME_OPTION_u])
+        mask |= STATX_ATIME;
+    if (options->flags[CHANGE_TIME_OPTION_c])
+        mask |= STATX_CTIME;
+
+    /* Size used as a sort key */
+    if (options->flags[SORT_BY_SIZE_OPTION_S])
+        mask |= STATX_SIZE;
+
+    /* Allocated blocks: the `total` line of -l and -s, and the per-entry count of -s */
+    if (options->flags[LONG_FORMAT_OPTION_l] || options->flags[SHOW_BLOCKS_OPTION_s])
+        mask |= STATX_BLOCKS;
+
+    if (options->flags[SHOW_INODE_OPTION_i])
+        mask |= STATX_INO;
+
+    /* JSON and binary records, and snapshots, carry every field */
+    if (NeedsEverything(options))
+        mask |= STATX_NLINK | STATX_UID | STATX_GID | STATX_SIZE | STATX_BLOCKS | STATX_INO |
+                STATX_ATIME | STATX_MTIME | STATX_CTIME;
+
+    return mask;
+}
+
+#ifdef AT_STATX_SYNC_AS_STAT
+int Metadata_StatxFlags(const Options_t *options)
+{
+    int flags = AT_SYMLINK_NOFOLLOW;
+
+    /* On network file systems, accept cached attributes instead of a server round trip */
+    if (options->flags[DONT_SYNC_OPTION])
+    {
+        flags |= AT_STATX_DONT_SYNC;
+    }
+
+    return flags;
+}
+
+void Metadata_StatxToStat(const struct statx *stx, struct stat *buf)
+{
+    memset(buf, 0, sizeof(*buf));
+
+    buf->st_dev = makedev(stx->stx_dev_major, stx->stx_dev_minor);
+    buf->st_rdev = makedev(stx->stx_rdev_major, stx->stx_rdev_minor);
+    buf->st_ino = stx->stx_ino;
+    buf->st_mode = stx->stx_mode;
+    buf->st_nlink = stx->stx_nlink;
+    buf->st_uid = stx->stx_uid;
+    buf->st_gid = stx->stx_gid;
+    buf->st_size = stx->stx_size;
+    buf->st_blksize = stx->stx_blksize;
+    buf->st_blocks = stx->stx_blocks;
+    buf->st_atim.tv_sec = stx->stx_atime.tv_sec;
+    buf->st_atim.tv_nsec = stx->stx_atime.tv_nsec;
+    buf->st_mtim.tv_sec = stx->stx_mtime.tv_sec;
+    buf->st_mtim.tv_nsec = stx->stx_mtime.tv_nsec;
+    buf->st_ctim.tv_sec = stx->stx_ctime.tv_sec;
+    buf->st_ctim.tv_nsec = stx->stx_ctime.tv_nsec;
+}
+#endif
+
+int Metadata_Fetch(const Options_t *options, int dir_fd, const char *name, unsigned int mask, struct stat *buf)
+{
+#ifdef AT_STATX_SYNC_AS_STAT
+    if (atomic_load_explicit(&StatxAvailable, memory_order_relaxed))
+    {
+        struct statx stx;
+        int flags = Metadata_StatxFlags(options);
+
+        STATS_COUNT(STATS_STATX, 1);
+        if (statx(dir_fd, name, flags, mask, &stx) == 0)
+        {
+            Metadata_StatxToStat(&stx, buf);
+            return 0;
+        }
+
+        if (errno != ENOSYS)
+        {
+            return -1;
+        }
+
+        /* Kernel without statx => use fstatat from now on */
+        atomic_store_explicit(&StatxAvailable, 0, memory_order_relaxed);
+    }
+#endif
+
+    (void)mask;
+    STATS_COUNT(STATS_STAT, 1);
+    return fstatat(dir_fd, name, buf, AT_SYMLINK_NOFOLLOW);
+}
+
+int Metadata_NeedsStat(const Options_t *options, unsigned char d_type)
+{
+    /* These options print or sort on fields that only stat can provide */
+    if (options->flags[LONG_FORMAT_OPTION_l] || options->flags[SORT_BY_TIME_OPTION_t] ||
+        options->flags[ACCESS_TIME_OPTION_u] || options->flags[CHANGE_TIME_OPTION_c] ||
+        options->flags[SORT_BY_SIZE_OPTION_S] || options->flags[SHOW_BLOCKS_OPTION_s] || NeedsEverything(options))
+    {
+        return 1;
+    }
+
+    /* No colors => the name (and d_ino for -i) is all that is printed */
+    if (options->flags[DISABLE_EVERYTING_OPTION_f] || options->output_format != OUTPUT_FORMAT_TEXT)
+    {
+        return 0;
+    }
+
+    switch (d_type)
+    {
+        /* The file system did not report the type */
+        case DT_UNKNOWN:    return 1;
+
+        /* Executable and setuid/setgid colors depend on the permission bits */
+        case DT_REG:        return !options->flags[NO_EXEC_COLOR_OPTION];
+
+        /* So do the sticky and other-writable directory colors, when they are set */
+        case DT_DIR:        return Colors_NeedsDirMode();
+
+        /* The color only depends on the type (a link's target is checked when printing) */
+        default:            return 0;
+    }
+}
+
+void Metadata_FromRecord(unsigned char d_type, ino_t d_ino, struct stat *buf)
+{
+    memset(buf, 0, sizeof(*buf));
+
+    buf->st_mode = DTTOIF(d_type);
+    buf->st_ino = d_ino;
+}
+
+/**
+ * @brief Reads the target name of a symbolic link into an arena.
+ *
+ * @return The null-terminated target, or NULL on failure.
+ */
+static char *ReadTarget(const FileEntry_t *entry, int dir_fd, Arena_t *arena)
+{
+    /* The link size is the length of its target => no fixed path limit */
+    size_t target_size = (entry->buf.st_size > 0) ? (size_t)entry->buf.st_size + 1 : PATH_MAX;
+    char *link_target = Arena_Alloc(arena, target_size);
+    ssize_t len = readlinkat(dir_fd, entry->name, link_target, target_size - 1);
+    STATS_COUNT(STATS_READLINK, 1);
+
+    if (len == -1)
+    {
+        /** Error reading symbolic link */
+        perror("Error reading symbolic link");
+        return NULL;
+    }
+
+    /** Null-terminate the string */
+    link_target[len] = '\0';
+    return link_target;
+}
+
+void Metadata_ResolveLink(const Options_t *options, FileEntry_t *entry, int dir_fd, const LinkDir_t *link_dir, Arena_t *arena)
+{
+    if (!S_ISLNK(entry->buf.st_mode))
+    {
+        return;
+    }
+
+    int follow = options->flags[DEREFERENCE_OPTION_L];
+
+    /* The broken link color is only needed when colors are printed (a snapshot may be reused with colors) */
+    int need_status = (!options->flags[DISABLE_EVERYTING_OPTION_f] && options->output_format == OUTPUT_FORMAT_TEXT) ||
+                      KeepsSnapshot(options) || follow;
+
+    /** In long format, the target is printed after the name (records and snapshots carry it too) */
+    int show_target = options->flags[LONG_FORMAT_OPTION_l] || NeedsEverything(options);
+
+    /* With -L the target name is the key of the link cache (links of a farm share it); it is
+       not read only for that otherwise */
+    char *link_target = NULL;
+    if (show_target || (follow && link_dir != NULL))
+    {
+        link_target = ReadTarget(entry, dir_fd, arena);
+    }
+
+    if (show_target)
+    {
+        entry->link_target = link_target;
+    }
+
+    if (!need_status)
+    {
+        return;
+    }
+
+    /* Links of a farm pointing at the same target share one resolution; a link whose target
+       was not read is keyed by its own identity. A link is on the device of its directory,
+       taken from the directory descriptor (an entry filled from its record has no st_dev). */
+    LinkDir_t link_self = { 0, (entry->d_ino != 0) ? entry->d_ino : entry->buf.st_ino };
+    if (link_dir != NULL)
+    {
+        link_self.dev = link_dir->dev;
+    }
+
+    const LinkDir_t *key_dir = (link_target != NULL) ? link_dir : &link_self;
+    const char *key_target = (link_target != NULL) ? link_target : "";
+    int cacheable = (link_target != NULL) ? (link_dir != NULL) : (link_dir != NULL && link_self.ino != 0);
+
+    LinkTarget_t target;
+    if (!cacheable || !LinkCache_Find(key_dir, key_target, &target))
+    {
+        target.buf.st_mode = 0;
+        target.status = CheckSymbolicLinkTarget(dir_fd, entry->name, &target.buf);
+
+        if (cacheable)
+        {
+            LinkCache_Store(key_dir, key_target, &target);
+        }
+    }
+
+    entry->link_status = target.status;
+
+    /* -L => the entry is shown as its target (a broken link stays a link) */
+    if (follow && target.status == PROPER_LINK && target.buf.st_mode != 0)
+    {
+        entry->buf = target.buf;
+        entry->d_type = IFTODT(target.buf.st_mode);
+        entry->link_target = NULL;
+    }
+}
+
+/**
+ * @brief Tells whether an entry needs any work in the metadata phase.
+ */
+static int NeedsWork(const Options_t *options, const FileEntry_t *entry)
+{
+    return Metadata_NeedsStat(options, entry->d_type) || (entry->d_type == DT_LNK);
+}
+
+/**
+ * @brief Gathers the metadata of one entry.
+ */
+static void ResolveEntry(const Options_t *options, FileEntry_t *entry, int dir_fd, const LinkDir_t *link_dir, unsigned int mask, Arena_t *arena)
+{
+    if (!Metadata_NeedsStat(options, entry->d_type))
+    {
+        Metadata_FromRecord(entry->d_type, entry->d_ino, &entry->buf);
+    }
+    else if (Metadata_Fetch(options, dir_fd, entry->name, mask, &entry->buf) < 0)
+    {
+        perror("Error in lstat");
+        entry->valid = 0;
+        return;
+    }
+
+    Metadata_ResolveLink(options, entry, dir_fd, link_dir, arena);
+}
+
+/**
+ * @brief Takes the next chunk from the front of the worker's own queue.
+ *
+ * @return The chunk index, or -1 if the queue is empty.
+ */
+static long PopOwnChunk(ChunkQueue_t *queue)
+{
+    uint64_t range = atomic_load(&queue->range);
+
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)(range >> 32);
+        uint32_t end = (uint32_t)range;
+
+        if (begin >= end)
+        {
+            return -1;
+        }
+
+        if (atomic_compare_exchange_weak(&queue->range, &range, ((uint64_t)(begin + 1) << 32) | end))
+        {
+            return begin;
+        }
+    }
+}
+
+/**
+ * @brief Steals a chunk from the back of another worker's queue.
+ *
+ * @return The chunk index, or -1 if the queue is empty.
+ */
+static long StealChunk(ChunkQueue_t *queue)
+{
+    uint64_t range = atomic_load(&queue->range);
+
+    for (;;)
+    {
+        uint32_t begin = (uint32_t)(range >> 32);
+        uint32_t end = (uint32_t)range;
+
+        if (begin >= end)
+        {
+            return -1;
+        }
+
+        if (atomic_compare_exchange_weak(&queue->range, &range, ((uint64_t)begin << 32) | (end - 1)))
+        {
+            return end - 1;
+        }
+    }
+}
+
+/**
+ * @brief Body of a metadata worker: drains its own queue, then steals from the others.
+ */
+static void *MetadataWorker(void *arg)
+{
+    MetadataWorker_t *worker = arg;
+    MetadataPool_t *pool = worker->pool;
+    size_t count = pool->table->count;
+
+    /* Started threads count into the caller's profile (worker 0 is the caller) */
+    if (worker->id != 0)
+    {
+        STATS_ATTACH(pool->stats);
+    }
+
+    for (;;)
+    {
+        long chunk = PopOwnChunk(&pool->queues[worker->id]);
+
+        /* Own queue is empty => look for work in the other queues */
+        for (int i = 1; chunk < 0 && i < pool->jobs; i++)
+        {
+            chunk = StealChunk(&pool->queues[(worker->id + i) % pool->jobs]);
+        }
+
+        if (chunk < 0)
+        {
+            break;
+        }
+
+        size_t first = (size_t)chunk * METADATA_CHUNK_SIZE;
+        size_t last = (first + METADATA_CHUNK_SIZE < count) ? first + METADATA_CHUNK_SIZE : count;
+
+        for (size_t i = first; i < last; i++)
+        {
+            ResolveEntry(pool->options, &pool->table->items[i], pool->dir_fd, pool->link_dir, pool->mask, &pool->arenas[worker->id]);
+        }
+    }
+
+    if (worker->id != 0)
+    {
+        STATS_DETACH();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Chooses the number of metadata threads for a table.
+ *
+ * An explicit count (--jobs) wins; otherwise the count grows with the number of entries that need a
+ * system call, so small directories stay on the calling thread.
+ */
+static int JobCount(long jobs, size_t work_count, size_t chunk_count)
+{
+
+    if (jobs <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        long max_jobs = ((cpus > 0) ? cpus : 1) * METADATA_AUTO_JOBS_PER_CPU;
+
+        jobs = (long)(work_count / METADATA_ENTRIES_PER_JOB);
+        if (jobs > max_jobs)
+            jobs = max_jobs;
+    }
+
+    if (jobs > METADATA_MAX_JOBS)
+        jobs = METADATA_MAX_JOBS;
+    if (jobs > (long)chunk_count)
+        jobs = (long)chunk_count;
+    if (jobs < 1)
+        jobs = 1;
+
+    return (int)jobs;
+}
+
+/**
+ * @brief Removes the entries whose metadata could not be gathered, keeping the order.
+ */
+static void DropInvalidEntries(EntryTable_t *table)
+{
+    size_t kept = 0;
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        if (table->items[i].valid)
+        {
+            if (kept != i)
+            {
+                table->items[kept] = table->items[i];
+            }
+            kept++;
+        }
+    }
+
+    table->count = kept;
+}
+
+/**
+ * @brief Gathers the metadata of a table with the io_uring engine.
+ *
+ * @return 0 on success, -1 if io_uring is not usable (nothing was kept).
+ */
+static int GatherWithUring(const Options_t *options, EntryTable_t *table, int dir_fd, const LinkDir_t *link_dir, unsigned int mask)
+{
+    unsigned char *needs_stat = malloc(table->count);
+
+    if (needs_stat == NULL)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        needs_stat[i] = (unsigned char)Metadata_NeedsStat(options, table->items[i].d_type);
+    }
+
+    if (Uring_StatEntries(options, table, dir_fd, mask, needs_stat) < 0)
+    {
+        free(needs_stat);
+        return -1;
+    }
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        FileEntry_t *entry = &table->items[i];
+
+        if (!needs_stat[i])
+        {
+            Metadata_FromRecord(entry->d_type, entry->d_ino, &entry->buf);
+        }
+
+        if (entry->valid)
+        {
+            Metadata_ResolveLink(options, entry, dir_fd, link_dir, &table->names);
+        }
+    }
+
+    free(needs_stat);
+    DropInvalidEntries(table);
+
+    return 0;
+}
+
+void Metadata_Gather(const Options_t *options, EntryTable_t *table, int dir_fd, unsigned int mask, int jobs)
+{
+    size_t work_count = 0;
+    size_t chunk_count = (table->count + METADATA_CHUNK_SIZE - 1) / METADATA_CHUNK_SIZE;
+
+    int may_have_links = 0;
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        work_count += NeedsWork(options, &table->items[i]);
+        may_have_links |= (table->items[i].d_type == DT_LNK || table->items[i].d_type == DT_UNKNOWN);
+    }
+
+    /* Relative link targets are cached per directory => one fstat when links may be present */
+    LinkDir_t dir_identity;
+    const LinkDir_t *link_dir = NULL;
+    struct stat dir_buf;
+
+    if (may_have_links && fstat(dir_fd, &dir_buf) == 0)
+    {
+        dir_identity.dev = dir_buf.st_dev;
+        dir_identity.ino = dir_buf.st_ino;
+        link_dir = &dir_identity;
+    }
+
+    /* io_uring engine: batched statx from this thread, then links are resolved here too */
+    if (options->io_engine == IO_ENGINE_URING && work_count > 0 && GatherWithUring(options, table, dir_fd, link_dir, mask) == 0)
+    {
+        return;
+    }
+
+    jobs = JobCount(jobs, work_count, chunk_count);
+
+    /* Serial path: no thread is worth starting */
+    if (jobs == 1 || work_count == 0)
+    {
+        for (size_t i = 0; i < table->count; i++)
+        {
+            ResolveEntry(options, &table->items[i], dir_fd, link_dir, mask, &table->names);
+        }
+
+        DropInvalidEntries(table);
+        return;
+    }
+
+    MetadataPool_t pool;
+    MetadataWorker_t workers[METADATA_MAX_JOBS];
+    pthread_t threads[METADATA_MAX_JOBS];
+    ChunkQueue_t queues[METADATA_MAX_JOBS];
+    Arena_t arenas[METADATA_MAX_JOBS];
+    int started[METADATA_MAX_JOBS];
+
+    pool.options = options;
+    pool.table = table;
+    pool.dir_fd = dir_fd;
+    pool.link_dir = link_dir;
+    pool.mask = mask;
+    pool.queues = queues;
+    pool.arenas = arenas;
+    pool.jobs = jobs;
+    pool.stats = STATS_CURRENT();
+
+    /* Give every worker a contiguous run of chunks */
+    for (int i = 0; i < jobs; i++)
+    {
+        uint64_t begin = chunk_count * i / jobs;
+        uint64_t end = chunk_count * (i + 1) / jobs;
+
+        atomic_init(&queues[i].range, (begin << 32) | end);
+        arenas[i].head = NULL;
+        workers[i].pool = &pool;
+        workers[i].id = i;
+    }
+
+    /* The calling thread acts as worker 0; a worker that fails to start leaves its chunks to be stolen */
+    for (int i = 1; i < jobs; i++)
+    {
+        started[i] = (pthread_create(&threads[i], NULL, MetadataWorker, &workers[i]) == 0);
+    }
+
+    MetadataWorker(&workers[0]);
+
+    for (int i = 1; i < jobs; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    /* Hand the link targets over to the table */
+    for (int i = 0; i < jobs; i++)
+    {
+        Arena_Merge(&table->names, &arenas[i]);
+    }
+
+    DropInvalidEntries(table);
+}
+
+int Metadata_GatherPath(const Options_t *options, char *path, FileEntry_t *entry, Arena_t *arena)
+{
+    entry->name = path;
+    entry->link_target = NULL;
+    entry->link_status = PROPER_LINK;
+    entry->valid = 1;
+
+    if (Metadata_Fetch(options, AT_FDCWD, path, Metadata_BuildMask(options), &entry->buf) < 0)
+    {
+        return -1;
+    }
+
+    entry->d_type = IFTODT(entry->buf.st_mode);
+    entry->d_ino = entry->buf.st_ino;
+
+    /* -H (or -L) => a link given on the command line is shown as its target */
+    if (S_ISLNK(entry->buf.st_mode) &&
+        (options->flags[DEREFERENCE_ARGS_OPTION_H] || options->flags[DEREFERENCE_OPTION_L]))
+    {
+        struct stat target_buf;
+
+        target_buf.st_mode = 0;
+        if (CheckSymbolicLinkTarget(AT_FDCWD, path, &target_buf) == PROPER_LINK && target_buf.st_mode != 0)
+        {
+            entry->buf = target_buf;
+            entry->d_type = IFTODT(target_buf.st_mode);
+            entry->d_ino = target_buf.st_ino;
+        }
+    }
+
+    /* Relative targets depend on the link's directory, which is not open => no cache */
+    Metadata_ResolveLink(options, entry, AT_FDCWD, NULL, arena);
+
+    return 0;
+}
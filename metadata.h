@@ -0,0 +1,174 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        metadata.h             ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _METADATA_H_
+#define _METADATA_H_
+
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "entries.h"
+#include "options.h"
+#include "linkcache.h"
+
+/* Number of entries handed out to a worker at a time */
+#define METADATA_CHUNK_SIZE 64
+
+/* With an automatic job count, one thread is started per this many entries needing work */
+#define METADATA_ENTRIES_PER_JOB 2048
+
+/* Upper bound of the automatic job count, per online CPU (stat is latency bound on network
+   file systems, so more threads than CPUs still help) */
+#define METADATA_AUTO_JOBS_PER_CPU 4
+
+/* Hard upper bound of the number of metadata threads */
+#define METADATA_MAX_JOBS 256
+
+/* Field bits used when statx is not available (values match the kernel's STATX_* bits) */
+#ifndef STATX_TYPE
+#define STATX_TYPE 0x0001U
+#define STATX_MODE 0x0002U
+#define STATX_NLINK 0x0004U
+#define STATX_UID 0x0008U
+#define STATX_GID 0x0010U
+#define STATX_ATIME 0x0020U
+#define STATX_MTIME 0x0040U
+#define STATX_CTIME 0x0080U
+#define STATX_INO 0x0100U
+#define STATX_SIZE 0x0200U
+#define STATX_BLOCKS 0x0400U
+#endif
+
+/**
+ * @brief Builds the statx field mask needed by the active options.
+ *
+ * Colors need the mode only; `-l` adds link count, owner, group, size and the displayed time;
+ * time sorting adds the sort key; `-i` adds the inode number; JSON and binary records need
+ * every field.
+ *
+ * @param options The options of the listing.
+ *
+ * @return A combination of STATX_* bits.
+ */
+unsigned int Metadata_BuildMask(const Options_t *options);
+
+#ifdef AT_STATX_SYNC_AS_STAT
+/**
+ * @brief Returns the statx flags matching the active options.
+ *
+ * Symbolic links are never followed; `--dont-sync` adds AT_STATX_DONT_SYNC.
+ *
+ * @param options The options of the listing.
+ *
+ * @return The flags to pass to statx.
+ */
+int Metadata_StatxFlags(const Options_t *options);
+
+/**
+ * @brief Converts a statx result into a stat buffer, keeping nanosecond timestamps.
+ *
+ * @param stx The statx result.
+ * @param buf Output: the equivalent stat buffer.
+ */
+void Metadata_StatxToStat(const struct statx *stx, struct stat *buf);
+#endif
+
+/**
+ * @brief Gets the metadata of a directory entry without following symbolic links.
+ *
+ * The entry is looked up relative to an open directory descriptor, so the kernel does not walk
+ * the full path again. On systems without statx, fstatat is used instead. Fields outside the
+ * mask may be left zero.
+ *
+ * @param options The options of the listing.
+ * @param dir_fd Descriptor of the directory holding the entry (or AT_FDCWD).
+ * @param name The entry name (or a path when dir_fd is AT_FDCWD).
+ * @param mask The statx fields needed (see Metadata_BuildMask).
+ * @param buf Output: the metadata, including nanosecond timestamps.
+ *
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int Metadata_Fetch(const Options_t *options, int dir_fd, const char *name, unsigned int mask, struct stat *buf);
+
+/**
+ * @brief Decides whether an entry has to be stat'ed, given its directory record type.
+ *
+ * Long format and time sorting need the full metadata. Otherwise the d_type of the record is
+ * enough for most entries: only unknown types, regular files whose executable/setuid color
+ * matters, and directories when LS_COLORS gives sticky/other-writable colors, are stat'ed. With `-f` (no colors) nothing is stat'ed at all.
+ *
+ * @param options The options of the listing.
+ * @param d_type The file type from the directory record (DT_*).
+ *
+ * @return 1 if Metadata_Fetch must be called for the entry, 0 otherwise.
+ */
+int Metadata_NeedsStat(const Options_t *options, unsigned char d_type);
+
+/**
+ * @brief Fills a stat buffer from a directory record only.
+ *
+ * The buffer gets the file type (from d_type) and the inode number (from d_ino); every
+ * other field is zero.
+ *
+ * @param d_type The file type from the directory record (DT_*).
+ * @param d_ino The inode number from the directory record.
+ * @param buf Output: the synthesized metadata.
+ */
+void Metadata_FromRecord(unsigned char d_type, ino_t d_ino, struct stat *buf);
+
+/**
+ * @brief Completes the metadata of a symbolic link entry.
+ *
+ * Checks whether the target exists (for the broken link color) and, in long format, reads the
+ * target name into the arena. With -L, a link whose target exists takes the target's metadata
+ * (and loses its target name, as it is no longer shown as a link). Resolutions are shared
+ * through the link cache, keyed by the target name and the directory. Entries that are not
+ * symbolic links are left untouched.
+ *
+ * @param options The options of the listing.
+ * @param entry The entry, whose buf must already be filled.
+ * @param dir_fd Descriptor of the directory holding the entry (or AT_FDCWD).
+ * @param link_dir Identity of that directory, or NULL to bypass the link cache.
+ * @param arena The arena receiving the target name.
+ */
+void Metadata_ResolveLink(const Options_t *options, FileEntry_t *entry, int dir_fd, const LinkDir_t *link_dir, Arena_t *arena);
+
+/**
+ * @brief Gathers the metadata of every entry in a table.
+ *
+ * Each entry is stat'ed if needed (see Metadata_NeedsStat) and symbolic links are resolved
+ * (see Metadata_ResolveLink). Large tables are processed by a pool of threads that take chunks
+ * of entries from per-thread queues and steal chunks from each other when their own queue runs
+ * dry; every entry is written by exactly one thread, so the table order is unchanged.
+ * Entries whose metadata could not be read are reported and removed from the table.
+ *
+ * @param options The options of the listing.
+ * @param table The table to complete.
+ * @param dir_fd Descriptor of the directory holding the entries.
+ * @param mask The statx fields needed (see Metadata_BuildMask).
+ * @param jobs Number of threads (--jobs); 0 chooses it from the number of entries to stat.
+ */
+void Metadata_Gather(const Options_t *options, EntryTable_t *table, int dir_fd, unsigned int mask, int jobs);
+
+/**
+ * @brief Gathers the metadata of a single path given on the command line (`-d`).
+ *
+ * @param options The options of the listing.
+ * @param path The path of the file.
+ * @param entry Output: the completed entry; its name points to path.
+ * @param arena The arena receiving the link target, if any.
+ *
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int Metadata_GatherPath(const Options_t *options, char *path, FileEntry_t *entry, Arena_t *arena);
+
+#endif
@@ -13,255 +13,927 @@
 
 #include "utils.h"
 #include "options.h"
+#include "metadata.h"
+#include "idcache.h"
+#include "sort.h"
+#include "topk.h"
+#include "records.h"
+#include "stats.h"
+#include "snapshot.h"
+#include "filter.h"
+#include "lsrread.h"
 #include <sys/ioctl.h>
 /**************************            GLOBAL VARIABLES           *******************************/
 extern int errno;
-int OptionsFlags[9] = {0};
 
 /**********************            FUNCTIONS IMPLEMENTATION            ***************************/
 
-void Basic_ls(char *file_names[], int file_count, char *dir)
+void Options_Init(Options_t *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->dir_buffer_size = DIR_BUFFER_DEFAULT_SIZE;
+    options->io_engine = IO_ENGINE_SYNC;
+    options->time_style = TIME_STYLE_DEFAULT;
+    options->output_format = OUTPUT_FORMAT_TEXT;
+}
+
+int Options_Accept(const Options_t *options, const char *name, size_t name_len)
+{
+    if (options->filter == NULL)
+    {
+        return options->flags[SHOW_HIDDEN_OPTION_a] || name[0] != '.';
+    }
+
+    return Filter_Matches(options->filter, name, name_len, options->flags[SHOW_HIDDEN_OPTION_a]);
+}
+
+/**
+ * @brief Prints the `total` line of a listing: the 1K blocks allocated to its entries.
+ *
+ * The 512-byte units are summed first, so the total is rounded up once, not per entry.
+ */
+static void PrintTotal(OutBuf_t *out, FileEntry_t *entries[], size_t file_count)
+{
+    struct stat sum;
+
+    sum.st_blocks = 0;
+    for (size_t i = 0; i < file_count; i++)
+    {
+        sum.st_blocks += entries[i]->buf.st_blocks;
+    }
+
+    OutBuf_PutLiteral(out, "total ");
+    OutBuf_PutUInt(out, GetDiskBlocks(&sum), 0);
+    OutBuf_Putc(out, '\n');
+}
+
+void Basic_ls(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t file_count, char *dir)
 {
-    struct stat buf;
     int max_len = 0;
+    int blocks_width = 0;
 
-    /* Determine the longest file name */
-    for (int i = 0; i < file_count; i++)
+    /* Determine the longest file name (and, with -s, the widest block count) */
+    for (size_t i = 0; i < file_count; i++)
     {
-        int len = strlen(file_names[i]);
+        int len = strlen(entries[i]->name);
         if (len > max_len)
         {
             max_len = len;
         }
+
+        if (options->flags[SHOW_BLOCKS_OPTION_s])
+        {
+            int width = 1;
+            for (unsigned long long blocks = GetDiskBlocks(&entries[i]->buf); blocks >= 10; blocks /= 10)
+            {
+                width++;
+            }
+
+            if (width > blocks_width)
+            {
+                blocks_width = width;
+            }
+        }
     }
 
-    /* Get terminal width */
+    /* Get terminal width (output is not a terminal => use the default width) */
     struct winsize w;
-    ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
-    int term_width = w.ws_col;
+    int term_width = DEFAULT_TERMINAL_WIDTH;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col > 0)
+    {
+        term_width = w.ws_col;
+    }
 
-    /* Calculate how many columns can fit */
-    int cols = term_width / (max_len + 2); // +2 for spacing
+    /* Calculate how many columns can fit (-s adds the block count and a space to each one) */
+    size_t cols = term_width / (max_len + 2 + (blocks_width > 0 ? blocks_width + 1 : 0)); // +2 for spacing
     if (cols == 0)
         cols = 1;
 
     /* if -d option is used => print directory name only */
-    if (OptionsFlags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    if (options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
     {
+        FileEntry_t self;
+        Arena_t arena = { NULL };
+
         /* Get file status */
-        if (lstat(dir, &buf) < 0)
+        if (Metadata_GatherPath(options, dir, &self, &arena) < 0)
         {
             perror("Error in lstat");
             return;
         }
 
+        if (options->flags[SHOW_BLOCKS_OPTION_s])
+        {
+            PrintBlocks(out, &self, 0);
+        }
+
         /* if -f option is used => print without color */
-        if (OptionsFlags[DISABLE_EVERYTING_OPTION_f])
+        if (options->flags[DISABLE_EVERYTING_OPTION_f])
         {
-            printf("%s", dir);
+            OutBuf_Puts(out, dir);
         }
         else
         {
-            PrintEntry(dir, buf, NULL, 0);
+            PrintEntry(options, out, &self, 0);
         }
+
+        Arena_Release(&arena);
     }
     else
     {
-        /* Loop over the entries in the directory */
-        for (int i = 0; i < file_count; i++)
+        /* If -s option is used => the listing starts with the blocks of all its entries */
+        if (options->flags[SHOW_BLOCKS_OPTION_s])
         {
-            /* Construct the full path to the file */
-            char path[MAX_PATH_LENGTH];
-            snprintf(path, sizeof(path), "%s/%s", dir, file_names[i]);
+            PrintTotal(out, entries, file_count);
+        }
 
-            /* Get file status */
-            if (lstat(path, &buf) < 0)
+        /* Loop over the entries in the directory */
+        for (size_t i = 0; i < file_count; i++)
+        {
+            /* If -i option is used => print the inode number at the beginning */
+            if (options->flags[SHOW_INODE_OPTION_i])
             {
-                perror("Error in lstat");
-                continue;
+                OutBuf_PutUInt(out, entries[i]->buf.st_ino, 0);
+                OutBuf_PutLiteral(out, "  ");
             }
 
-            /* If -i option is used => print the inode number at the beginning */
-            if (OptionsFlags[SHOW_INODE_OPTION_i])
+            /* If -s option is used => then the allocated blocks */
+            if (options->flags[SHOW_BLOCKS_OPTION_s])
             {
-                printf("%ld  ", buf.st_ino);
+                PrintBlocks(out, entries[i], blocks_width);
             }
 
             /* If -f option is used => print without color */
-            if (OptionsFlags[DISABLE_EVERYTING_OPTION_f])
+            if (options->flags[DISABLE_EVERYTING_OPTION_f])
             {
-                printf("%-*s  ", max_len, file_names[i]);
+                OutBuf_PutsPadded(out, entries[i]->name, max_len);
+                OutBuf_PutLiteral(out, "  ");
             }
 
             else
             {
-                PrintEntry(file_names[i], buf, path, max_len);
+                PrintEntry(options, out, entries[i], max_len);
             }
 
-            if (OptionsFlags[SHOW_1_FILE_IN_LINE_OPTION_1])
+            if (options->flags[SHOW_1_FILE_IN_LINE_OPTION_1])
             {
-                printf("\n");
+                OutBuf_Putc(out, '\n');
             }
 
             /* Ensure that we print in a tabular format */
             else if ((i + 1) % cols == 0)
             {
-                printf("\n"); // Move to the next row after filling a column
+                OutBuf_Putc(out, '\n'); // Move to the next row after filling a column
             }
-
-            free(file_names[i]);
         }
 
         if (file_count % cols != 0)
         {
-            printf("\n"); // Print newline at the end if not a complete row
+            OutBuf_Putc(out, '\n'); // Print newline at the end if not a complete row
         }
     }
 }
 
-void LongFormat_ls(char *file_names[], int file_count, char *dir)
+void LongFormat_ls(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t file_count, char *dir)
 {
-    struct stat buf;
-
     /* if -d option is used => print directory name only */
-    if (OptionsFlags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    if (options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
     {
-        if (lstat(dir, &buf) < 0)
+        FileEntry_t self;
+        Arena_t arena = { NULL };
+
+        if (Metadata_GatherPath(options, dir, &self, &arena) < 0)
         {
             perror("Error in lstat");
             return;
         }
 
-        PrintEntry_LongFormat(buf, dir, NULL);
-        printf("\n");
+        PrintEntry_LongFormat(options, out, &self);
+        OutBuf_Putc(out, '\n');
+
+        Arena_Release(&arena);
     }
 
     else
     {
-        /* Loop over the entries in the directory */
-        for (int i = 0; i < file_count; i++)
-        {
+        /* Resolve every distinct owner and group before formatting */
+        IdCache_Prewarm(entries, file_count);
 
-            /* Construct the full path to the file */
-            char path[MAX_PATH_LENGTH];
-            snprintf(path, sizeof(path), "%s/%s", dir, file_names[i]);
+        /* The listing starts with the blocks of all its entries */
+        PrintTotal(out, entries, file_count);
 
-            /* Get file status */
-            if (lstat(path, &buf) < 0)
-            {
-                perror("Error in lstat");
-                continue;
-            }
+        /* Loop over the entries in the directory */
+        for (size_t i = 0; i < file_count; i++)
+        {
 
             /* Print the entry in long format */
-            PrintEntry_LongFormat(buf, file_names[i], path);
+            PrintEntry_LongFormat(options, out, entries[i]);
 
             /* Separate by new line */
-            printf("\n");
+            OutBuf_Putc(out, '\n');
+        }
+    }
+}
+
+/**
+ * @brief Writes sorted entries as machine-readable records (or the directory itself with -d).
+ */
+static void PrintRecords(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t count, char *dir)
+{
+    if (options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        FileEntry_t self;
+        Arena_t arena = { NULL };
 
-            free(file_names[i]);
+        if (Metadata_GatherPath(options, dir, &self, &arena) < 0)
+        {
+            perror("Error in lstat");
+            return;
         }
+
+        Records_Write(options, out, NULL, &self);
+        Arena_Release(&arena);
+        return;
+    }
+
+    Records_Directory(options, out, dir);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        Records_Write(options, out, dir, entries[i]);
     }
 }
 
-void do_ls(char *dir)
+void PrintSorted(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t count, char *dir)
 {
-    struct dirent *entry;
-    DIR *dp = opendir(dir);
+    /* --zero, --json, --binary => no layout at all */
+    if (options->output_format != OUTPUT_FORMAT_TEXT)
+    {
+        PrintRecords(options, out, entries, count, dir);
+    }
 
-    /* Array of pointers to hold file names */
-    char *file_names[MAX_FILES];
-    int file_count = 0;
+    /* If -l option is used => print in long format */
+    else if (options->flags[LONG_FORMAT_OPTION_l] == 1)
+    {
+        LongFormat_ls(options, out, entries, count, dir);
+    }
 
-    if (dp == NULL)
+    /* print file names only */
+    else
+    {
+        Basic_ls(options, out, entries, count, dir);
+        OutBuf_Putc(out, '\n');
+    }
+}
+
+int Directory_ls(const Options_t *options, OutBuf_t *out, char *dir, EntryTable_t *table, int jobs)
+{
+    LsrReader_t reader;
+    StatsProfile_t stats;
+
+    EntryTable_Init(table);
+
+    if (LsrReader_Open(&reader, dir, options, table) < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", dir);
+        return -1;
+    }
+
+    STATS_BEGIN(&stats, dir);
+
+    /* Read phase: store the accepted entries of the directory in the table (the names are
+       packed into the table's arena) */
+    if (LsrReader_ReadAll(&reader) < 0)
+    {
+        perror("Error reading directory");
+    }
+
+    STATS_COUNT(STATS_ENTRIES, table->count);
+    STATS_SWITCH(STATS_PHASE_METADATA);
+
+    /* Metadata phase: stat each entry once (only the fields the active options need)
+       relative to the directory descriptor, and resolve symbolic links */
+    Metadata_Gather(options, table, reader.reader.fd, Metadata_BuildMask(options), jobs);
+
+    LsrReader_Close(&reader);
+    STATS_SWITCH(STATS_PHASE_SORT);
+
+    /* Sort Entries (on keys computed once per entry) */
+    Sort_Entries(table, Sort_SelectMode(options), options->flags[REVERSE_OPTION_r]);
+    STATS_SWITCH(STATS_PHASE_FORMAT);
+
+    /* --head (reached here with -R) => only the first entries are printed */
+    size_t shown = table->count;
+    if (options->head_count > 0 && options->head_count < shown)
+    {
+        shown = options->head_count;
+    }
+
+    PrintSorted(options, out, table->sorted, shown, dir);
+    STATS_END();
+
+    return 0;
+}
+
+/**
+ * @brief Tells whether text output has one unpadded name per line: with -1, or when the output
+ *        is not a terminal, unless the long format or -s asks for columns of fields.
+ */
+static int UsesLineLayout(const Options_t *options)
+{
+    return !options->flags[LONG_FORMAT_OPTION_l] && !options->flags[SHOW_BLOCKS_OPTION_s] &&
+           (options->flags[SHOW_1_FILE_IN_LINE_OPTION_1] || !isatty(STDOUT_FILENO));
+}
+
+/**
+ * @brief Tells whether a listing can be printed while the directory is still being read.
+ *
+ * This is the case when the entries keep the directory order and the layout does not depend
+ * on the longest name: records, one name per line (-1), or output that is not a terminal
+ * (which then gets one name per line). Long format and -s start with the total of the whole
+ * directory, so they are not streamed.
+ */
+static int CanStream(const Options_t *options)
+{
+    if (Sort_SelectMode(options) != SORT_NONE || options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        return 0;
+    }
+
+    return options->output_format != OUTPUT_FORMAT_TEXT || UsesLineLayout(options);
+}
+
+/**
+ * @brief Prints one batch of a streamed listing, writes it out and forgets it.
+ */
+static void StreamBatch(const Options_t *options, OutBuf_t *out, EntryTable_t *table, char *dir, int dir_fd, unsigned int mask,
+                        int jobs)
+{
+    STATS_COUNT(STATS_ENTRIES, table->count);
+    STATS_SWITCH(STATS_PHASE_METADATA);
+    Metadata_Gather(options, table, dir_fd, mask, jobs);
+    STATS_SWITCH(STATS_PHASE_FORMAT);
+
+    for (size_t i = 0; i < table->count; i++)
+    {
+        if (options->output_format != OUTPUT_FORMAT_TEXT)
+        {
+            Records_Write(options, out, dir, &table->items[i]);
+            continue;
+        }
+
+        /* No padding: the longest name is not known yet */
+        PrintLine(options, out, &table->items[i]);
+        OutBuf_Putc(out, '\n');
+    }
+
+    EntryTable_Clear(table);
+    OutBuf_Flush(out);
+    STATS_SWITCH(STATS_PHASE_READ);
+}
+
+/**
+ * @brief Lists a directory batch by batch, in constant memory.
+ *
+ * Each batch of records returned by the kernel is stat'ed (if needed), printed and written
+ * out before the next one is read, so the first names appear immediately and nothing is
+ * kept from one batch to the next.
+ */
+static void Stream_ls(const Options_t *options, OutBuf_t *out, char *dir, int jobs)
+{
+    LsrReader_t reader;
+    EntryTable_t table;
+    StatsProfile_t stats;
+    int status;
+
+    EntryTable_Init(&table);
+
+    if (LsrReader_Open(&reader, dir, options, &table) < 0)
     {
         fprintf(stderr, "Cannot open directory: %s\n", dir);
+        EntryTable_Free(&table);
         return;
     }
 
-    /* if -f option is used: */
-    if (OptionsFlags[DISABLE_EVERYTING_OPTION_f])
+    STATS_BEGIN(&stats, dir);
+
+    unsigned int mask = Metadata_BuildMask(options);
+    Records_Directory(options, out, dir);
+
+    /* End of a getdents batch (or a full batch with readdir) => print it */
+    while ((status = LsrReader_ReadBatch(&reader, STREAM_BATCH_MAX_ENTRIES)) > 0)
+    {
+        StreamBatch(options, out, &table, dir, reader.reader.fd, mask, jobs);
+    }
+
+    if (status < 0)
+    {
+        perror("Error reading directory");
+    }
+
+    StreamBatch(options, out, &table, dir, reader.reader.fd, mask, jobs);
+
+    LsrReader_Close(&reader);
+    EntryTable_Free(&table);
+
+    if (options->output_format == OUTPUT_FORMAT_TEXT)
+    {
+        OutBuf_Putc(out, '\n');
+    }
+
+    STATS_END();
+}
+
+/**
+ * @brief Gathers the metadata of a batch, offers its entries to a heap and empties it.
+ */
+static void OfferBatch(const Options_t *options, TopK_t *heap, EntryTable_t *batch, int dir_fd, unsigned int mask, int jobs)
+{
+    STATS_COUNT(STATS_ENTRIES, batch->count);
+    STATS_SWITCH(STATS_PHASE_METADATA);
+    Metadata_Gather(options, batch, dir_fd, mask, jobs);
+    STATS_SWITCH(STATS_PHASE_SORT);
+
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        TopK_Offer(heap, &batch->items[i]);
+    }
+
+    EntryTable_Clear(batch);
+    STATS_SWITCH(STATS_PHASE_READ);
+}
+
+/**
+ * @brief Lists the first --head entries of a directory in O(head_count) memory.
+ *
+ * The directory is read batch by batch like a streamed listing; every stat'ed entry is offered
+ * to a bounded heap, so only the winners are kept, sorted and formatted. In directory order
+ * (-f, -U) reading simply stops after head_count entries.
+ */
+static void Head_ls(const Options_t *options, OutBuf_t *out, char *dir, int jobs)
+{
+    LsrReader_t reader;
+    EntryTable_t batch;
+    EntryTable_t winners;
+    TopK_t heap;
+    StatsProfile_t stats;
+    int mode = Sort_SelectMode(options);
+    int reverse = options->flags[REVERSE_OPTION_r];
+    int status = 0;
+
+    EntryTable_Init(&batch);
+    EntryTable_Init(&winners);
+
+    /* Directory order => the first entries read are the winners, read straight into their table */
+    if (LsrReader_Open(&reader, dir, options, (mode == SORT_NONE) ? &winners : &batch) < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", dir);
+        EntryTable_Free(&batch);
+        EntryTable_Free(&winners);
+        return;
+    }
+
+    STATS_BEGIN(&stats, dir);
+
+    unsigned int mask = Metadata_BuildMask(options);
+
+    if (mode == SORT_NONE)
+    {
+        /* Reading stops as soon as the table is full */
+        do
+        {
+            status = LsrReader_ReadBatch(&reader, options->head_count);
+        }
+        while (status > 0 && winners.count < options->head_count);
+
+        STATS_COUNT(STATS_ENTRIES, winners.count);
+        STATS_SWITCH(STATS_PHASE_METADATA);
+        Metadata_Gather(options, &winners, reader.reader.fd, mask, jobs);
+    }
+
+    else
     {
-        /* Enable hidden files */
-        OptionsFlags[SHOW_HIDDEN_OPTION_a] = 1;
+        TopK_Init(&heap, options->head_count, mode, reverse);
+
+        /* End of a getdents batch => stat it and keep only the entries that rank */
+        while ((status = LsrReader_ReadBatch(&reader, STREAM_BATCH_MAX_ENTRIES)) > 0)
+        {
+            OfferBatch(options, &heap, &batch, reader.reader.fd, mask, jobs);
+        }
+
+        OfferBatch(options, &heap, &batch, reader.reader.fd, mask, jobs);
 
-        /* Disable long format option */
-        OptionsFlags[LONG_FORMAT_OPTION_l] = 0;
+        TopK_Collect(&heap, &winners);
+        TopK_Free(&heap);
     }
 
-    /* Loop over the entries in the directory and store them in the array */
-    while ((entry = readdir(dp)) != NULL)
+    if (status < 0)
     {
+        perror("Error reading directory");
+    }
+
+    LsrReader_Close(&reader);
+    EntryTable_Free(&batch);
 
-        /* if -a option is not used => skip hidden files */
-        if (!OptionsFlags[SHOW_HIDDEN_OPTION_a] && (entry->d_name[0] == '.'))
+    STATS_SWITCH(STATS_PHASE_SORT);
+    Sort_Entries(&winners, mode, reverse);
+    STATS_SWITCH(STATS_PHASE_FORMAT);
+
+    /* Not a terminal or -1 => one name per line, like a streamed listing */
+    if (options->output_format == OUTPUT_FORMAT_TEXT && UsesLineLayout(options))
+    {
+        for (size_t i = 0; i < winners.count; i++)
         {
-            continue; // Skip hidden files
+            PrintLine(options, out, winners.sorted[i]);
+            OutBuf_Putc(out, '\n');
         }
 
-        /* Allocate memory for the file name and copy it */
-        file_names[file_count] = malloc(strlen(entry->d_name) + 1);
+        OutBuf_Putc(out, '\n');
+    }
+    else
+    {
+        PrintSorted(options, out, winners.sorted, winners.count, dir);
+    }
+
+    STATS_END();
+
+    EntryTable_Free(&winners);
+}
+
+/**
+ * @brief Tells whether a name is "." or "..".
+ */
+static int IsDotEntry(const char *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/**
+ * @brief Tells whether the output shows status fields that change without the directory
+ *        changing (sizes, times, link counts...), so the ones of a snapshot cannot be shown.
+ */
+static int NeedsCurrentStatus(const Options_t *options)
+{
+    int mode = Sort_SelectMode(options);
+
+    return options->flags[LONG_FORMAT_OPTION_l] || options->flags[SHOW_BLOCKS_OPTION_s] ||
+           Records_NeedMetadata(options) || (mode >= SORT_MTIME && mode <= SORT_SIZE);
+}
 
-        if (file_names[file_count] == NULL)
+/**
+ * @brief Reads a directory with the help of a snapshot of it.
+ *
+ * A current snapshot gives the names without reading the directory at all. Otherwise the
+ * directory is read, and an entry whose name, inode and type are in the snapshot takes its
+ * metadata from it; only the other entries are gathered. When the output shows sizes or times
+ * (see NeedsCurrentStatus), every entry is gathered and the snapshot only saves the read.
+ * Every entry is kept, hidden ones too. "." and ".." are always gathered: their metadata
+ * changes without their names changing.
+ *
+ * @param reader The opened directory.
+ * @param snapshot The snapshot (empty if there is none).
+ * @param dir_buf Status of the directory, taken before reading it.
+ * @param table Table receiving the entries: the ones from the snapshot first, then the gathered ones.
+ * @param fresh Table holding the gathered entries (their link targets live in its arena).
+ * @param jobs Metadata threads for the gathered entries (0: automatic).
+ *
+ * @return Number of entries taken from the snapshot.
+ */
+static size_t ReadWithSnapshot(const Options_t *options, DirReader_t *reader, const Snapshot_t *snapshot, const struct stat *dir_buf,
+                               EntryTable_t *table, EntryTable_t *fresh, int jobs)
+{
+    DirRecord_t record;
+    int status;
+    int reuse_status = !NeedsCurrentStatus(options);
+
+    /* Same directory with the same timestamps => same names, no readdir */
+    if (Snapshot_IsCurrent(snapshot, dir_buf))
+    {
+        for (uint64_t i = 0; i < snapshot->header->count; i++)
         {
-            perror("Memory allocation failed");
-            exit(1);
+            const SnapshotRecord_t *known = &snapshot->records[i];
+            const char *name = Snapshot_Name(snapshot, known);
+
+            if (IsDotEntry(name) || !reuse_status)
+            {
+                FileEntry_t *file_entry = EntryTable_Append(fresh, name, strlen(name));
+                file_entry->d_type = known->d_type;
+                file_entry->d_ino = known->ino;
+            }
+            else
+            {
+                Snapshot_Fill(snapshot, known, EntryTable_Append(table, name, strlen(name)));
+            }
         }
+    }
+    else
+    {
+        int same_dir = Snapshot_IsOf(snapshot, dir_buf);
 
-        strcpy(file_names[file_count], entry->d_name);
-        file_count++;
+        while ((status = DirReader_Next(reader, &record)) > 0)
+        {
+            const SnapshotRecord_t *known = same_dir ? Snapshot_Find(snapshot, record.name) : NULL;
+
+            /* Same name and inode => the same file as in the snapshot */
+            if (reuse_status && known != NULL && known->ino == record.d_ino && !IsDotEntry(record.name) &&
+                (record.d_type == DT_UNKNOWN || record.d_type == known->d_type))
+            {
+                Snapshot_Fill(snapshot, known, EntryTable_Append(table, record.name, record.name_len));
+            }
+            else
+            {
+                FileEntry_t *file_entry = EntryTable_Append(fresh, record.name, record.name_len);
+                file_entry->d_type = record.d_type;
+                file_entry->d_ino = record.d_ino;
+            }
+        }
 
-        if (file_count >= MAX_FILES)
+        if (status < 0)
         {
-            fprintf(stderr, "Too many files in directory\n");
-            break;
+            perror("Error reading directory");
         }
     }
 
-    closedir(dp);
+    STATS_COUNT(STATS_ENTRIES, table->count + fresh->count);
+    STATS_SWITCH(STATS_PHASE_METADATA);
 
-    /* Sort Entries */
+    /* Only the new entries are stat'ed (all of them when the output shows their status) */
+    Metadata_Gather(options, fresh, reader->fd, Metadata_BuildMask(options), jobs);
 
-    /* if -t option is used => sort by modification time */
-    if (OptionsFlags[SORT_BY_TIME_OPTION_t] == 1)
+    size_t reused = table->count;
+    for (size_t i = 0; i < fresh->count; i++)
     {
-        qsort(file_names, file_count, sizeof(char *), CompareFileModTime);
+        FileEntry_t *file_entry = EntryTable_Append(table, fresh->items[i].name, strlen(fresh->items[i].name));
+        char *name = file_entry->name;
+
+        *file_entry = fresh->items[i];
+        file_entry->name = name;
     }
 
-    /* if -lut are used or -u only is used => sort by access time */
-    else if ((OptionsFlags[ACCESS_TIME_OPTION_u] && OptionsFlags[SORT_BY_TIME_OPTION_t] && OptionsFlags[LONG_FORMAT_OPTION_l]) || (OptionsFlags[ACCESS_TIME_OPTION_u] && !OptionsFlags[LONG_FORMAT_OPTION_l]))
+    return reused;
+}
+
+/**
+ * @brief Tells whether an entry differs from its record in a snapshot.
+ */
+static int IsModified(const FileEntry_t *entry, const SnapshotRecord_t *record)
+{
+    return entry->buf.st_ino != record->ino || entry->buf.st_mode != record->mode ||
+           entry->buf.st_size != record->size || entry->buf.st_nlink != record->nlink ||
+           entry->buf.st_uid != record->uid || entry->buf.st_gid != record->gid ||
+           entry->buf.st_mtim.tv_sec * 1000000000LL + entry->buf.st_mtim.tv_nsec != record->mtime_ns ||
+           entry->buf.st_ctim.tv_sec * 1000000000LL + entry->buf.st_ctim.tv_nsec != record->ctime_ns;
+}
+
+void PrintLine(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry)
+{
+    if (options->flags[LONG_FORMAT_OPTION_l])
     {
-        /* ls -ltu or ls -u => sort by access time */
-        qsort(file_names, file_count, sizeof(char *), CompareFileAccessTime);
+        PrintEntry_LongFormat(options, out, entry);
+        return;
     }
 
-    else if ((OptionsFlags[CHANGE_TIME_OPTION_c] && OptionsFlags[SORT_BY_TIME_OPTION_t] && OptionsFlags[LONG_FORMAT_OPTION_l]) || (OptionsFlags[CHANGE_TIME_OPTION_c] && !OptionsFlags[LONG_FORMAT_OPTION_l]))
+    if (options->flags[SHOW_INODE_OPTION_i])
     {
-        /* ls -ltc or ls -c => sort by change time */
-        qsort(file_names, file_count, sizeof(char *), CompareFileChangeTime);
+        OutBuf_PutUInt(out, entry->buf.st_ino, 0);
+        OutBuf_PutLiteral(out, "  ");
     }
 
-    else if (OptionsFlags[DISABLE_EVERYTING_OPTION_f])
+    if (options->flags[SHOW_BLOCKS_OPTION_s])
     {
-        /* Do not sort */
+        PrintBlocks(out, entry, 0);
     }
 
+    if (options->flags[DISABLE_EVERYTING_OPTION_f])
+    {
+        OutBuf_Puts(out, entry->name);
+    }
     else
     {
-        /* Sort by name */
-        qsort(file_names, file_count, sizeof(char *), CompareFileName);
+        PrintEntry(options, out, entry, 0);
     }
+}
 
-    /* If -l option is used => print in long format */
-    if (OptionsFlags[LONG_FORMAT_OPTION_l] == 1)
+void PrintChange(const Options_t *options, OutBuf_t *out, char mark, const FileEntry_t *entry)
+{
+    /* Hidden (without -a) and filtered out files are not reported ("." and ".." never are) */
+    if (!Options_Accept(options, entry->name, strlen(entry->name)) || IsDotEntry(entry->name))
     {
-        LongFormat_ls(file_names, file_count, dir);
+        return;
     }
 
-    /* print file names only */
+    OutBuf_Putc(out, mark);
+    OutBuf_Putc(out, ' ');
+    PrintLine(options, out, entry);
+    OutBuf_Putc(out, '\n');
+}
+
+/**
+ * @brief Prints the entries added, removed or modified since a snapshot, in name order.
+ *
+ * @param out The output buffer.
+ * @param snapshot The snapshot compared with.
+ * @param entries Every entry of the directory, sorted by name.
+ * @param count Number of entries.
+ * @param fresh_start First entry that was not taken from the snapshot (the others are unchanged).
+ */
+static void PrintDiff(const Options_t *options, OutBuf_t *out, const Snapshot_t *snapshot, FileEntry_t *entries[], size_t count,
+                      const FileEntry_t *fresh_start)
+{
+    size_t old_count = (snapshot->header != NULL) ? snapshot->header->count : 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    /* Both lists are in strcmp order => one merge pass */
+    while (i < old_count || j < count)
+    {
+        const SnapshotRecord_t *record = (i < old_count) ? &snapshot->records[i] : NULL;
+        int cmp = (record == NULL) ? 1 :
+                  (j == count) ? -1 : strcmp(Snapshot_Name(snapshot, record), entries[j]->name);
+
+        if (cmp < 0)
+        {
+            FileEntry_t removed;
+
+            removed.name = (char *)Snapshot_Name(snapshot, record);
+            Snapshot_Fill(snapshot, record, &removed);
+            PrintChange(options, out, '-', &removed);
+            i++;
+        }
+        else if (cmp > 0)
+        {
+            PrintChange(options, out, '+', entries[j]);
+            j++;
+        }
+        else
+        {
+            if (entries[j] >= fresh_start && IsModified(entries[j], record))
+            {
+                PrintChange(options, out, 'M', entries[j]);
+            }
+            i++;
+            j++;
+        }
+    }
+}
+
+/**
+ * @brief Lists a directory with --snapshot and/or --diff-against.
+ *
+ * The snapshot read is the --diff-against one if given, else the --snapshot one. The listing
+ * (or the differences) is printed, then the --snapshot file is rewritten if it is out of date.
+ */
+static void Snapshot_ls(const Options_t *options, OutBuf_t *out, char *dir, int jobs)
+{
+    const char *base = (options->diff_against_path != NULL) ? options->diff_against_path : options->snapshot_path;
+    Snapshot_t snapshot;
+    DirReader_t reader;
+    EntryTable_t table;
+    EntryTable_t fresh;
+    StatsProfile_t stats;
+    struct stat dir_buf;
+
+    /* A missing --snapshot file is normal on the first run */
+    if (Snapshot_Open(&snapshot, base) < 0 && options->diff_against_path != NULL)
+    {
+        fprintf(stderr, "Cannot read snapshot: %s\n", options->diff_against_path);
+        return;
+    }
+
+    if (DirReader_Open(&reader, dir, options->dir_buffer_size) < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", dir);
+        Snapshot_Close(&snapshot);
+        return;
+    }
+
+    STATS_BEGIN(&stats, dir);
+
+    /* Taken before reading => a change made while reading is seen by the next run */
+    if (fstat(reader.fd, &dir_buf) < 0)
+    {
+        perror("Error in stat");
+        STATS_END();
+        DirReader_Close(&reader);
+        Snapshot_Close(&snapshot);
+        return;
+    }
+
+    int current = Snapshot_IsCurrent(&snapshot, &dir_buf);
+
+    /* Nothing added, removed or renamed => no difference, whatever the directory size (unless
+       the entries are compared field by field) */
+    if (current && options->diff_against_path != NULL && !NeedsCurrentStatus(options) &&
+        (options->snapshot_path == NULL || strcmp(options->snapshot_path, base) == 0))
+    {
+        STATS_END();
+        DirReader_Close(&reader);
+        Snapshot_Close(&snapshot);
+        return;
+    }
+
+    EntryTable_Init(&table);
+    EntryTable_Init(&fresh);
+
+    size_t reused = ReadWithSnapshot(options, &reader, &snapshot, &dir_buf, &table, &fresh, jobs);
+    DirReader_Close(&reader);
+
+    STATS_SWITCH(STATS_PHASE_SORT);
+
+    /* Snapshot order, needed to compare or to write one */
+    FileEntry_t **by_name = malloc((table.count + 1) * sizeof(FileEntry_t *));
+    if (by_name == NULL)
+    {
+        perror("Error allocating memory");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < table.count; i++)
+    {
+        by_name[i] = &table.items[i];
+    }
+
+    Snapshot_SortNames(by_name, table.count);
+
+    if (options->diff_against_path != NULL)
+    {
+        STATS_SWITCH(STATS_PHASE_FORMAT);
+        PrintDiff(options, out, &snapshot, by_name, table.count, &table.items[reused]);
+    }
     else
     {
-        Basic_ls(file_names, file_count, dir);
-        printf("\n");
+        Sort_Entries(&table, Sort_SelectMode(options), options->flags[REVERSE_OPTION_r]);
+        STATS_SWITCH(STATS_PHASE_FORMAT);
+
+        /* The snapshot keeps every entry => drop the hidden and filtered out ones here */
+        size_t shown = 0;
+        for (size_t i = 0; i < table.count; i++)
+        {
+            if (Options_Accept(options, table.sorted[i]->name, strlen(table.sorted[i]->name)))
+            {
+                table.sorted[shown++] = table.sorted[i];
+            }
+        }
+
+        if (options->head_count > 0 && options->head_count < shown)
+        {
+            shown = options->head_count;
+        }
+
+        PrintSorted(options, out, table.sorted, shown, dir);
     }
-}
\ No newline at end of file
+
+    /* Out of date (or written from another snapshot) => rewrite it; link targets still point
+       into the old mapping, which stays valid after the rename */
+    if (options->snapshot_path != NULL && (!current || strcmp(options->snapshot_path, base) != 0))
+    {
+        if (Snapshot_Write(options->snapshot_path, &dir_buf, by_name, table.count) < 0)
+        {
+            fprintf(stderr, "Cannot write snapshot %s: %s\n", options->snapshot_path, strerror(errno));
+        }
+    }
+
+    STATS_END();
+
+    free(by_name);
+    EntryTable_Free(&fresh);
+    EntryTable_Free(&table);
+    Snapshot_Close(&snapshot);
+}
+
+void do_ls_into(const Options_t *options, OutBuf_t *out, char *dir, int jobs)
+{
+    /* Growable table of records holding file names and their metadata */
+    EntryTable_t table;
+
+    /* --snapshot, --diff-against => reuse what the snapshot knows */
+    if ((options->snapshot_path != NULL || options->diff_against_path != NULL) && !options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        Snapshot_ls(options, out, dir, jobs);
+        return;
+    }
+
+    /* --head, --newest, --largest => keep only the winners while reading */
+    if (options->head_count > 0 && !options->flags[SHOW_DIRECTORY_ITSELF_OPTION_d])
+    {
+        Head_ls(options, out, dir, jobs);
+        return;
+    }
+
+    /* Unsorted listing => print while reading */
+    if (CanStream(options))
+    {
+        Stream_ls(options, out, dir, jobs);
+        return;
+    }
+
+    Directory_ls(options, out, dir, &table, jobs);
+
+    /* Release all records and names at once */
+    EntryTable_Free(&table);
+}
+
+void do_ls(const Options_t *options, char *dir)
+{
+    do_ls_into(options, &Output, dir, options->jobs);
+}
@@ -23,6 +23,11 @@
 #include <grp.h>
 #include <time.h>
 
+#include "entries.h"
+#include "dirread.h"
+#include "outbuf.h"
+#include "filter.h"
+
 #define LONG_FORMAT_OPTION_l 0
 #define SHOW_HIDDEN_OPTION_a 1
 #define SORT_BY_TIME_OPTION_t 2
@@ -32,9 +37,109 @@
 #define DISABLE_EVERYTING_OPTION_f 6
 #define SHOW_DIRECTORY_ITSELF_OPTION_d 7
 #define SHOW_1_FILE_IN_LINE_OPTION_1 8
+#define DONT_SYNC_OPTION 9
+#define NO_EXEC_COLOR_OPTION 10
+#define RECURSIVE_OPTION_R 11
+#define UNSORTED_OPTION_U 12
+#define SORT_BY_SIZE_OPTION_S 13
+#define SORT_BY_EXTENSION_OPTION_X 14
+#define SORT_BY_VERSION_OPTION_v 15
+#define REVERSE_OPTION_r 16
+#define DEREFERENCE_OPTION_L 17
+#define DEREFERENCE_ARGS_OPTION_H 18
+#define SHOW_BLOCKS_OPTION_s 19
+
+/* Number of switches in Options_t.flags */
+#define OPTIONS_COUNT 20
+
+/* Width used for the tabular layout when stdout is not a terminal */
+#define DEFAULT_TERMINAL_WIDTH 80
+
+/* Largest batch printed at once by an unsorted (streamed) listing when the directory is read
+   with readdir; with getdents64 a batch is one buffer */
+#define STREAM_BATCH_MAX_ENTRIES 4096
+
+/* Long options without a short equivalent */
+#define DIRBUF_LONG_OPTION 256
+#define DONT_SYNC_LONG_OPTION 257
+#define NO_EXEC_COLOR_LONG_OPTION 258
+#define JOBS_LONG_OPTION 259
+#define IO_LONG_OPTION 260
+#define TIME_STYLE_LONG_OPTION 261
+#define HEAD_LONG_OPTION 262
+#define NEWEST_LONG_OPTION 263
+#define LARGEST_LONG_OPTION 264
+#define ZERO_LONG_OPTION 265
+#define JSON_LONG_OPTION 266
+#define BINARY_LONG_OPTION 267
+#define STATS_LONG_OPTION 268
+#define SNAPSHOT_LONG_OPTION 269
+#define DIFF_AGAINST_LONG_OPTION 270
+#define WATCH_LONG_OPTION 271
+#define DU_LONG_OPTION 272
+#define INCLUDE_LONG_OPTION 273
+#define EXCLUDE_LONG_OPTION 274
+#define HIDE_LONG_OPTION 275
+#define REGEX_LONG_OPTION 276
+
+/* Engines used to gather metadata (--io) */
+#define IO_ENGINE_SYNC 0
+#define IO_ENGINE_URING 1
+
+/* Timestamp formats of the long format (--time-style) */
+#define TIME_STYLE_DEFAULT 0   /* Www Mmm dd hh:mm:ss yyyy, as ctime() */
+#define TIME_STYLE_LOCALE 1    /* Mmm dd hh:mm for recent files, Mmm dd  yyyy otherwise */
+#define TIME_STYLE_ISO 2       /* mm-dd hh:mm for recent files, yyyy-mm-dd otherwise */
+#define TIME_STYLE_LONG_ISO 3  /* yyyy-mm-dd hh:mm */
+#define TIME_STYLE_FULL_ISO 4  /* yyyy-mm-dd hh:mm:ss.nnnnnnnnn +zzzz */
+
+/* Output formats (the machine-readable ones are written by records.c) */
+#define OUTPUT_FORMAT_TEXT 0    /* Columns or long format, for terminals */
+#define OUTPUT_FORMAT_ZERO 1    /* Names terminated by a null byte (--zero) */
+#define OUTPUT_FORMAT_JSON 2    /* One JSON object per entry and line (--json) */
+#define OUTPUT_FORMAT_BINARY 3  /* Fixed-layout binary records (--binary) */
+
+/**
+ * @brief Options of the listings, as given on the command line.
+ *
+ * main fills one before anything is listed (and every liblsr listing has its own) and passes
+ * it to every listing function; nothing writes it afterwards, so listings running on several
+ * threads share it.
+ */
+typedef struct
+{
+    int flags[OPTIONS_COUNT];       /* Switches, indexed by the *_OPTION_* numbers (1 => given) */
+    size_t dir_buffer_size;         /* Size of the directory read buffer in bytes (0 => use readdir) */
+    int jobs;                       /* Threads gathering metadata (0 => chosen from the number of entries) */
+    int io_engine;                  /* Engine used to gather metadata (IO_ENGINE_*) */
+    int time_style;                 /* Format of the timestamps printed by the long format (TIME_STYLE_*) */
+    int output_format;              /* Format of the listings (OUTPUT_FORMAT_*) */
+    int qualify_names;              /* --zero names are prefixed with their directory (several are listed) */
+    size_t head_count;              /* Entries listed per directory, the first ones in sort order (0 => all) */
+    const char *snapshot_path;      /* Snapshot reused and rewritten by the listing (--snapshot, NULL => none) */
+    const char *diff_against_path;  /* Snapshot the listing is compared with (--diff-against, NULL => none) */
+    int watch;                      /* The listing is kept up to date as the directory changes (--watch) */
+    const FilterSet_t *filter;      /* Compiled name patterns (NULL => none) */
+} Options_t;
+
+/**
+ * @brief Fills options with the defaults of myls: no switch, default buffer size and time
+ *        style, synchronous metadata, text output and no patterns.
+ *
+ * @param options The options.
+ */
+void Options_Init(Options_t *options);
 
-#define MAX_PATH_LENGTH 2048
-#define MAX_FILES 1000
+/**
+ * @brief Tells whether a name is listed: hidden names only with -a, and the patterns (if any).
+ *
+ * @param options The options of the listing.
+ * @param name The name.
+ * @param name_len Its length.
+ *
+ * @return 1 if the name is listed, 0 if it is filtered out.
+ */
+int Options_Accept(const Options_t *options, const char *name, size_t name_len);
 
 #ifndef S_ISVTX
 #define S_ISVTX 01000
@@ -47,11 +152,13 @@
  * based on file types, and supports various options such as displaying the directory itself,
  * showing inodes, and handling directory entries individually.
  *
- * @param file_names Array of file names in the directory.
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entries Entry records (names and cached metadata) of the directory, in display order.
  * @param file_count Number of files in the directory.
  * @param dir The directory path.
  */
-void Basic_ls(char *file_names[], int file_count, char *dir);
+void Basic_ls(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t file_count, char *dir);
 
 /**
  * @brief Perform `ls` functionality with long format option.
@@ -60,20 +167,99 @@ void Basic_ls(char *file_names[], int file_count, char *dir);
  * showing additional details such as permissions, owner, group, size, and time.
  * It also supports options for sorting and showing inodes.
  *
- * @param file_names Array of file names in the directory.
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entries Entry records (names and cached metadata) of the directory, in display order.
  * @param file_count Number of files in the directory.
  * @param dir The directory path.
  */
-void LongFormat_ls(char *file_names[], int file_count, char *dir);
+void LongFormat_ls(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t file_count, char *dir);
 
 /**
- * @brief Main function to list the contents of a directory.
+ * @brief Prints sorted entries in the layout selected by the options.
+ *
+ * Records (--zero, --json, --binary), long format or names in columns, as a listing would.
+ *
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entries Entry records of the directory, in display order.
+ * @param count Number of entries.
+ * @param dir The directory path.
+ */
+void PrintSorted(const Options_t *options, OutBuf_t *out, FileEntry_t *entries[], size_t count, char *dir);
+
+/**
+ * @brief Prints one entry on its own line, without the line break.
+ *
+ * Long format with -l, else the name (with its inode number for -i), in color unless -f.
+ *
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entry The entry record.
+ */
+void PrintLine(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry);
+
+/**
+ * @brief Prints one change of a directory: a mark ('+' added, '-' removed, 'M' modified) then
+ *        the entry on its line.
+ *
+ * Hidden entries are skipped unless -a; "." and ".." are always skipped.
+ *
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param mark The mark.
+ * @param entry The entry record.
+ */
+void PrintChange(const Options_t *options, OutBuf_t *out, char mark, const FileEntry_t *entry);
+
+/**
+ * @brief Lists the contents of a directory into an output buffer.
  *
  * This function opens the specified directory and lists its contents, supporting options such
- * as displaying hidden files, long format, and sorting by various criteria.
+ * as displaying hidden files, long format, and sorting by various criteria. The names are read
+ * first; then the metadata phase stats every entry exactly once (with statx relative to the
+ * directory descriptor, asking only for the fields the options need, possibly on several
+ * threads) and resolves symbolic links; sorting and printing use the cached result. Entries
+ * whose directory record type is enough for the requested output are not stat'ed at all.
+ * Only the output buffer and the table are written, so several directories can be listed at
+ * the same time from different threads.
+ *
+ * @param options The options of the listing.
+ * @param out The buffer receiving the listing.
+ * @param dir The directory path.
+ * @param table Output: the entries, in display order in table->sorted (must be released with
+ *        EntryTable_Free, even on failure).
+ * @param jobs Metadata threads (0: automatic, see Metadata_Gather).
+ *
+ * @return 0 on success, -1 if the directory could not be opened.
+ */
+int Directory_ls(const Options_t *options, OutBuf_t *out, char *dir, EntryTable_t *table, int jobs);
+
+/**
+ * @brief Main function to list the contents of a directory.
+ *
+ * Lists the directory with Directory_ls and appends the result to the stdout buffer (Output).
+ * Unsorted listings (-f, -U) with -1 or to a non-terminal, and unsorted records, are streamed
+ * instead: every batch of records is printed and written as soon as it is read, in constant
+ * memory, with one name per line and no padding. Text listings that start with a `total`
+ * line (-l, -s) are not streamed, since the total is only known once every entry is read.
+ *
+ * @param options The options of the listing.
+ * @param dir The directory path.
+ */
+void do_ls(const Options_t *options, char *dir);
+
+/**
+ * @brief Lists a directory like do_ls, into a given buffer.
+ *
+ * With a memory buffer (fd < 0), streamed listings are kept in memory until the caller writes
+ * them, so several directories can be listed at the same time from different threads.
  *
+ * @param options The options of the listing.
+ * @param out The buffer receiving the listing.
  * @param dir The directory path.
+ * @param jobs Metadata threads (0: automatic, see Metadata_Gather).
  */
-void do_ls(char *dir);
+void do_ls_into(const Options_t *options, OutBuf_t *out, char *dir, int jobs);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,220 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        outbuf.c               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "outbuf.h"
+#include "stats.h"
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+OutBuf_t Output = { NULL, 0, 0, 1 };
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Writes an I/O vector completely, retrying on partial writes and EINTR.
+ */
+static void WriteAll(int fd, struct iovec *iov, int iovcnt)
+{
+    STATS_WRITE_BEGIN();
+
+    while (iovcnt > 0)
+    {
+        ssize_t written = writev(fd, iov, iovcnt);
+        STATS_COUNT(STATS_WRITES, 1);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            perror("Error writing output");
+            exit(1);
+        }
+
+        STATS_COUNT(STATS_BYTES_WRITTEN, written);
+
+        /* Skip what was written */
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    STATS_WRITE_END();
+}
+
+/**
+ * @brief Makes room for len more bytes, flushing or growing the buffer.
+ */
+static void Reserve(OutBuf_t *out, size_t len)
+{
+    if (out->capacity - out->len >= len)
+    {
+        return;
+    }
+
+    if (out->fd >= 0 && out->data != NULL)
+    {
+        OutBuf_Flush(out);
+        if (out->capacity >= len)
+        {
+            return;
+        }
+    }
+
+    size_t capacity = out->capacity;
+    if (capacity == 0)
+    {
+        capacity = (out->fd >= 0) ? OUTBUF_DEFAULT_CAPACITY : OUTBUF_MEMORY_INITIAL_CAPACITY;
+    }
+    while (capacity - out->len < len)
+    {
+        capacity *= 2;
+    }
+
+    char *data = realloc(out->data, capacity);
+    if (data == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    out->data = data;
+    out->capacity = capacity;
+}
+
+void OutBuf_Init(OutBuf_t *out, int fd, size_t capacity)
+{
+    out->data = NULL;
+    out->len = 0;
+    out->capacity = 0;
+    out->fd = fd;
+
+    Reserve(out, capacity);
+}
+
+void OutBuf_Write(OutBuf_t *out, const char *data, size_t len)
+{
+    /* Large chunk on a descriptor: write buffer and chunk together instead of copying */
+    if (out->fd >= 0 && out->capacity - out->len < len && len >= OUTBUF_DEFAULT_CAPACITY / 2)
+    {
+        struct iovec iov[2];
+
+        iov[0].iov_base = out->data;
+        iov[0].iov_len = out->len;
+        iov[1].iov_base = (void *)data;
+        iov[1].iov_len = len;
+
+        WriteAll(out->fd, iov, 2);
+        out->len = 0;
+        return;
+    }
+
+    Reserve(out, len);
+    memcpy(out->data + out->len, data, len);
+    out->len += len;
+}
+
+void OutBuf_Puts(OutBuf_t *out, const char *str)
+{
+    OutBuf_Write(out, str, strlen(str));
+}
+
+void OutBuf_Putc(OutBuf_t *out, char c)
+{
+    if (out->len == out->capacity)
+    {
+        Reserve(out, 1);
+    }
+
+    out->data[out->len++] = c;
+}
+
+void OutBuf_Pad(OutBuf_t *out, char c, size_t n)
+{
+    Reserve(out, n);
+    memset(out->data + out->len, c, n);
+    out->len += n;
+}
+
+void OutBuf_PutsPadded(OutBuf_t *out, const char *str, size_t width)
+{
+    size_t len = strlen(str);
+
+    OutBuf_Write(out, str, len);
+    if (len < width)
+    {
+        OutBuf_Pad(out, ' ', width - len);
+    }
+}
+
+void OutBuf_PutUInt(OutBuf_t *out, unsigned long long value, size_t width)
+{
+    char digits[20];
+    size_t count = 0;
+
+    /* Produce the digits from the least significant one */
+    do
+    {
+        digits[sizeof(digits) - 1 - count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    if (count < width)
+    {
+        OutBuf_Pad(out, ' ', width - count);
+    }
+
+    OutBuf_Write(out, digits + sizeof(digits) - count, count);
+}
+
+void OutBuf_Flush(OutBuf_t *out)
+{
+    if (out->fd < 0 || out->len == 0)
+    {
+        return;
+    }
+
+    struct iovec iov;
+    iov.iov_base = out->data;
+    iov.iov_len = out->len;
+
+    WriteAll(out->fd, &iov, 1);
+    out->len = 0;
+}
+
+void OutBuf_Free(OutBuf_t *out)
+{
+    free(out->data);
+
+    out->data = NULL;
+    out->len = 0;
+    out->capacity = 0;
+}
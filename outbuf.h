@@ -0,0 +1,123 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        outbuf.h               ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _OUTBUF_H_
+#define _OUTBUF_H_
+
+#include <stddef.h>
+
+/* Capacity of the stdout buffer: output is written in chunks of this size */
+#define OUTBUF_DEFAULT_CAPACITY (256 * 1024)
+
+/* First allocation of a memory buffer (fd < 0); many of them may be alive at once */
+#define OUTBUF_MEMORY_INITIAL_CAPACITY 4096
+
+/* Appends a string literal (e.g. a color macro) without measuring it at run time */
+#define OutBuf_PutLiteral(out, literal) OutBuf_Write((out), (literal), sizeof(literal) - 1)
+
+/**
+ * @brief Append-only output buffer.
+ *
+ * A buffer bound to a file descriptor is flushed with write() whenever it fills up. A buffer
+ * without descriptor (fd < 0) keeps everything in memory and grows as needed.
+ */
+typedef struct
+{
+    char *data;         /* Buffered bytes */
+    size_t len;         /* Number of buffered bytes */
+    size_t capacity;    /* Size of data */
+    int fd;             /* Descriptor flushed to, or -1 for a memory buffer */
+} OutBuf_t;
+
+/* Buffer in front of standard output, used by all the printers */
+extern OutBuf_t Output;
+
+/**
+ * @brief Initializes an output buffer.
+ *
+ * @param out The buffer to initialize.
+ * @param fd Descriptor to flush to, or -1 for a growable memory buffer.
+ * @param capacity Initial capacity in bytes.
+ */
+void OutBuf_Init(OutBuf_t *out, int fd, size_t capacity);
+
+/**
+ * @brief Appends bytes to a buffer.
+ *
+ * When the bytes do not fit, the buffered data and the new bytes are written together with a
+ * single writev() (descriptor buffers) or the buffer grows (memory buffers).
+ *
+ * @param out The buffer.
+ * @param data The bytes to append.
+ * @param len Number of bytes.
+ */
+void OutBuf_Write(OutBuf_t *out, const char *data, size_t len);
+
+/**
+ * @brief Appends a null-terminated string.
+ *
+ * @param out The buffer.
+ * @param str The string.
+ */
+void OutBuf_Puts(OutBuf_t *out, const char *str);
+
+/**
+ * @brief Appends one character.
+ *
+ * @param out The buffer.
+ * @param c The character.
+ */
+void OutBuf_Putc(OutBuf_t *out, char c);
+
+/**
+ * @brief Appends a character repeated n times (memset, used for padding).
+ *
+ * @param out The buffer.
+ * @param c The character.
+ * @param n Number of repetitions.
+ */
+void OutBuf_Pad(OutBuf_t *out, char c, size_t n);
+
+/**
+ * @brief Appends a string, left-aligned and padded with spaces to a minimum width.
+ *
+ * @param out The buffer.
+ * @param str The string.
+ * @param width Minimum width.
+ */
+void OutBuf_PutsPadded(OutBuf_t *out, const char *str, size_t width);
+
+/**
+ * @brief Appends an unsigned number, right-aligned and padded with spaces to a minimum width.
+ *
+ * @param out The buffer.
+ * @param value The number.
+ * @param width Minimum width (0 for none).
+ */
+void OutBuf_PutUInt(OutBuf_t *out, unsigned long long value, size_t width);
+
+/**
+ * @brief Writes the buffered bytes to the buffer's descriptor.
+ *
+ * Does nothing for memory buffers.
+ *
+ * @param out The buffer.
+ */
+void OutBuf_Flush(OutBuf_t *out);
+
+/**
+ * @brief Releases a buffer's memory (without flushing it).
+ *
+ * @param out The buffer.
+ */
+void OutBuf_Free(OutBuf_t *out);
+
+#endif
@@ -0,0 +1,374 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        records.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <string.h>
+
+#include "options.h"
+#include "records.h"
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* JSON escapes of the control characters that have a short form (others use \u00XX) */
+static const char *const JsonShortEscapes[32] =
+{
+    ['\b'] = "\\b", ['\t'] = "\\t", ['\n'] = "\\n", ['\f'] = "\\f", ['\r'] = "\\r",
+};
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Converts a timestamp to nanoseconds since the epoch.
+ */
+static int64_t Nanoseconds(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/**
+ * @brief Writes a signed decimal number.
+ */
+static void PutInt(OutBuf_t *out, int64_t value)
+{
+    if (value < 0)
+    {
+        OutBuf_Putc(out, '-');
+        OutBuf_PutUInt(out, -(uint64_t)value, 0);
+    }
+    else
+    {
+        OutBuf_PutUInt(out, (uint64_t)value, 0);
+    }
+}
+
+/**
+ * @brief Measures the UTF-8 sequence starting with a byte of 0x80 or more.
+ *
+ * @return Its length (2 to 4), or 0 if it is not valid UTF-8 (stray continuation byte,
+ *         truncated or overlong sequence, surrogate or code point above U+10FFFF).
+ */
+static size_t Utf8SequenceLength(const unsigned char *s)
+{
+    if (s[0] >= 0xC2 && s[0] <= 0xDF)
+    {
+        return ((s[1] & 0xC0) == 0x80) ? 2 : 0;
+    }
+
+    if (s[0] >= 0xE0 && s[0] <= 0xEF)
+    {
+        /* E0 => no overlong form, ED => no surrogate */
+        unsigned char low = (s[0] == 0xE0) ? 0xA0 : 0x80;
+        unsigned char high = (s[0] == 0xED) ? 0x9F : 0xBF;
+
+        return (s[1] >= low && s[1] <= high && (s[2] & 0xC0) == 0x80) ? 3 : 0;
+    }
+
+    if (s[0] >= 0xF0 && s[0] <= 0xF4)
+    {
+        /* F0 => no overlong form, F4 => nothing above U+10FFFF */
+        unsigned char low = (s[0] == 0xF0) ? 0x90 : 0x80;
+        unsigned char high = (s[0] == 0xF4) ? 0x8F : 0xBF;
+
+        return (s[1] >= low && s[1] <= high && (s[2] & 0xC0) == 0x80 && (s[3] & 0xC0) == 0x80) ? 4 : 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Tells whether a string is valid UTF-8.
+ */
+static int IsUtf8(const char *str)
+{
+    const unsigned char *s = (const unsigned char *)str;
+
+    while (*s != '\0')
+    {
+        if (*s < 0x80)
+        {
+            s++;
+            continue;
+        }
+
+        size_t length = Utf8SequenceLength(s);
+        if (length == 0)
+        {
+            return 0;
+        }
+        s += length;
+    }
+
+    return 1;
+}
+
+void Records_PutJsonString(OutBuf_t *out, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *run = str;
+
+    OutBuf_Putc(out, '"');
+
+    for (; *str != '\0'; str++)
+    {
+        unsigned char c = (unsigned char)*str;
+
+        if (c >= 0x80)
+        {
+            size_t length = Utf8SequenceLength((const unsigned char *)str);
+
+            /* Valid sequence => copied as is */
+            if (length > 0)
+            {
+                str += length - 1;
+                continue;
+            }
+        }
+        else if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+
+        /* Copy the plain bytes before the escaped one in one go */
+        OutBuf_Write(out, run, str - run);
+        run = str + 1;
+
+        if (c >= 0x80)
+        {
+            /* A byte that is not UTF-8 => replacement character */
+            OutBuf_PutLiteral(out, "\\ufffd");
+        }
+        else if (c >= 0x20)
+        {
+            OutBuf_Putc(out, '\\');
+            OutBuf_Putc(out, (char)c);
+        }
+        else if (JsonShortEscapes[c] != NULL)
+        {
+            OutBuf_Puts(out, JsonShortEscapes[c]);
+        }
+        else
+        {
+            OutBuf_PutLiteral(out, "\\u00");
+            OutBuf_Putc(out, hex[c >> 4]);
+            OutBuf_Putc(out, hex[c & 0xF]);
+        }
+    }
+
+    OutBuf_Write(out, run, str - run);
+    OutBuf_Putc(out, '"');
+}
+
+/**
+ * @brief Writes the bytes of a string in base64 (RFC 4648, with padding), quoted.
+ */
+static void PutJsonBase64(OutBuf_t *out, const char *str)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char *s = (const unsigned char *)str;
+    size_t length = strlen(str);
+    size_t i = 0;
+
+    OutBuf_Putc(out, '"');
+
+    for (; i + 3 <= length; i += 3)
+    {
+        uint32_t group = ((uint32_t)s[i] << 16) | ((uint32_t)s[i + 1] << 8) | s[i + 2];
+
+        OutBuf_Putc(out, digits[group >> 18]);
+        OutBuf_Putc(out, digits[(group >> 12) & 0x3F]);
+        OutBuf_Putc(out, digits[(group >> 6) & 0x3F]);
+        OutBuf_Putc(out, digits[group & 0x3F]);
+    }
+
+    if (i < length)
+    {
+        uint32_t group = (uint32_t)s[i] << 16;
+
+        if (i + 1 < length)
+        {
+            group |= (uint32_t)s[i + 1] << 8;
+        }
+
+        OutBuf_Putc(out, digits[group >> 18]);
+        OutBuf_Putc(out, digits[(group >> 12) & 0x3F]);
+        OutBuf_Putc(out, (i + 1 < length) ? digits[(group >> 6) & 0x3F] : '=');
+        OutBuf_Putc(out, '=');
+    }
+
+    OutBuf_Putc(out, '"');
+}
+
+/**
+ * @brief Writes a JSON string member, then its raw bytes in base64 as "<key>_b64" if the string
+ *        is not valid UTF-8 (the string member then shows them as U+FFFD).
+ *
+ * @param out The output buffer.
+ * @param prefix What comes before the value: the separator, the quoted key and ':'.
+ * @param b64_prefix The same for the base64 member.
+ * @param str The string.
+ */
+static void PutJsonText(OutBuf_t *out, const char *prefix, const char *b64_prefix, const char *str)
+{
+    OutBuf_Puts(out, prefix);
+    Records_PutJsonString(out, str);
+
+    if (!IsUtf8(str))
+    {
+        OutBuf_Puts(out, b64_prefix);
+        PutJsonBase64(out, str);
+    }
+}
+
+/**
+ * @brief Writes a JSON number member: ,"key":value
+ */
+static void PutJsonNumber(OutBuf_t *out, const char *key, int64_t value)
+{
+    OutBuf_Putc(out, ',');
+    OutBuf_Putc(out, '"');
+    OutBuf_Puts(out, key);
+    OutBuf_PutLiteral(out, "\":");
+    PutInt(out, value);
+}
+
+void Records_WriteJson(OutBuf_t *out, const char *dir, const FileEntry_t *entry)
+{
+    const struct stat *buf = &entry->buf;
+
+    PutJsonText(out, "{\"name\":", ",\"name_b64\":", entry->name);
+
+    if (dir != NULL)
+    {
+        PutJsonText(out, ",\"dir\":", ",\"dir_b64\":", dir);
+    }
+
+    PutJsonNumber(out, "ino", (int64_t)buf->st_ino);
+    PutJsonNumber(out, "mode", buf->st_mode);
+    PutJsonNumber(out, "nlink", (int64_t)buf->st_nlink);
+    PutJsonNumber(out, "uid", buf->st_uid);
+    PutJsonNumber(out, "gid", buf->st_gid);
+    PutJsonNumber(out, "size", buf->st_size);
+    PutJsonNumber(out, "blocks", buf->st_blocks);
+    PutJsonNumber(out, "atime_ns", Nanoseconds(&buf->st_atim));
+    PutJsonNumber(out, "mtime_ns", Nanoseconds(&buf->st_mtim));
+    PutJsonNumber(out, "ctime_ns", Nanoseconds(&buf->st_ctim));
+
+    if (entry->link_target != NULL)
+    {
+        PutJsonText(out, ",\"target\":", ",\"target_b64\":", entry->link_target);
+    }
+
+    OutBuf_PutLiteral(out, "}\n");
+}
+
+/**
+ * @brief Writes one binary record: fixed part, strings, then padding.
+ */
+static void WriteBinary(OutBuf_t *out, Record_t *record, const char *name, const char *target)
+{
+    size_t name_len = strlen(name);
+    size_t target_len = (target != NULL) ? strlen(target) : 0;
+    size_t size = sizeof(Record_t) + name_len + 1 + ((target != NULL) ? target_len + 1 : 0);
+    size_t padded = (size + RECORDS_ALIGNMENT - 1) & ~(size_t)(RECORDS_ALIGNMENT - 1);
+
+    record->size = (uint32_t)padded;
+    record->name_len = (uint16_t)name_len;
+    record->target_len = (uint32_t)target_len;
+
+    OutBuf_Write(out, (const char *)record, sizeof(Record_t));
+    OutBuf_Write(out, name, name_len + 1);
+
+    if (target != NULL)
+    {
+        OutBuf_Write(out, target, target_len + 1);
+    }
+
+    OutBuf_Pad(out, '\0', padded - size);
+}
+
+void Records_Init(const Options_t *options, OutBuf_t *out)
+{
+    if (options->output_format == OUTPUT_FORMAT_BINARY)
+    {
+        RecordsHeader_t header;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RECORDS_MAGIC, sizeof(RECORDS_MAGIC));
+        header.version = RECORDS_VERSION;
+        header.byte_order = RECORDS_BYTE_ORDER;
+        header.header_size = sizeof(RecordsHeader_t);
+        header.record_size = sizeof(Record_t);
+
+        OutBuf_Write(out, (const char *)&header, sizeof(header));
+    }
+}
+
+int Records_NeedMetadata(const Options_t *options)
+{
+    return options->output_format == OUTPUT_FORMAT_JSON || options->output_format == OUTPUT_FORMAT_BINARY;
+}
+
+void Records_Directory(const Options_t *options, OutBuf_t *out, const char *dir)
+{
+    if (options->output_format == OUTPUT_FORMAT_BINARY)
+    {
+        Record_t record;
+
+        memset(&record, 0, sizeof(record));
+        record.kind = RECORD_KIND_DIRECTORY;
+        WriteBinary(out, &record, dir, NULL);
+    }
+}
+
+void Records_Write(const Options_t *options, OutBuf_t *out, const char *dir, const FileEntry_t *entry)
+{
+    switch (options->output_format)
+    {
+        case OUTPUT_FORMAT_ZERO:
+            if (options->qualify_names && dir != NULL)
+            {
+                OutBuf_Puts(out, dir);
+                OutBuf_Putc(out, '/');
+            }
+            OutBuf_Write(out, entry->name, strlen(entry->name) + 1);
+            break;
+
+        case OUTPUT_FORMAT_JSON:
+            Records_WriteJson(out, dir, entry);
+            break;
+
+        case OUTPUT_FORMAT_BINARY:
+        {
+            const struct stat *buf = &entry->buf;
+            Record_t record;
+
+            memset(&record, 0, sizeof(record));
+            record.kind = RECORD_KIND_ENTRY;
+            record.mode = buf->st_mode;
+            record.ino = buf->st_ino;
+            record.nlink = buf->st_nlink;
+            record.uid = buf->st_uid;
+            record.gid = buf->st_gid;
+            record.file_size = buf->st_size;
+            record.blocks = buf->st_blocks;
+            record.atime_ns = Nanoseconds(&buf->st_atim);
+            record.mtime_ns = Nanoseconds(&buf->st_mtim);
+            record.ctime_ns = Nanoseconds(&buf->st_ctim);
+
+            WriteBinary(out, &record, entry->name, entry->link_target);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
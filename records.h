@@ -0,0 +1,129 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        records.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _RECORDS_H_
+#define _RECORDS_H_
+
+#include <stdint.h>
+
+#include "entries.h"
+#include "options.h"
+#include "outbuf.h"
+
+/* Binary stream identification */
+#define RECORDS_MAGIC "MYLSREC"         /* First 8 bytes of the stream (with the null byte) */
+#define RECORDS_VERSION 1
+#define RECORDS_BYTE_ORDER 0x01020304   /* Written in the producer's byte order */
+#define RECORDS_ALIGNMENT 8             /* Every record starts on this boundary */
+
+/* Binary record kinds */
+#define RECORD_KIND_DIRECTORY 1         /* Starts the entries of a directory; name is its path */
+#define RECORD_KIND_ENTRY 2             /* One entry of the current directory */
+
+/**
+ * @brief Header written once at the start of a binary stream.
+ */
+typedef struct
+{
+    char magic[8];          /* RECORDS_MAGIC */
+    uint32_t version;       /* RECORDS_VERSION */
+    uint32_t byte_order;    /* RECORDS_BYTE_ORDER */
+    uint32_t header_size;   /* sizeof(RecordsHeader_t) */
+    uint32_t record_size;   /* sizeof(Record_t), the fixed part of every record */
+} RecordsHeader_t;
+
+/**
+ * @brief Fixed part of a binary record.
+ *
+ * It is followed by the name and the symbolic link target (each with a null byte), then by
+ * zero bytes up to the next multiple of RECORDS_ALIGNMENT. Fields that were not gathered are 0.
+ */
+typedef struct
+{
+    uint32_t size;          /* Size of the whole record, including the strings and the padding */
+    uint16_t kind;          /* RECORD_KIND_* */
+    uint16_t name_len;      /* Length of the name */
+    uint32_t target_len;    /* Length of the link target (0 => none) */
+    uint32_t mode;          /* st_mode (type and permission bits) */
+    uint64_t ino;
+    uint64_t nlink;
+    uint32_t uid;
+    uint32_t gid;
+    int64_t file_size;      /* st_size in bytes */
+    int64_t blocks;         /* st_blocks (512-byte units) */
+    int64_t atime_ns;       /* Timestamps in nanoseconds since the epoch */
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+} Record_t;
+
+/**
+ * @brief Starts a machine-readable output stream.
+ *
+ * Writes the header of a binary stream; the other formats have none.
+ *
+ * @param options The options of the listing (qualify_names => --zero prints "dir/name" paths).
+ * @param out The output buffer.
+ */
+void Records_Init(const Options_t *options, OutBuf_t *out);
+
+/**
+ * @brief Tells whether the active format prints the full metadata of every entry.
+ *
+ * @param options The options of the listing.
+ *
+ * @return 1 for JSON and binary records, 0 otherwise.
+ */
+int Records_NeedMetadata(const Options_t *options);
+
+/**
+ * @brief Writes a string as a quoted JSON string.
+ *
+ * Quotes, backslashes and control characters are escaped, and valid UTF-8 sequences are copied
+ * as they are. Names are not required to be UTF-8: a byte that does not belong to a valid
+ * sequence is written as U+FFFD, so the output is always valid JSON.
+ *
+ * @param out The output buffer.
+ * @param str The string.
+ */
+void Records_PutJsonString(OutBuf_t *out, const char *str);
+
+/**
+ * @brief Marks the start of a directory's entries (a directory record in binary streams).
+ *
+ * @param options The options of the listing.
+ * @param out The output buffer.
+ * @param dir Path of the listed directory.
+ */
+void Records_Directory(const Options_t *options, OutBuf_t *out, const char *dir);
+
+/**
+ * @brief Writes an entry as one JSON object on its own line, whatever the active format.
+ *
+ * @param out The output buffer.
+ * @param dir Directory holding the entry, or NULL to leave the "dir" field out.
+ * @param entry The entry (stat'ed, with its link target read for symbolic links).
+ */
+void Records_WriteJson(OutBuf_t *out, const char *dir, const FileEntry_t *entry);
+
+/**
+ * @brief Writes one entry in the active machine-readable format.
+ *
+ * No colors, padding or terminal width are involved: the fields are written straight from the
+ * record.
+ *
+ * @param options The options of the listing.
+ * @param out The output buffer.
+ * @param dir Directory holding the entry, or NULL if the name is a path of its own (-d).
+ * @param entry The entry.
+ */
+void Records_Write(const Options_t *options, OutBuf_t *out, const char *dir, const FileEntry_t *entry);
+
+#endif
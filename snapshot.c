@@ -0,0 +1,389 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        snapshot.c             ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "snapshot.h"
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Converts a timestamp to nanoseconds since the epoch.
+ */
+static int64_t Nanoseconds(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/**
+ * @brief Converts nanoseconds since the epoch to a timestamp.
+ */
+static struct timespec Timespec(int64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+
+    /* Times before the epoch keep a positive nanosecond part */
+    if (ts.tv_nsec < 0)
+    {
+        ts.tv_sec--;
+        ts.tv_nsec += 1000000000;
+    }
+
+    return ts;
+}
+
+/**
+ * @brief Tells whether an offset points inside the string area of a snapshot.
+ */
+static int InStrings(const SnapshotHeader_t *header, uint64_t offset)
+{
+    return offset >= header->strings_offset && offset - header->strings_offset < header->strings_size;
+}
+
+/**
+ * @brief Checks the layout of a mapped snapshot (every offset stays inside the file).
+ */
+static int Validate(const char *data, size_t size)
+{
+    const SnapshotHeader_t *header = (const SnapshotHeader_t *)data;
+
+    if (size < sizeof(*header) || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER ||
+        header->header_size != sizeof(SnapshotHeader_t) || header->record_size != sizeof(SnapshotRecord_t))
+    {
+        return -1;
+    }
+
+    /* Records fill the space between the header and the strings, which end the file */
+    if (header->count > (size - sizeof(*header)) / sizeof(SnapshotRecord_t) ||
+        header->strings_offset != sizeof(*header) + header->count * sizeof(SnapshotRecord_t) ||
+        header->strings_offset > size || header->strings_size != size - header->strings_offset)
+    {
+        return -1;
+    }
+
+    /* A null byte ends the area => every string starting inside it is terminated */
+    if (header->count > 0 && (header->strings_size == 0 || data[size - 1] != '\0'))
+    {
+        return -1;
+    }
+
+    const SnapshotRecord_t *records = (const SnapshotRecord_t *)(data + sizeof(*header));
+    for (uint64_t i = 0; i < header->count; i++)
+    {
+        if (!InStrings(header, records[i].name_offset) ||
+            (records[i].target_offset != SNAPSHOT_NO_TARGET && !InStrings(header, records[i].target_offset)))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int Snapshot_Open(Snapshot_t *snapshot, const char *path)
+{
+    struct stat buf;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if (fstat(fd, &buf) < 0 || !S_ISREG(buf.st_mode) || buf.st_size < (off_t)sizeof(SnapshotHeader_t))
+    {
+        close(fd);
+        return -1;
+    }
+
+    /* The mapping stays valid after the descriptor is closed */
+    void *data = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    if (Validate(data, buf.st_size) < 0)
+    {
+        munmap(data, buf.st_size);
+        return -1;
+    }
+
+    snapshot->data = data;
+    snapshot->size = buf.st_size;
+    snapshot->header = data;
+    snapshot->records = (const SnapshotRecord_t *)((const char *)data + sizeof(SnapshotHeader_t));
+
+    return 0;
+}
+
+void Snapshot_Close(Snapshot_t *snapshot)
+{
+    if (snapshot->data != NULL)
+    {
+        munmap((void *)snapshot->data, snapshot->size);
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+int Snapshot_IsOf(const Snapshot_t *snapshot, const struct stat *dir_buf)
+{
+    return snapshot->header != NULL &&
+           snapshot->header->dir_dev == (uint64_t)dir_buf->st_dev &&
+           snapshot->header->dir_ino == (uint64_t)dir_buf->st_ino;
+}
+
+int Snapshot_IsCurrent(const Snapshot_t *snapshot, const struct stat *dir_buf)
+{
+    return Snapshot_IsOf(snapshot, dir_buf) &&
+           !(snapshot->header->flags & SNAPSHOT_FLAG_RACY) &&
+           snapshot->header->dir_mtime_ns == Nanoseconds(&dir_buf->st_mtim) &&
+           snapshot->header->dir_ctime_ns == Nanoseconds(&dir_buf->st_ctim);
+}
+
+const char *Snapshot_Name(const Snapshot_t *snapshot, const SnapshotRecord_t *record)
+{
+    return snapshot->data + record->name_offset;
+}
+
+const SnapshotRecord_t *Snapshot_Find(const Snapshot_t *snapshot, const char *name)
+{
+    size_t low = 0;
+    size_t high = (snapshot->header != NULL) ? snapshot->header->count : 0;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        int cmp = strcmp(name, Snapshot_Name(snapshot, &snapshot->records[middle]));
+
+        if (cmp == 0)
+        {
+            return &snapshot->records[middle];
+        }
+
+        if (cmp < 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return NULL;
+}
+
+void Snapshot_Fill(const Snapshot_t *snapshot, const SnapshotRecord_t *record, FileEntry_t *entry)
+{
+    memset(&entry->buf, 0, sizeof(entry->buf));
+
+    entry->buf.st_dev = snapshot->header->dir_dev;
+    entry->buf.st_ino = record->ino;
+    entry->buf.st_rdev = record->rdev;
+    entry->buf.st_mode = record->mode;
+    entry->buf.st_nlink = record->nlink;
+    entry->buf.st_uid = record->uid;
+    entry->buf.st_gid = record->gid;
+    entry->buf.st_size = record->size;
+    entry->buf.st_blocks = record->blocks;
+    entry->buf.st_atim = Timespec(record->atime_ns);
+    entry->buf.st_mtim = Timespec(record->mtime_ns);
+    entry->buf.st_ctim = Timespec(record->ctime_ns);
+
+    entry->d_type = record->d_type;
+    entry->d_ino = record->ino;
+    entry->link_status = record->link_status;
+    entry->link_target = (record->target_offset != SNAPSHOT_NO_TARGET) ?
+                         (char *)snapshot->data + record->target_offset : NULL;
+    entry->valid = 1;
+}
+
+/**
+ * @brief Orders entries by name, as the records of a snapshot (qsort callback).
+ */
+static int CompareNames(const void *a, const void *b)
+{
+    const FileEntry_t *e1 = *(FileEntry_t *const *)a;
+    const FileEntry_t *e2 = *(FileEntry_t *const *)b;
+
+    return strcmp(e1->name, e2->name);
+}
+
+void Snapshot_SortNames(FileEntry_t *entries[], size_t count)
+{
+    qsort(entries, count, sizeof(entries[0]), CompareNames);
+}
+
+/**
+ * @brief Writes the header, the records and the strings of a snapshot to a stream.
+ */
+static int WriteContents(FILE *file, const struct stat *dir_buf, FileEntry_t *entries[], size_t count)
+{
+    SnapshotHeader_t header;
+    struct timespec now;
+    uint64_t strings_size = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        strings_size += strlen(entries[i]->name) + 1;
+        if (entries[i]->link_target != NULL)
+        {
+            strings_size += strlen(entries[i]->link_target) + 1;
+        }
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.header_size = sizeof(SnapshotHeader_t);
+    header.record_size = sizeof(SnapshotRecord_t);
+    header.dir_dev = dir_buf->st_dev;
+    header.dir_ino = dir_buf->st_ino;
+    header.dir_mtime_ns = Nanoseconds(&dir_buf->st_mtim);
+    header.dir_ctime_ns = Nanoseconds(&dir_buf->st_ctim);
+    header.count = count;
+    header.strings_offset = sizeof(header) + count * sizeof(SnapshotRecord_t);
+    header.strings_size = strings_size;
+
+    /* A change made right before the directory was read may share its timestamp */
+    clock_gettime(CLOCK_REALTIME, &now);
+    if (Nanoseconds(&now) - header.dir_mtime_ns < SNAPSHOT_RACY_WINDOW_NS ||
+        Nanoseconds(&now) - header.dir_ctime_ns < SNAPSHOT_RACY_WINDOW_NS)
+    {
+        header.flags |= SNAPSHOT_FLAG_RACY;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    /* Records, with the offsets the strings will have */
+    uint64_t offset = header.strings_offset;
+    for (size_t i = 0; i < count; i++)
+    {
+        const FileEntry_t *entry = entries[i];
+        SnapshotRecord_t record;
+
+        memset(&record, 0, sizeof(record));
+        record.name_offset = offset;
+        offset += strlen(entry->name) + 1;
+
+        record.target_offset = SNAPSHOT_NO_TARGET;
+        if (entry->link_target != NULL)
+        {
+            record.target_offset = offset;
+            offset += strlen(entry->link_target) + 1;
+        }
+
+        record.ino = entry->buf.st_ino;
+        record.rdev = entry->buf.st_rdev;
+        record.size = entry->buf.st_size;
+        record.blocks = entry->buf.st_blocks;
+        record.atime_ns = Nanoseconds(&entry->buf.st_atim);
+        record.mtime_ns = Nanoseconds(&entry->buf.st_mtim);
+        record.ctime_ns = Nanoseconds(&entry->buf.st_ctim);
+        record.mode = entry->buf.st_mode;
+        record.nlink = entry->buf.st_nlink;
+        record.uid = entry->buf.st_uid;
+        record.gid = entry->buf.st_gid;
+        record.d_type = entry->d_type;
+        record.link_status = entry->link_status;
+
+        fwrite(&record, sizeof(record), 1, file);
+    }
+
+    /* Strings, in the same order */
+    for (size_t i = 0; i < count; i++)
+    {
+        fwrite(entries[i]->name, strlen(entries[i]->name) + 1, 1, file);
+        if (entries[i]->link_target != NULL)
+        {
+            fwrite(entries[i]->link_target, strlen(entries[i]->link_target) + 1, 1, file);
+        }
+    }
+
+    return ferror(file) ? -1 : 0;
+}
+
+int Snapshot_Write(const char *path, const struct stat *dir_buf, FileEntry_t *entries[], size_t count)
+{
+    size_t path_len = strlen(path);
+    char *tmp_path = malloc(path_len + sizeof(".XXXXXX"));
+
+    if (tmp_path == NULL)
+    {
+        return -1;
+    }
+
+    memcpy(tmp_path, path, path_len);
+    memcpy(tmp_path + path_len, ".XXXXXX", sizeof(".XXXXXX"));
+
+    int fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+        free(tmp_path);
+        return -1;
+    }
+
+    /* mkstemp creates the file for its owner only, as a regular file would be by the umask */
+    mode_t umask_value = umask(0);
+    umask(umask_value);
+    fchmod(fd, 0666 & ~umask_value);
+
+    FILE *file = fdopen(fd, "w");
+    if (file == NULL)
+    {
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return -1;
+    }
+
+    int status = WriteContents(file, dir_buf, entries, count);
+
+    if (fclose(file) != 0)
+    {
+        status = -1;
+    }
+
+    if (status == 0 && rename(tmp_path, path) < 0)
+    {
+        status = -1;
+    }
+
+    if (status < 0)
+    {
+        int saved_errno = errno;
+        unlink(tmp_path);
+        errno = saved_errno;
+    }
+
+    free(tmp_path);
+    return status;
+}
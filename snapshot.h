@@ -0,0 +1,182 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        snapshot.h             ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "entries.h"
+
+/* Snapshot file identification */
+#define SNAPSHOT_MAGIC "MYLSSNAP"       /* First 8 bytes of the file (no null byte) */
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304  /* Written in the producer's byte order */
+
+/* Header flags */
+#define SNAPSHOT_FLAG_RACY 1            /* Taken too close to the directory's last change to be trusted */
+
+/* A directory changed less than this before the snapshot was taken may change again within
+   the same timestamp tick, which the next run could not see (file systems with coarse
+   timestamps); such snapshots are marked racy */
+#define SNAPSHOT_RACY_WINDOW_NS 2000000000LL
+
+/* Marks a record without a link target */
+#define SNAPSHOT_NO_TARGET UINT64_MAX
+
+/**
+ * @brief Header of a snapshot file.
+ *
+ * It is followed by `count` records sorted by name (strcmp order), then by the string area
+ * holding the null-terminated names and link targets. Every offset is from the file start.
+ */
+typedef struct
+{
+    char magic[8];          /* SNAPSHOT_MAGIC */
+    uint32_t version;       /* SNAPSHOT_VERSION */
+    uint32_t byte_order;    /* SNAPSHOT_BYTE_ORDER */
+    uint32_t header_size;   /* sizeof(SnapshotHeader_t) */
+    uint32_t record_size;   /* sizeof(SnapshotRecord_t) */
+    uint32_t flags;         /* SNAPSHOT_FLAG_* */
+    uint32_t reserved;
+    uint64_t dir_dev;       /* Identity of the directory ... */
+    uint64_t dir_ino;
+    int64_t dir_mtime_ns;   /* ... and its timestamps when it was read */
+    int64_t dir_ctime_ns;
+    uint64_t count;         /* Number of records (every entry, hidden ones included) */
+    uint64_t strings_offset;
+    uint64_t strings_size;
+} SnapshotHeader_t;
+
+/**
+ * @brief One entry of a snapshot, with its complete metadata.
+ */
+typedef struct
+{
+    uint64_t name_offset;   /* Offset of the name in the file */
+    uint64_t target_offset; /* Offset of the link target, or SNAPSHOT_NO_TARGET */
+    uint64_t ino;
+    uint64_t rdev;
+    int64_t size;
+    int64_t blocks;
+    int64_t atime_ns;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint32_t mode;
+    uint32_t nlink;
+    uint32_t uid;
+    uint32_t gid;
+    uint8_t d_type;         /* DT_* from the directory record */
+    uint8_t link_status;    /* BROKEN_LINK or PROPER_LINK */
+    uint8_t padding[6];
+} SnapshotRecord_t;
+
+/**
+ * @brief A snapshot file mapped in memory.
+ */
+typedef struct
+{
+    const char *data;                   /* The mapping */
+    size_t size;                        /* Size of the mapping */
+    const SnapshotHeader_t *header;
+    const SnapshotRecord_t *records;
+} Snapshot_t;
+
+/**
+ * @brief Maps a snapshot file and checks its layout.
+ *
+ * @param snapshot The snapshot to fill.
+ * @param path Path of the file.
+ *
+ * @return 0 on success, -1 if the file is missing or is not a valid snapshot.
+ */
+int Snapshot_Open(Snapshot_t *snapshot, const char *path);
+
+/**
+ * @brief Unmaps a snapshot.
+ *
+ * @param snapshot The snapshot to close (left empty; closing an empty snapshot does nothing).
+ */
+void Snapshot_Close(Snapshot_t *snapshot);
+
+/**
+ * @brief Tells whether a snapshot was taken of a directory.
+ *
+ * @param snapshot The snapshot.
+ * @param dir_buf Status of the directory.
+ *
+ * @return 1 for the same device and inode, 0 otherwise.
+ */
+int Snapshot_IsOf(const Snapshot_t *snapshot, const struct stat *dir_buf);
+
+/**
+ * @brief Tells whether the entries of a directory are still those of a snapshot.
+ *
+ * Adding, removing or renaming an entry changes the directory's modification time, so a
+ * directory with the same identity and timestamps (and a snapshot that is not racy) still has
+ * the same names. Changes made inside files do not touch the directory and are not seen.
+ *
+ * @param snapshot The snapshot.
+ * @param dir_buf Status of the directory.
+ *
+ * @return 1 if the snapshot can be used without reading the directory, 0 otherwise.
+ */
+int Snapshot_IsCurrent(const Snapshot_t *snapshot, const struct stat *dir_buf);
+
+/**
+ * @brief Returns the name of a record.
+ */
+const char *Snapshot_Name(const Snapshot_t *snapshot, const SnapshotRecord_t *record);
+
+/**
+ * @brief Looks a name up in a snapshot (binary search).
+ *
+ * @return The record, or NULL if the name is not in the snapshot.
+ */
+const SnapshotRecord_t *Snapshot_Find(const Snapshot_t *snapshot, const char *name);
+
+/**
+ * @brief Fills an entry's metadata from a record.
+ *
+ * The link target points into the mapping and stays valid until Snapshot_Close.
+ *
+ * @param snapshot The snapshot.
+ * @param record The record.
+ * @param entry The entry; its name is left as it is.
+ */
+void Snapshot_Fill(const Snapshot_t *snapshot, const SnapshotRecord_t *record, FileEntry_t *entry);
+
+/**
+ * @brief Sorts entries by name (strcmp order), the order of the records of a snapshot.
+ *
+ * @param entries The entries to sort.
+ * @param count Number of entries.
+ */
+void Snapshot_SortNames(FileEntry_t *entries[], size_t count);
+
+/**
+ * @brief Writes a snapshot of a directory.
+ *
+ * The file is written next to its final path and renamed over it, so readers (and a mapping
+ * of the previous snapshot) never see a partial file.
+ *
+ * @param path Path of the file.
+ * @param dir_buf Status of the directory, taken before it was read.
+ * @param entries Every entry of the directory, with complete metadata, sorted by name.
+ * @param count Number of entries.
+ *
+ * @return 0 on success, -1 on failure (errno is set).
+ */
+int Snapshot_Write(const char *path, const struct stat *dir_buf, FileEntry_t *entries[], size_t count);
+
+#endif
@@ -0,0 +1,542 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        sort.c                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <limits.h>
+
+#include "options.h"
+#include "sort.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Precomputed sort key of one entry.
+ */
+typedef struct
+{
+    uint64_t key;           /* Number to sort on, or the first 8 bytes of fold */
+    const char *fold;       /* Case-folded name */
+    FileEntry_t *entry;     /* The entry; its name is the final tiebreak */
+} SortItem_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* Lower case of every byte (C locale, like strcasecmp), filled on the first sort */
+static char FoldTable[256];
+static pthread_once_t FoldTableOnce = PTHREAD_ONCE_INIT;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+int Sort_SelectMode(const Options_t *options)
+{
+    /* if -t option is used => sort by modification time */
+    if (options->flags[SORT_BY_TIME_OPTION_t] == 1)
+    {
+        return SORT_MTIME;
+    }
+
+    /* if -lut are used or -u only is used => sort by access time */
+    else if ((options->flags[ACCESS_TIME_OPTION_u] && options->flags[SORT_BY_TIME_OPTION_t] && options->flags[LONG_FORMAT_OPTION_l]) || (options->flags[ACCESS_TIME_OPTION_u] && !options->flags[LONG_FORMAT_OPTION_l]))
+    {
+        /* ls -ltu or ls -u => sort by access time */
+        return SORT_ATIME;
+    }
+
+    else if ((options->flags[CHANGE_TIME_OPTION_c] && options->flags[SORT_BY_TIME_OPTION_t] && options->flags[LONG_FORMAT_OPTION_l]) || (options->flags[CHANGE_TIME_OPTION_c] && !options->flags[LONG_FORMAT_OPTION_l]))
+    {
+        /* ls -ltc or ls -c => sort by change time */
+        return SORT_CTIME;
+    }
+
+    else if (options->flags[SORT_BY_SIZE_OPTION_S])
+    {
+        return SORT_SIZE;
+    }
+
+    else if (options->flags[SORT_BY_EXTENSION_OPTION_X])
+    {
+        return SORT_EXTENSION;
+    }
+
+    else if (options->flags[SORT_BY_VERSION_OPTION_v])
+    {
+        return SORT_VERSION;
+    }
+
+    else if (options->flags[DISABLE_EVERYTING_OPTION_f] || options->flags[UNSORTED_OPTION_U])
+    {
+        /* Do not sort */
+        return SORT_NONE;
+    }
+
+    /* Sort by name */
+    return SORT_NAME;
+}
+
+/**
+ * @brief Copies a string into the arena in lower case (same folding as strcasecmp).
+ */
+static char *Fold(Arena_t *arena, const char *str, size_t len)
+{
+    char *fold = Arena_Alloc(arena, len + 1);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        fold[i] = FoldTable[(unsigned char)str[i]];
+    }
+    fold[len] = '\0';
+
+    return fold;
+}
+
+/**
+ * @brief Packs the first 8 bytes of a string, so that comparing the numbers orders the strings.
+ */
+static uint64_t Prefix(const char *str)
+{
+    uint64_t prefix = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        /* Shorter strings are padded with zero bytes, which sort first like the terminator */
+        prefix = (prefix << 8) | (unsigned char)*str;
+        if (*str != '\0')
+        {
+            str++;
+        }
+    }
+
+    return prefix;
+}
+
+/**
+ * @brief Orders by folded name, then by original name.
+ */
+static int CompareName(const void *p1, const void *p2)
+{
+    const SortItem_t *item1 = p1;
+    const SortItem_t *item2 = p2;
+
+    /* Most pairs are decided by the prefixes, without touching the strings */
+    if (item1->key != item2->key)
+        return (item1->key < item2->key) ? -1 : 1;
+
+    int result = strcmp(item1->fold, item2->fold);
+    return (result != 0) ? result : strcmp(item1->entry->name, item2->entry->name);
+}
+
+/**
+ * @brief Orders by name ignoring case, then by original name, without precomputed keys.
+ *
+ * Used for the ties of the time and size orders, which are usually few.
+ */
+static int CompareEntryName(const void *p1, const void *p2)
+{
+    const SortItem_t *item1 = p1;
+    const SortItem_t *item2 = p2;
+
+    int result = strcasecmp(item1->entry->name, item2->entry->name);
+    return (result != 0) ? result : strcmp(item1->entry->name, item2->entry->name);
+}
+
+/**
+ * @brief Returns the extension of a folded name (from its last '.'), or "".
+ */
+static const char *Extension(const char *fold)
+{
+    const char *dot = strrchr(fold, '.');
+    return (dot != NULL) ? dot : "";
+}
+
+/**
+ * @brief Orders by folded extension, then like CompareName.
+ */
+static int CompareExtension(const void *p1, const void *p2)
+{
+    const SortItem_t *item1 = p1;
+    const SortItem_t *item2 = p2;
+
+    int result = strcmp(Extension(item1->fold), Extension(item2->fold));
+    if (result != 0)
+        return result;
+
+    result = strcmp(item1->fold, item2->fold);
+    return (result != 0) ? result : strcmp(item1->entry->name, item2->entry->name);
+}
+
+/**
+ * @brief Orders by folded name with digit runs compared by value, then by original name.
+ */
+static int CompareVersion(const void *p1, const void *p2)
+{
+    const SortItem_t *item1 = p1;
+    const SortItem_t *item2 = p2;
+
+    int result = strverscmp(item1->fold, item2->fold);
+    return (result != 0) ? result : strcmp(item1->entry->name, item2->entry->name);
+}
+
+/**
+ * @brief Maps a nanosecond timestamp to a key where newer times sort first.
+ */
+static uint64_t TimeKey(const struct timespec *ts)
+{
+    int64_t ns = (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+
+    /* Flip the sign bit so unsigned order matches signed order, then invert for descending */
+    return ~((uint64_t)ns ^ (UINT64_C(1) << 63));
+}
+
+/**
+ * @brief Stable LSD radix sort of the items on their 64-bit key.
+ *
+ * The byte histograms are built in a single pass; passes where every key has the same byte
+ * (e.g. the high bytes of timestamps) are skipped.
+ */
+static void RadixSort(SortItem_t *items, size_t count)
+{
+    static __thread size_t histograms[8][256];
+
+    /* Nothing to order (the pass skipping below reads the first item) */
+    if (count < 2)
+    {
+        return;
+    }
+
+    SortItem_t *buffer = malloc(count * sizeof(SortItem_t));
+    SortItem_t *src = items;
+    SortItem_t *dst = buffer;
+
+    if (buffer == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    memset(histograms, 0, sizeof(histograms));
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int byte = 0; byte < 8; byte++)
+        {
+            histograms[byte][(src[i].key >> (8 * byte)) & 0xFF]++;
+        }
+    }
+
+    for (int byte = 0; byte < 8; byte++)
+    {
+        size_t *histogram = histograms[byte];
+        int shift = 8 * byte;
+
+        if (histogram[(src[0].key >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        /* Turn the counts into start offsets */
+        size_t offset = 0;
+        for (int value = 0; value < 256; value++)
+        {
+            size_t bucket = histogram[value];
+            histogram[value] = offset;
+            offset += bucket;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        SortItem_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != items)
+    {
+        memcpy(items, src, count * sizeof(SortItem_t));
+    }
+
+    free(buffer);
+}
+
+/**
+ * @brief Sorts the runs of items with equal numeric keys with a full comparison.
+ *
+ * The comparison must order the items consistently with their keys.
+ */
+static void SortRuns(SortItem_t *items, size_t count, int (*compare)(const void *, const void *))
+{
+    size_t start = 0;
+
+    while (start < count)
+    {
+        size_t end = start + 1;
+        while (end < count && items[end].key == items[start].key)
+        {
+            end++;
+        }
+
+        /* Runs left in order by a previous stable pass are only checked */
+        size_t i = start + 1;
+        while (i < end && compare(&items[i - 1], &items[i]) <= 0)
+        {
+            i++;
+        }
+
+        if (i < end)
+        {
+            qsort(items + start, end - start, sizeof(SortItem_t), compare);
+        }
+
+        start = end;
+    }
+}
+
+/**
+ * @brief Sorts the runs of items sharing a name prefix by the following 8 bytes.
+ *
+ * Large runs get the next 8 bytes of their folded names as key and go through the radix sort
+ * again (most significant chunk first); small runs and names that end inside the prefix are
+ * compared as strings.
+ *
+ * @param items Items in order of the name bytes before depth + 8.
+ * @param count Number of items.
+ * @param depth Offset of the bytes held by the current keys.
+ */
+static void SortNameRuns(SortItem_t *items, size_t count, size_t depth)
+{
+    size_t start = 0;
+
+    while (start < count)
+    {
+        size_t end = start + 1;
+        while (end < count && items[end].key == items[start].key)
+        {
+            end++;
+        }
+
+        size_t len = end - start;
+
+        /* A zero last byte means every name of the run ends inside the key */
+        if (len >= SORT_RADIX_MIN_RUN && (items[start].key & 0xFF) != 0)
+        {
+            for (size_t i = start; i < end; i++)
+            {
+                items[i].key = Prefix(items[i].fold + depth + 8);
+            }
+
+            RadixSort(items + start, len);
+            SortNameRuns(items + start, len, depth + 8);
+        }
+        else if (len > 1)
+        {
+            qsort(items + start, len, sizeof(SortItem_t), CompareName);
+        }
+
+        start = end;
+    }
+}
+
+/**
+ * @brief Fills FoldTable.
+ */
+static void InitFoldTable(void)
+{
+    for (int c = 0; c < 256; c++)
+    {
+        FoldTable[c] = (char)tolower(c);
+    }
+}
+
+void Sort_Entries(EntryTable_t *table, int mode, int reverse)
+{
+    size_t count = table->count;
+    SortItem_t *items = malloc((count > 0 ? count : 1) * sizeof(SortItem_t));
+    Arena_t arena = { NULL };
+
+    if (items == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    pthread_once(&FoldTableOnce, InitFoldTable);
+
+    /* Key phase: one key per entry */
+    for (size_t i = 0; i < count; i++)
+    {
+        FileEntry_t *entry = &table->items[i];
+        SortItem_t *item = &items[i];
+
+        item->entry = entry;
+        item->fold = NULL;
+        item->key = 0;
+
+        switch (mode)
+        {
+            case SORT_NONE:                                                     break;
+            case SORT_MTIME:    item->key = TimeKey(&entry->buf.st_mtim);   break;
+            case SORT_ATIME:    item->key = TimeKey(&entry->buf.st_atim);   break;
+            case SORT_CTIME:    item->key = TimeKey(&entry->buf.st_ctim);   break;
+            case SORT_SIZE:     item->key = ~(uint64_t)entry->buf.st_size;  break;
+
+            default:
+                item->fold = Fold(&arena, entry->name, strlen(entry->name));
+                item->key = Prefix(item->fold);
+                break;
+        }
+    }
+
+    /* Order phase */
+    switch (mode)
+    {
+        case SORT_NONE:
+            break;
+
+        /* Radix sort on the 8-byte prefixes, then the runs sharing a prefix on the next bytes */
+        case SORT_NAME:
+            RadixSort(items, count);
+            SortNameRuns(items, count, 0);
+            break;
+
+        /* Name order first, then a stable radix pass on the extension prefixes keeps it
+           inside every extension; only runs whose extensions are longer than the prefix
+           can still be out of order */
+        case SORT_EXTENSION:
+            RadixSort(items, count);
+            SortNameRuns(items, count, 0);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                items[i].key = Prefix(Extension(items[i].fold));
+            }
+
+            RadixSort(items, count);
+            SortRuns(items, count, CompareExtension);
+            break;
+
+        case SORT_VERSION:
+            qsort(items, count, sizeof(SortItem_t), CompareVersion);
+            break;
+
+        /* Time and size: radix sort on the numeric key, then ties by name */
+        default:
+            RadixSort(items, count);
+            SortRuns(items, count, CompareEntryName);
+            break;
+    }
+
+    /* Every comparison is a total order, so reversing the result reverses the sort */
+    if (reverse && mode != SORT_NONE && count > 1)
+    {
+        for (size_t i = 0, j = count - 1; i < j; i++, j--)
+        {
+            SortItem_t swap = items[i];
+            items[i] = items[j];
+            items[j] = swap;
+        }
+    }
+
+    /* Keep only the pointers: they are written over the items, which are read ahead of them */
+    FileEntry_t **sorted = (FileEntry_t **)items;
+    for (size_t i = 0; i < count; i++)
+    {
+        sorted[i] = items[i].entry;
+    }
+
+    free(table->sorted);
+    table->sorted = sorted;
+
+    Arena_Release(&arena);
+}
+
+/**
+ * @brief Copies a name in lower case into a NAME_MAX sized buffer.
+ */
+static void FoldInto(char *fold, const char *name)
+{
+    size_t i = 0;
+
+    for (; name[i] != '\0' && i < NAME_MAX; i++)
+    {
+        fold[i] = FoldTable[(unsigned char)name[i]];
+    }
+    fold[i] = '\0';
+}
+
+uint64_t Sort_Key(const FileEntry_t *entry, int mode)
+{
+    char fold[NAME_MAX + 1];
+
+    pthread_once(&FoldTableOnce, InitFoldTable);
+
+    switch (mode)
+    {
+        case SORT_MTIME:        return TimeKey(&entry->buf.st_mtim);
+        case SORT_ATIME:        return TimeKey(&entry->buf.st_atim);
+        case SORT_CTIME:        return TimeKey(&entry->buf.st_ctim);
+        case SORT_SIZE:         return ~(uint64_t)entry->buf.st_size;
+        case SORT_VERSION:      return 0;
+
+        case SORT_EXTENSION:
+            FoldInto(fold, entry->name);
+            return Prefix(Extension(fold));
+
+        default:
+            FoldInto(fold, entry->name);
+            return Prefix(fold);
+    }
+}
+
+int Sort_Compare(const FileEntry_t *entry1, uint64_t key1, const FileEntry_t *entry2, uint64_t key2, int mode)
+{
+    char fold1[NAME_MAX + 1];
+    char fold2[NAME_MAX + 1];
+    int result;
+
+    if (key1 != key2)
+        return (key1 < key2) ? -1 : 1;
+
+    /* Same rules as the comparators above, on folded copies made on the stack */
+    switch (mode)
+    {
+        case SORT_EXTENSION:
+        case SORT_VERSION:
+            FoldInto(fold1, entry1->name);
+            FoldInto(fold2, entry2->name);
+
+            if (mode == SORT_VERSION)
+            {
+                result = strverscmp(fold1, fold2);
+                break;
+            }
+
+            result = strcmp(Extension(fold1), Extension(fold2));
+            if (result == 0)
+                result = strcmp(fold1, fold2);
+            break;
+
+        default:
+            result = strcasecmp(entry1->name, entry2->name);
+            break;
+    }
+
+    return (result != 0) ? result : strcmp(entry1->name, entry2->name);
+}
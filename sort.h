@@ -0,0 +1,83 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        sort.h                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _SORT_H_
+#define _SORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "entries.h"
+#include "options.h"
+
+/* Sort orders */
+#define SORT_NONE 0         /* Directory order (-f, -U) */
+#define SORT_NAME 1         /* Name, ignoring case (default) */
+#define SORT_MTIME 2        /* Newest modification first (-t) */
+#define SORT_ATIME 3        /* Newest access first (-u) */
+#define SORT_CTIME 4        /* Newest status change first (-c) */
+#define SORT_SIZE 5         /* Largest first (-S) */
+#define SORT_EXTENSION 6    /* Extension, then name (-X) */
+#define SORT_VERSION 7      /* Name with numbers compared by value (-v) */
+
+/* Runs of names sharing a prefix shorter than this are compared as strings instead of going
+   through another radix pass */
+#define SORT_RADIX_MIN_RUN 64
+
+/**
+ * @brief Chooses the sort order matching the active options.
+ *
+ * @param options The options of the listing.
+ *
+ * @return One of the SORT_* values.
+ */
+int Sort_SelectMode(const Options_t *options);
+
+/**
+ * @brief Puts the entries of a table in display order.
+ *
+ * The key of every entry is computed once: a case-folded copy of the name for the name based
+ * orders, compared 8 bytes at a time through a numeric prefix, or a 64-bit number for the time
+ * and size orders (nanosecond timestamps). Numeric keys and name prefixes are sorted with an
+ * LSD radix sort, and only runs of equal keys are compared as strings. Ties are broken by
+ * name, so the result does not depend on the directory order. The records themselves are not
+ * moved: table->sorted receives pointers to them in order.
+ *
+ * @param table The table; its sorted array is (re)built, even for SORT_NONE.
+ * @param mode The sort order (SORT_*).
+ * @param reverse 1 to reverse the order (-r).
+ */
+void Sort_Entries(EntryTable_t *table, int mode, int reverse);
+
+/**
+ * @brief Computes the sort key of a single entry, for orderings built one entry at a time.
+ *
+ * @param entry The entry, with the metadata the mode needs.
+ * @param mode The sort order (SORT_*), not SORT_NONE.
+ *
+ * @return The key given to Sort_Compare.
+ */
+uint64_t Sort_Key(const FileEntry_t *entry, int mode);
+
+/**
+ * @brief Compares two entries in the order Sort_Entries would put them.
+ *
+ * @param entry1 The first entry.
+ * @param key1 Its key (see Sort_Key).
+ * @param entry2 The second entry.
+ * @param key2 Its key.
+ * @param mode The sort order (SORT_*), not SORT_NONE.
+ *
+ * @return Negative, zero or positive, like strcmp.
+ */
+int Sort_Compare(const FileEntry_t *entry1, uint64_t key1, const FileEntry_t *entry2, uint64_t key2, int mode);
+
+#endif
@@ -0,0 +1,373 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        stats.c                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "outbuf.h"
+#include "records.h"
+#include "stats.h"
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+int StatsEnabled = 0;
+
+/* Profile of the listing running on this thread (or helped by it) */
+static __thread StatsProfile_t *CurrentProfile = NULL;
+
+/* Thread CPU time when a helper thread attached to a profile */
+static __thread uint64_t AttachCpu;
+
+/* Work done outside of any listing: headers, final output flush, -R type checks */
+static StatsProfile_t Outside = { .phase = STATS_PHASE_NONE };
+
+/* Sum of the finished listings */
+static StatsProfile_t Totals = { .phase = STATS_PHASE_NONE };
+static pthread_mutex_t TotalsLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Monotonic time at Stats_Enable */
+static uint64_t RunStart;
+
+static const char *const CounterNames[STATS_COUNTER_COUNT] =
+{
+    "entries", "getdents", "statx", "stat", "readlink", "uring_enter",
+    "nss_lookups", "id_cache_hits", "link_cache_hits", "writes", "bytes_written",
+};
+
+static const char *const PhaseNames[STATS_PHASE_COUNT] =
+{
+    "read", "metadata", "sort", "format", "write",
+};
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Reads a clock in nanoseconds.
+ */
+static uint64_t ClockNs(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Charges the time since the last mark to the current phase of a profile.
+ */
+static void Charge(StatsProfile_t *profile)
+{
+    uint64_t wall = ClockNs(CLOCK_MONOTONIC);
+    uint64_t cpu = ClockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    if (profile->phase != STATS_PHASE_NONE)
+    {
+        profile->wall_ns[profile->phase] += wall - profile->mark_wall;
+
+        /* Helper threads add their CPU time to the same fields */
+        __atomic_fetch_add(&profile->cpu_ns[profile->phase], cpu - profile->mark_cpu, __ATOMIC_RELAXED);
+    }
+
+    profile->mark_wall = wall;
+    profile->mark_cpu = cpu;
+}
+
+/**
+ * @brief Adds the counters and times of a profile to another one.
+ */
+static void Accumulate(StatsProfile_t *dst, const StatsProfile_t *src)
+{
+    for (int i = 0; i < STATS_COUNTER_COUNT; i++)
+    {
+        dst->counters[i] += __atomic_load_n(&src->counters[i], __ATOMIC_RELAXED);
+    }
+
+    for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        dst->wall_ns[i] += src->wall_ns[i];
+        dst->cpu_ns[i] += src->cpu_ns[i];
+    }
+}
+
+/**
+ * @brief Writes nanoseconds as milliseconds with 3 decimals, right-aligned in a field.
+ */
+static void PutMs(OutBuf_t *out, uint64_t ns, int width)
+{
+    char text[32];
+
+    snprintf(text, sizeof(text), "%*.3f", width, ns / 1e6);
+    OutBuf_Puts(out, text);
+}
+
+/**
+ * @brief Formats a profile as a text block.
+ */
+static void FormatText(OutBuf_t *out, const StatsProfile_t *profile, const char *title)
+{
+    OutBuf_PutLiteral(out, "[stats] ");
+    OutBuf_Puts(out, title);
+    OutBuf_PutLiteral(out, "\n ");
+
+    for (int i = 0; i < STATS_COUNTER_COUNT; i++)
+    {
+        OutBuf_Putc(out, ' ');
+        OutBuf_Puts(out, CounterNames[i]);
+        OutBuf_Putc(out, ' ');
+        OutBuf_PutUInt(out, profile->counters[i], 0);
+
+        /* Two lines of counters */
+        if (i == STATS_COUNTER_COUNT / 2 - 1)
+        {
+            OutBuf_PutLiteral(out, "\n ");
+        }
+    }
+
+    OutBuf_PutLiteral(out, "\n  phase            wall ms       cpu ms\n");
+
+    for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        OutBuf_PutLiteral(out, "  ");
+        OutBuf_PutsPadded(out, PhaseNames[i], 10);
+        PutMs(out, profile->wall_ns[i], 12);
+        OutBuf_Putc(out, ' ');
+        PutMs(out, profile->cpu_ns[i], 12);
+        OutBuf_Putc(out, '\n');
+    }
+}
+
+/**
+ * @brief Formats a profile as one JSON object (without the closing brace).
+ */
+static void FormatJson(OutBuf_t *out, const StatsProfile_t *profile)
+{
+    OutBuf_PutLiteral(out, "{\"dir\":");
+    if (profile->dir != NULL)
+    {
+        Records_PutJsonString(out, profile->dir);
+    }
+    else
+    {
+        OutBuf_PutLiteral(out, "null");
+    }
+
+    for (int i = 0; i < STATS_COUNTER_COUNT; i++)
+    {
+        OutBuf_PutLiteral(out, ",\"");
+        OutBuf_Puts(out, CounterNames[i]);
+        OutBuf_PutLiteral(out, "\":");
+        OutBuf_PutUInt(out, profile->counters[i], 0);
+    }
+
+    OutBuf_PutLiteral(out, ",\"phases\":{");
+    for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        if (i > 0)
+        {
+            OutBuf_Putc(out, ',');
+        }
+
+        OutBuf_Putc(out, '"');
+        OutBuf_Puts(out, PhaseNames[i]);
+        OutBuf_PutLiteral(out, "\":{\"wall_ns\":");
+        OutBuf_PutUInt(out, profile->wall_ns[i], 0);
+        OutBuf_PutLiteral(out, ",\"cpu_ns\":");
+        OutBuf_PutUInt(out, profile->cpu_ns[i], 0);
+        OutBuf_Putc(out, '}');
+    }
+    OutBuf_Putc(out, '}');
+}
+
+/**
+ * @brief Writes a formatted report to stderr in one call, so reports of threads do not mix.
+ */
+static void Emit(OutBuf_t *out)
+{
+    fwrite(out->data, 1, out->len, stderr);
+    OutBuf_Free(out);
+}
+
+int Stats_ParseFormat(const char *name)
+{
+    if (name == NULL || strcmp(name, "text") == 0)
+    {
+        return STATS_FORMAT_TEXT;
+    }
+
+    if (strcmp(name, "json") == 0)
+    {
+        return STATS_FORMAT_JSON;
+    }
+
+    return -1;
+}
+
+void Stats_Enable(int format)
+{
+    StatsEnabled = format;
+    RunStart = ClockNs(CLOCK_MONOTONIC);
+}
+
+void Stats_Begin(StatsProfile_t *profile, const char *dir)
+{
+    memset(profile, 0, sizeof(*profile));
+    profile->dir = dir;
+    profile->phase = STATS_PHASE_READ;
+    profile->write_saved_phase = STATS_PHASE_NONE;
+    profile->mark_wall = ClockNs(CLOCK_MONOTONIC);
+    profile->mark_cpu = ClockNs(CLOCK_THREAD_CPUTIME_ID);
+
+    CurrentProfile = profile;
+}
+
+void Stats_Switch(int phase)
+{
+    StatsProfile_t *profile = CurrentProfile;
+
+    if (profile != NULL)
+    {
+        Charge(profile);
+        profile->phase = phase;
+    }
+}
+
+void Stats_End(void)
+{
+    StatsProfile_t *profile = CurrentProfile;
+    OutBuf_t out;
+
+    if (profile == NULL)
+    {
+        return;
+    }
+
+    Charge(profile);
+    profile->phase = STATS_PHASE_NONE;
+    CurrentProfile = NULL;
+
+    OutBuf_Init(&out, -1, 0);
+    if (StatsEnabled == STATS_FORMAT_JSON)
+    {
+        FormatJson(&out, profile);
+        OutBuf_PutLiteral(&out, "}\n");
+    }
+    else
+    {
+        FormatText(&out, profile, profile->dir);
+    }
+    Emit(&out);
+
+    pthread_mutex_lock(&TotalsLock);
+    Accumulate(&Totals, profile);
+    pthread_mutex_unlock(&TotalsLock);
+}
+
+void Stats_Count(int counter, uint64_t n)
+{
+    StatsProfile_t *profile = (CurrentProfile != NULL) ? CurrentProfile : &Outside;
+
+    __atomic_fetch_add(&profile->counters[counter], n, __ATOMIC_RELAXED);
+}
+
+StatsProfile_t *Stats_Current(void)
+{
+    return CurrentProfile;
+}
+
+void Stats_Attach(StatsProfile_t *profile)
+{
+    CurrentProfile = profile;
+    AttachCpu = ClockNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void Stats_Detach(void)
+{
+    StatsProfile_t *profile = CurrentProfile;
+
+    if (profile != NULL && profile->phase != STATS_PHASE_NONE)
+    {
+        uint64_t cpu = ClockNs(CLOCK_THREAD_CPUTIME_ID) - AttachCpu;
+        __atomic_fetch_add(&profile->cpu_ns[profile->phase], cpu, __ATOMIC_RELAXED);
+    }
+
+    CurrentProfile = NULL;
+}
+
+void Stats_WriteBegin(void)
+{
+    /* Only the main thread writes outside of a listing */
+    StatsProfile_t *profile = (CurrentProfile != NULL) ? CurrentProfile : &Outside;
+
+    Charge(profile);
+    profile->write_saved_phase = profile->phase;
+    profile->phase = STATS_PHASE_WRITE;
+}
+
+void Stats_WriteEnd(void)
+{
+    StatsProfile_t *profile = (CurrentProfile != NULL) ? CurrentProfile : &Outside;
+
+    Charge(profile);
+    profile->phase = profile->write_saved_phase;
+}
+
+void Stats_Report(void)
+{
+    StatsProfile_t total;
+    struct rusage usage;
+    OutBuf_t out;
+
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&TotalsLock);
+    Accumulate(&total, &Totals);
+    pthread_mutex_unlock(&TotalsLock);
+    Accumulate(&total, &Outside);
+
+    uint64_t wall = ClockNs(CLOCK_MONOTONIC) - RunStart;
+    getrusage(RUSAGE_SELF, &usage);
+    uint64_t user = (uint64_t)usage.ru_utime.tv_sec * 1000000000 + (uint64_t)usage.ru_utime.tv_usec * 1000;
+    uint64_t sys = (uint64_t)usage.ru_stime.tv_sec * 1000000000 + (uint64_t)usage.ru_stime.tv_usec * 1000;
+
+    OutBuf_Init(&out, -1, 0);
+    if (StatsEnabled == STATS_FORMAT_JSON)
+    {
+        FormatJson(&out, &total);
+        OutBuf_PutLiteral(&out, ",\"total\":true,\"wall_ns\":");
+        OutBuf_PutUInt(&out, wall, 0);
+        OutBuf_PutLiteral(&out, ",\"user_ns\":");
+        OutBuf_PutUInt(&out, user, 0);
+        OutBuf_PutLiteral(&out, ",\"sys_ns\":");
+        OutBuf_PutUInt(&out, sys, 0);
+        OutBuf_PutLiteral(&out, ",\"max_rss_kib\":");
+        OutBuf_PutUInt(&out, usage.ru_maxrss, 0);
+        OutBuf_PutLiteral(&out, "}\n");
+    }
+    else
+    {
+        FormatText(&out, &total, "total");
+        OutBuf_PutLiteral(&out, "  run: wall ");
+        PutMs(&out, wall, 0);
+        OutBuf_PutLiteral(&out, " ms, user ");
+        PutMs(&out, user, 0);
+        OutBuf_PutLiteral(&out, " ms, sys ");
+        PutMs(&out, sys, 0);
+        OutBuf_PutLiteral(&out, " ms, max RSS ");
+        OutBuf_PutUInt(&out, usage.ru_maxrss, 0);
+        OutBuf_PutLiteral(&out, " KiB\n");
+    }
+    Emit(&out);
+}
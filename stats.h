@@ -0,0 +1,174 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        stats.h                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdint.h>
+
+/* Counters and timers are built in unless compiled with -DMYLS_STATS=0 (make STATS=0), which
+   turns every STATS_* hook below into nothing */
+#ifndef MYLS_STATS
+#define MYLS_STATS 1
+#endif
+
+/* Counters */
+#define STATS_ENTRIES 0         /* Entries listed */
+#define STATS_GETDENTS 1        /* getdents64 calls (not counted with --dirbuf=0: libc issues them) */
+#define STATS_STATX 2           /* statx calls, io_uring requests included */
+#define STATS_STAT 3            /* fstatat/lstat calls (no statx, link target checks, -R type checks) */
+#define STATS_READLINK 4        /* readlinkat calls */
+#define STATS_URING_ENTER 5     /* io_uring_enter calls */
+#define STATS_NSS_LOOKUPS 6     /* getpwuid/getgrgid calls */
+#define STATS_ID_CACHE_HITS 7   /* Owner/group names served by the id cache */
+#define STATS_LINK_CACHE_HITS 8 /* Symbolic link targets served by the link cache */
+#define STATS_WRITES 9          /* writev calls on the output */
+#define STATS_BYTES_WRITTEN 10  /* Bytes written to the output */
+#define STATS_COUNTER_COUNT 11
+
+/* Phases of a listing */
+#define STATS_PHASE_NONE (-1)
+#define STATS_PHASE_READ 0      /* Reading the directory records */
+#define STATS_PHASE_METADATA 1  /* stat and readlink */
+#define STATS_PHASE_SORT 2      /* Sorting (and ranking with --head) */
+#define STATS_PHASE_FORMAT 3    /* Formatting into the output buffer (name lookups included) */
+#define STATS_PHASE_WRITE 4     /* Writing the output */
+#define STATS_PHASE_COUNT 5
+
+/* Report formats (--stats=text, --stats=json) */
+#define STATS_FORMAT_TEXT 1
+#define STATS_FORMAT_JSON 2
+
+/**
+ * @brief Counters and phase times of one directory listing.
+ *
+ * Times are charged to the current phase when the listing switches to another one, so nothing
+ * is measured per entry. CPU times are thread CPU times of the listing thread, plus those of
+ * the metadata threads working for it.
+ */
+typedef struct
+{
+    const char *dir;                            /* Listed directory (NULL for the rest of the run) */
+    uint64_t counters[STATS_COUNTER_COUNT];     /* Updated atomically (metadata threads) */
+    uint64_t wall_ns[STATS_PHASE_COUNT];
+    uint64_t cpu_ns[STATS_PHASE_COUNT];
+    int phase;                                  /* Phase being timed (STATS_PHASE_*) */
+    int write_saved_phase;                      /* Phase to resume after a write */
+    uint64_t mark_wall;                         /* Start of the current phase */
+    uint64_t mark_cpu;
+} StatsProfile_t;
+
+/* Report format, 0 when --stats is not used */
+extern int StatsEnabled;
+
+/**
+ * @brief Parses a --stats argument.
+ *
+ * @param name "text", "json", or NULL for the default (text).
+ *
+ * @return A STATS_FORMAT_* value, or -1 if the name is unknown.
+ */
+int Stats_ParseFormat(const char *name);
+
+/**
+ * @brief Enables the statistics and starts the run's clock.
+ *
+ * @param format A STATS_FORMAT_* value.
+ */
+void Stats_Enable(int format);
+
+/**
+ * @brief Starts profiling a directory listing on the calling thread (phase READ).
+ *
+ * @param profile Storage for the profile, owned by the caller until Stats_End.
+ * @param dir The listed directory.
+ */
+void Stats_Begin(StatsProfile_t *profile, const char *dir);
+
+/**
+ * @brief Charges the time since the last switch to the current phase and starts another one.
+ *
+ * @param phase The new phase.
+ */
+void Stats_Switch(int phase);
+
+/**
+ * @brief Ends the calling thread's listing profile, reports it to stderr and adds it to the totals.
+ */
+void Stats_End(void);
+
+/**
+ * @brief Adds to a counter of the calling thread's profile (or of the rest of the run).
+ *
+ * @param counter A STATS_* counter.
+ * @param n The amount to add.
+ */
+void Stats_Count(int counter, uint64_t n);
+
+/**
+ * @brief Returns the calling thread's profile, to be shared with helper threads.
+ *
+ * @return The profile, or NULL outside of a listing.
+ */
+StatsProfile_t *Stats_Current(void);
+
+/**
+ * @brief Makes a helper thread count into another thread's profile.
+ *
+ * @param profile The profile (see Stats_Current); NULL does nothing.
+ */
+void Stats_Attach(StatsProfile_t *profile);
+
+/**
+ * @brief Detaches a helper thread, charging its CPU time to the profile's current phase.
+ */
+void Stats_Detach(void);
+
+/**
+ * @brief Starts timing an output write (phase WRITE), inside or outside a listing.
+ */
+void Stats_WriteBegin(void);
+
+/**
+ * @brief Ends timing an output write and resumes the interrupted phase.
+ */
+void Stats_WriteEnd(void);
+
+/**
+ * @brief Reports the totals of the run to stderr.
+ */
+void Stats_Report(void);
+
+#if MYLS_STATS
+#define STATS_BEGIN(profile, dir)   do { if (StatsEnabled) Stats_Begin((profile), (dir)); } while (0)
+#define STATS_SWITCH(phase)         do { if (StatsEnabled) Stats_Switch(phase); } while (0)
+#define STATS_END()                 do { if (StatsEnabled) Stats_End(); } while (0)
+#define STATS_COUNT(counter, n)     do { if (StatsEnabled) Stats_Count((counter), (n)); } while (0)
+#define STATS_CURRENT()             (StatsEnabled ? Stats_Current() : NULL)
+#define STATS_ATTACH(profile)       do { if (StatsEnabled) Stats_Attach(profile); } while (0)
+#define STATS_DETACH()              do { if (StatsEnabled) Stats_Detach(); } while (0)
+#define STATS_WRITE_BEGIN()         do { if (StatsEnabled) Stats_WriteBegin(); } while (0)
+#define STATS_WRITE_END()           do { if (StatsEnabled) Stats_WriteEnd(); } while (0)
+#define STATS_REPORT()              do { if (StatsEnabled) Stats_Report(); } while (0)
+#else
+#define STATS_BEGIN(profile, dir)   ((void)0)
+#define STATS_SWITCH(phase)         ((void)0)
+#define STATS_END()                 ((void)0)
+#define STATS_COUNT(counter, n)     ((void)0)
+#define STATS_CURRENT()             NULL
+#define STATS_ATTACH(profile)       ((void)0)
+#define STATS_DETACH()              ((void)0)
+#define STATS_WRITE_BEGIN()         ((void)0)
+#define STATS_WRITE_END()           ((void)0)
+#define STATS_REPORT()              ((void)0)
+#endif
+
+#endif
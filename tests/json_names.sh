@@ -0,0 +1,40 @@
+#!/bin/sh
+# Checks that --json stays valid UTF-8 JSON for names that are not UTF-8.
+#
+# usage: tests/json_names.sh
+#
+# A name with a 0xff byte must be written with \ufffd (U+FFFD) in "name" and its raw bytes in
+# "name_b64"; UTF-8 names, quotes and control characters keep their usual form.
+
+MYLS=${MYLS:-./myls}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+touch "$DIR/$(printf 'a\377b')" "$DIR/$(printf 'caf\303\251')" "$DIR/$(printf 'q"\001')"
+OUT=$("$MYLS" --json "$DIR") || exit 1
+STATUS=0
+
+expect()
+{
+    if ! printf '%s\n' "$OUT" | grep -qF -- "$1"; then
+        echo "FAIL: missing $1"
+        STATUS=1
+    fi
+}
+
+if ! printf '%s\n' "$OUT" | iconv -f UTF-8 -t UTF-8 >/dev/null 2>&1; then
+    echo "FAIL: output is not valid UTF-8"
+    STATUS=1
+fi
+
+expect '{"name":"a\ufffdb","name_b64":"Yf9i",'
+expect "{\"name\":\"$(printf 'caf\303\251')\",\"dir\":"
+expect '{"name":"q\"\u0001",'
+
+if [ "$(printf '%s\n' "$OUT" | grep -c '_b64')" -ne 1 ]; then
+    echo "FAIL: only the 0xff name needs a name_b64 field"
+    STATUS=1
+fi
+
+[ $STATUS -eq 0 ] && echo "json_names: ok"
+exit $STATUS
@@ -0,0 +1,318 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        timefmt.c              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#define _GNU_SOURCE
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "options.h"
+#include "timefmt.h"
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+static const char *const DayNames[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+
+static const char *const MonthNames[12] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+/* Each thread formats with its own cache, so no locking is needed */
+static __thread TimeCacheSlot_t TimeCache[TIMEFMT_CACHE_SLOTS];
+
+/* Time at the start of the run */
+static time_t Now;
+
+/* The time zone of the formatters is read once for the process */
+static pthread_once_t TimeZoneOnce = PTHREAD_ONCE_INIT;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+int TimeFmt_ParseStyle(const char *name)
+{
+    if (strcmp(name, "iso") == 0)
+        return TIME_STYLE_ISO;
+    if (strcmp(name, "long-iso") == 0)
+        return TIME_STYLE_LONG_ISO;
+    if (strcmp(name, "full-iso") == 0)
+        return TIME_STYLE_FULL_ISO;
+    if (strcmp(name, "locale") == 0)
+        return TIME_STYLE_LOCALE;
+
+    return -1;
+}
+
+void TimeFmt_Init(void)
+{
+    tzset();
+    Now = time(NULL);
+}
+
+/**
+ * @brief Writes a two digit number.
+ */
+static char *Put2(char *p, int value)
+{
+    p[0] = (char)('0' + value / 10);
+    p[1] = (char)('0' + value % 10);
+    return p + 2;
+}
+
+/**
+ * @brief Writes a number with a fixed count of digits (zero padded).
+ */
+static char *PutFixed(char *p, unsigned long value, int digits)
+{
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return p + digits;
+}
+
+/**
+ * @brief Writes a signed number without padding.
+ */
+static char *PutInt(char *p, long long value)
+{
+    char digits[20];
+    int count = 0;
+    unsigned long long magnitude = (value < 0) ? -(unsigned long long)value : (unsigned long long)value;
+
+    if (value < 0)
+    {
+        *p++ = '-';
+    }
+
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    while (count > 0)
+    {
+        *p++ = digits[--count];
+    }
+    return p;
+}
+
+/**
+ * @brief Writes the day of the month padded with a space to two characters (%e).
+ */
+static char *PutDay(char *p, int mday)
+{
+    *p++ = (mday < 10) ? ' ' : (char)('0' + mday / 10);
+    *p++ = (char)('0' + mday % 10);
+    return p;
+}
+
+/**
+ * @brief Formats a broken-down time in a style.
+ *
+ * @param slot Receives the text and the positions of the seconds and nanoseconds.
+ * @param style The TIME_STYLE_* to use.
+ * @param tm The local time.
+ * @param nsec Nanoseconds of the timestamp.
+ * @param recent Whether the time is within the last six months.
+ */
+static void Render(TimeCacheSlot_t *slot, int style, const struct tm *tm, long nsec, int recent)
+{
+    char *p = slot->text;
+    long long year = (long long)tm->tm_year + 1900;
+
+    slot->sec_offset = -1;
+    slot->nsec_offset = -1;
+
+    switch (style)
+    {
+        case TIME_STYLE_LOCALE:
+            memcpy(p, MonthNames[tm->tm_mon], 3);
+            p += 3;
+            *p++ = ' ';
+            p = PutDay(p, tm->tm_mday);
+            *p++ = ' ';
+            if (recent)
+            {
+                p = Put2(p, tm->tm_hour);
+                *p++ = ':';
+                p = Put2(p, tm->tm_min);
+            }
+            else
+            {
+                *p++ = ' ';
+                p = PutInt(p, year);
+            }
+            break;
+
+        case TIME_STYLE_ISO:
+            if (recent)
+            {
+                p = Put2(p, tm->tm_mon + 1);
+                *p++ = '-';
+                p = Put2(p, tm->tm_mday);
+                *p++ = ' ';
+                p = Put2(p, tm->tm_hour);
+                *p++ = ':';
+                p = Put2(p, tm->tm_min);
+            }
+            else
+            {
+                p = PutInt(p, year);
+                *p++ = '-';
+                p = Put2(p, tm->tm_mon + 1);
+                *p++ = '-';
+                p = Put2(p, tm->tm_mday);
+                *p++ = ' ';
+            }
+            break;
+
+        case TIME_STYLE_LONG_ISO:
+        case TIME_STYLE_FULL_ISO:
+            p = PutInt(p, year);
+            *p++ = '-';
+            p = Put2(p, tm->tm_mon + 1);
+            *p++ = '-';
+            p = Put2(p, tm->tm_mday);
+            *p++ = ' ';
+            p = Put2(p, tm->tm_hour);
+            *p++ = ':';
+            p = Put2(p, tm->tm_min);
+
+            if (style == TIME_STYLE_FULL_ISO)
+            {
+                long offset = tm->tm_gmtoff;
+
+                *p++ = ':';
+                slot->sec_offset = (int)(p - slot->text);
+                p = Put2(p, tm->tm_sec);
+                *p++ = '.';
+                slot->nsec_offset = (int)(p - slot->text);
+                p = PutFixed(p, (unsigned long)nsec, 9);
+                *p++ = ' ';
+                *p++ = (offset < 0) ? '-' : '+';
+                offset = (offset < 0) ? -offset : offset;
+                p = Put2(p, (int)(offset / 3600 % 100));
+                p = Put2(p, (int)(offset / 60 % 60));
+            }
+            break;
+
+        default:
+            /* Same text as ctime(), without the newline */
+            memcpy(p, DayNames[tm->tm_wday], 3);
+            p += 3;
+            *p++ = ' ';
+            memcpy(p, MonthNames[tm->tm_mon], 3);
+            p += 3;
+            *p++ = ' ';
+            p = PutDay(p, tm->tm_mday);
+            *p++ = ' ';
+            p = Put2(p, tm->tm_hour);
+            *p++ = ':';
+            p = Put2(p, tm->tm_min);
+            *p++ = ':';
+            slot->sec_offset = (int)(p - slot->text);
+            p = Put2(p, tm->tm_sec);
+            *p++ = ' ';
+            p = PutInt(p, year);
+            break;
+    }
+
+    slot->len = (int)(p - slot->text);
+}
+
+/**
+ * @brief Writes a timestamp through a cache of formatted minutes.
+ *
+ * @param cache The TIMEFMT_CACHE_SLOTS slots to use.
+ * @param style The TIME_STYLE_* to use.
+ * @param now Reference time for "recent" files.
+ * @param out The output buffer.
+ * @param ts The timestamp to print.
+ */
+static void WriteCached(TimeCacheSlot_t *cache, int style, time_t now, OutBuf_t *out, const struct timespec *ts)
+{
+    time_t t = ts->tv_sec;
+    long long minute = (long long)t / 60;
+    int recent = (t > now - TIMEFMT_SIX_MONTHS && t <= now);
+
+    /* Round towards minus infinity so that times before the epoch share minutes too */
+    if ((long long)t % 60 < 0)
+    {
+        minute--;
+    }
+    int second = (int)((long long)t - minute * 60);
+
+    TimeCacheSlot_t *slot = &cache[minute & (TIMEFMT_CACHE_SLOTS - 1)];
+
+    if (!slot->valid || slot->minute != minute || slot->recent != recent || slot->style != style)
+    {
+        struct tm tm;
+
+        if (localtime_r(&t, &tm) == NULL)
+        {
+            /* Out of the range of the calendar: print the raw seconds */
+            char raw[24];
+            OutBuf_Write(out, raw, PutInt(raw, (long long)t) - raw);
+            return;
+        }
+
+        Render(slot, style, &tm, ts->tv_nsec, recent);
+        slot->minute = minute;
+        slot->recent = recent;
+        slot->style = style;
+
+        /* Zones whose offset is not whole minutes (or leap seconds) cannot share the text */
+        slot->valid = (tm.tm_sec == second);
+        if (!slot->valid)
+        {
+            OutBuf_Write(out, slot->text, slot->len);
+            return;
+        }
+    }
+
+    char text[TIMEFMT_MAX_LENGTH];
+    memcpy(text, slot->text, slot->len);
+
+    /* Patch the parts that differ inside the minute */
+    if (slot->sec_offset >= 0)
+    {
+        Put2(text + slot->sec_offset, second);
+    }
+    if (slot->nsec_offset >= 0)
+    {
+        PutFixed(text + slot->nsec_offset, (unsigned long)ts->tv_nsec, 9);
+    }
+
+    OutBuf_Write(out, text, slot->len);
+}
+
+void TimeFmt_Write(OutBuf_t *out, int style, const struct timespec *ts)
+{
+    WriteCached(TimeCache, style, Now, out, ts);
+}
+
+void TimeFmt_InitFormatter(TimeFormatter_t *formatter, int style)
+{
+    pthread_once(&TimeZoneOnce, tzset);
+    formatter->style = style;
+    formatter->now = time(NULL);
+    memset(formatter->cache, 0, sizeof(formatter->cache));
+}
+
+void TimeFmt_WriteWith(TimeFormatter_t *formatter, OutBuf_t *out, const struct timespec *ts)
+{
+    WriteCached(formatter->cache, formatter->style, formatter->now, out, ts);
+}
@@ -0,0 +1,102 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        timefmt.h              ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _TIMEFMT_H_
+#define _TIMEFMT_H_
+
+#include <time.h>
+
+#include "outbuf.h"
+
+/* Number of minutes remembered by the formatter of each thread (must be a power of two) */
+#define TIMEFMT_CACHE_SLOTS 64
+
+/* Longest formatted timestamp */
+#define TIMEFMT_MAX_LENGTH 64
+
+/* Files older than this (or in the future) are not "recent" for the iso and locale styles */
+#define TIMEFMT_SIX_MONTHS (31556952 / 2)
+
+/**
+ * @brief One formatted minute.
+ */
+typedef struct
+{
+    long long minute;       /* Key: seconds since the epoch / 60, rounded down */
+    int recent;             /* Recent/old classification the text was built for */
+    int style;              /* TIME_STYLE_* the text was built for */
+    int valid;              /* 0 until the slot is filled */
+    int len;                /* Length of text */
+    int sec_offset;         /* Position of the seconds digits in text (-1 if not printed) */
+    int nsec_offset;        /* Position of the nanoseconds digits in text (-1 if not printed) */
+    char text[TIMEFMT_MAX_LENGTH];
+} TimeCacheSlot_t;
+
+/**
+ * @brief A timestamp formatter owned by its caller, with its own reference time and cache.
+ */
+typedef struct
+{
+    int style;                                      /* TIME_STYLE_* */
+    time_t now;                                     /* Reference for "recent" files */
+    TimeCacheSlot_t cache[TIMEFMT_CACHE_SLOTS];     /* Formatted minutes */
+} TimeFormatter_t;
+
+/**
+ * @brief Parses the argument of --time-style.
+ *
+ * @param name One of "iso", "long-iso", "full-iso" or "locale".
+ *
+ * @return The matching TIME_STYLE_* value, or -1 if the name is unknown.
+ */
+int TimeFmt_ParseStyle(const char *name);
+
+/**
+ * @brief Records the current time, used to tell recent files from old ones.
+ *
+ * Must be called once before the first TimeFmt_Write.
+ */
+void TimeFmt_Init(void);
+
+/**
+ * @brief Writes a timestamp in a given format.
+ *
+ * The broken-down local time is cached per minute (in a small per-thread table), so files
+ * modified in the same minute reuse the formatted text and only get their seconds patched.
+ * Digits are produced with integer arithmetic; nothing is allocated and no shared static buffer
+ * is used, so the function is thread-safe.
+ *
+ * @param out The output buffer.
+ * @param style The TIME_STYLE_* to use.
+ * @param ts The timestamp to print.
+ */
+void TimeFmt_Write(OutBuf_t *out, int style, const struct timespec *ts);
+
+/**
+ * @brief Prepares a formatter with its own style, reference time and cache.
+ *
+ * @param formatter The formatter.
+ * @param style The TIME_STYLE_* to use.
+ */
+void TimeFmt_InitFormatter(TimeFormatter_t *formatter, int style);
+
+/**
+ * @brief Writes a timestamp like TimeFmt_Write, with a formatter instead of the thread's cache.
+ *
+ * The formatter is written to, so it must not be used by several threads at the same time.
+ *
+ * @param formatter The formatter (see TimeFmt_InitFormatter).
+ * @param out The output buffer.
+ * @param ts The timestamp to print.
+ */
+void TimeFmt_WriteWith(TimeFormatter_t *formatter, OutBuf_t *out, const struct timespec *ts);
+
+#endif
@@ -0,0 +1,215 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        topk.c                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topk.h"
+#include "sort.h"
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Tells whether slot1 comes after slot2 in the heap's order (the root is the latest).
+ */
+static int IsLater(const TopK_t *heap, const TopKSlot_t *slot1, const TopKSlot_t *slot2)
+{
+    int result = Sort_Compare(&slot1->entry, slot1->key, &slot2->entry, slot2->key, heap->mode);
+    return heap->reverse ? (result < 0) : (result > 0);
+}
+
+/**
+ * @brief Copies a string with malloc, exiting on failure.
+ */
+static char *CopyString(const char *str)
+{
+    char *copy = strdup(str);
+
+    if (copy == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    return copy;
+}
+
+/**
+ * @brief Fills a slot with a copy of an entry.
+ */
+static void FillSlot(TopKSlot_t *slot, const FileEntry_t *entry, uint64_t key)
+{
+    slot->entry = *entry;
+    slot->entry.name = CopyString(entry->name);
+    slot->entry.link_target = (entry->link_target != NULL) ? CopyString(entry->link_target) : NULL;
+    slot->key = key;
+}
+
+/**
+ * @brief Frees the strings of a slot.
+ */
+static void ClearSlot(TopKSlot_t *slot)
+{
+    free(slot->entry.name);
+    free(slot->entry.link_target);
+}
+
+/**
+ * @brief Moves the slot at index i up while it comes after its parent.
+ */
+static void SiftUp(TopK_t *heap, size_t i)
+{
+    TopKSlot_t slot = heap->slots[i];
+
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (!IsLater(heap, &slot, &heap->slots[parent]))
+        {
+            break;
+        }
+
+        heap->slots[i] = heap->slots[parent];
+        i = parent;
+    }
+
+    heap->slots[i] = slot;
+}
+
+/**
+ * @brief Moves the root down while one of its children comes after it.
+ */
+static void SiftDown(TopK_t *heap)
+{
+    TopKSlot_t slot = heap->slots[0];
+    size_t i = 0;
+
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= heap->count)
+        {
+            break;
+        }
+
+        /* Follow the later of the two children */
+        if (child + 1 < heap->count && IsLater(heap, &heap->slots[child + 1], &heap->slots[child]))
+        {
+            child++;
+        }
+
+        if (!IsLater(heap, &heap->slots[child], &slot))
+        {
+            break;
+        }
+
+        heap->slots[i] = heap->slots[child];
+        i = child;
+    }
+
+    heap->slots[i] = slot;
+}
+
+void TopK_Init(TopK_t *heap, size_t limit, int mode, int reverse)
+{
+    heap->slots = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+    heap->limit = limit;
+    heap->mode = mode;
+    heap->reverse = reverse;
+}
+
+void TopK_Offer(TopK_t *heap, const FileEntry_t *entry)
+{
+    TopKSlot_t candidate;
+
+    candidate.entry = *entry;
+    candidate.key = Sort_Key(entry, heap->mode);
+
+    /* Not full yet => every entry gets in */
+    if (heap->count < heap->limit)
+    {
+        /* Grow geometrically, so a large limit costs nothing on a small directory */
+        if (heap->count == heap->capacity)
+        {
+            size_t new_capacity = (heap->capacity == 0) ? TOPK_INITIAL_CAPACITY : heap->capacity * 2;
+            if (new_capacity > heap->limit)
+            {
+                new_capacity = heap->limit;
+            }
+
+            TopKSlot_t *slots = realloc(heap->slots, new_capacity * sizeof(TopKSlot_t));
+            if (slots == NULL)
+            {
+                perror("Memory allocation failed");
+                exit(1);
+            }
+
+            heap->slots = slots;
+            heap->capacity = new_capacity;
+        }
+
+        FillSlot(&heap->slots[heap->count], entry, candidate.key);
+        SiftUp(heap, heap->count++);
+        return;
+    }
+
+    /* Full => the entry must come before the latest kept one, which it then replaces */
+    if (!IsLater(heap, &heap->slots[0], &candidate))
+    {
+        return;
+    }
+
+    ClearSlot(&heap->slots[0]);
+    FillSlot(&heap->slots[0], entry, candidate.key);
+    SiftDown(heap);
+}
+
+void TopK_Collect(TopK_t *heap, EntryTable_t *table)
+{
+    for (size_t i = 0; i < heap->count; i++)
+    {
+        FileEntry_t *kept = &heap->slots[i].entry;
+        FileEntry_t *entry = EntryTable_Append(table, kept->name, strlen(kept->name));
+
+        entry->d_type = kept->d_type;
+        entry->d_ino = kept->d_ino;
+        entry->buf = kept->buf;
+        entry->link_status = kept->link_status;
+        entry->valid = kept->valid;
+
+        if (kept->link_target != NULL)
+        {
+            entry->link_target = Arena_StrDup(&table->names, kept->link_target, strlen(kept->link_target));
+        }
+
+        ClearSlot(&heap->slots[i]);
+    }
+
+    heap->count = 0;
+}
+
+void TopK_Free(TopK_t *heap)
+{
+    for (size_t i = 0; i < heap->count; i++)
+    {
+        ClearSlot(&heap->slots[i]);
+    }
+
+    free(heap->slots);
+    heap->slots = NULL;
+    heap->count = 0;
+    heap->capacity = 0;
+}
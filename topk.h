@@ -0,0 +1,86 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        topk.h                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _TOPK_H_
+#define _TOPK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "entries.h"
+
+/* Initial number of slots of a heap (grown up to its limit) */
+#define TOPK_INITIAL_CAPACITY 64
+
+/**
+ * @brief One entry kept by a bounded heap, with its own copy of the strings.
+ */
+typedef struct
+{
+    FileEntry_t entry;  /* Copy of the record; name and link_target are malloc'ed */
+    uint64_t key;       /* Sort key (see Sort_Key) */
+} TopKSlot_t;
+
+/**
+ * @brief Bounded max-heap keeping the first `limit` entries of a sort order.
+ *
+ * The root is the last of the kept entries, so an offered entry only has to be compared
+ * with it to know whether it gets in.
+ */
+typedef struct
+{
+    TopKSlot_t *slots;  /* Heap array */
+    size_t count;       /* Number of kept entries */
+    size_t capacity;    /* Number of allocated slots */
+    size_t limit;       /* Maximum number of kept entries */
+    int mode;           /* Sort order (SORT_*, not SORT_NONE) */
+    int reverse;        /* 1 to keep the last entries of the order instead (-r) */
+} TopK_t;
+
+/**
+ * @brief Initializes an empty heap.
+ *
+ * @param heap The heap to initialize.
+ * @param limit Number of entries to keep (at least 1).
+ * @param mode The sort order the entries are ranked by.
+ * @param reverse 1 if that order is reversed.
+ */
+void TopK_Init(TopK_t *heap, size_t limit, int mode, int reverse);
+
+/**
+ * @brief Offers an entry to a heap, in O(log limit).
+ *
+ * The entry is copied if it ranks among the first `limit` entries seen so far; the entry it
+ * pushes out is dropped. The caller's record can be released afterwards.
+ *
+ * @param heap The heap.
+ * @param entry The entry, with the metadata the sort order needs.
+ */
+void TopK_Offer(TopK_t *heap, const FileEntry_t *entry);
+
+/**
+ * @brief Moves the kept entries into an entry table and empties the heap.
+ *
+ * The entries are appended in no particular order; the table is meant to be sorted next.
+ *
+ * @param heap The heap; it is left empty and can be reused.
+ * @param table An initialized table receiving the entries.
+ */
+void TopK_Collect(TopK_t *heap, EntryTable_t *table);
+
+/**
+ * @brief Frees the slots and strings owned by a heap.
+ *
+ * @param heap The heap to free.
+ */
+void TopK_Free(TopK_t *heap);
+
+#endif
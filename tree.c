@@ -0,0 +1,132 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        tree.c                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "tree.h"
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+void Tree_QueueInit(TreeQueue_t *queue)
+{
+    pthread_mutex_init(&queue->lock, NULL);
+    queue->items = NULL;
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = 0;
+}
+
+void Tree_QueuePush(TreeQueue_t *queue, void *const *items, size_t count)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->count + count > queue->capacity)
+    {
+        size_t capacity = (queue->capacity > 0) ? queue->capacity : TREE_QUEUE_INITIAL_CAPACITY;
+        while (capacity < queue->count + count)
+        {
+            capacity *= 2;
+        }
+
+        /* Unroll the ring into the new array */
+        void **grown = Tree_Malloc(capacity * sizeof(void *));
+        for (size_t i = 0; i < queue->count; i++)
+        {
+            grown[i] = queue->items[(queue->head + i) % queue->capacity];
+        }
+
+        free(queue->items);
+        queue->items = grown;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        queue->items[(queue->head + queue->count++) % queue->capacity] = items[i];
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void *Tree_QueuePopNewest(TreeQueue_t *queue)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0)
+    {
+        item = queue->items[(queue->head + --queue->count) % queue->capacity];
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return item;
+}
+
+void *Tree_QueueStealOldest(TreeQueue_t *queue)
+{
+    void *item = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count > 0)
+    {
+        item = queue->items[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return item;
+}
+
+void Tree_QueueFree(TreeQueue_t *queue)
+{
+    free(queue->items);
+    queue->items = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+    pthread_mutex_destroy(&queue->lock);
+}
+
+void *Tree_Malloc(size_t size)
+{
+    void *ptr = malloc(size);
+
+    if (ptr == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    return ptr;
+}
+
+char *Tree_JoinPath(const char *dir, const char *name)
+{
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+    int slash = (name_len > 0 && dir_len > 0 && dir[dir_len - 1] != '/');
+    char *path = Tree_Malloc(dir_len + slash + name_len + 1);
+
+    memcpy(path, dir, dir_len);
+    if (slash)
+    {
+        path[dir_len] = '/';
+    }
+    memcpy(path + dir_len + slash, name, name_len + 1);
+
+    return path;
+}
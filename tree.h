@@ -0,0 +1,83 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        tree.h                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _TREE_H_
+#define _TREE_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* Initial number of slots of a thread's queue of pending directories */
+#define TREE_QUEUE_INITIAL_CAPACITY 64
+
+/**
+ * @brief Queue of pending directories owned by one thread of a parallel tree walk (-R, --du),
+ *        as a ring buffer.
+ *
+ * The owner takes the newest item, so that it goes on depth first; thieves take the oldest
+ * one, which is the root of the largest unexplored subtree.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    void **items;
+    size_t head;        /* Index of the oldest item */
+    size_t count;
+    size_t capacity;
+} TreeQueue_t;
+
+/**
+ * @brief Initializes an empty queue.
+ */
+void Tree_QueueInit(TreeQueue_t *queue);
+
+/**
+ * @brief Appends items to a queue, in the given order.
+ *
+ * @param queue The queue.
+ * @param items The items; the last one is the first one the owner takes back.
+ * @param count Number of items.
+ */
+void Tree_QueuePush(TreeQueue_t *queue, void *const *items, size_t count);
+
+/**
+ * @brief Takes the newest item of a queue (owner side).
+ *
+ * @return The item, or NULL if the queue is empty.
+ */
+void *Tree_QueuePopNewest(TreeQueue_t *queue);
+
+/**
+ * @brief Takes the oldest item of a queue (thief side).
+ *
+ * @return The item, or NULL if the queue is empty.
+ */
+void *Tree_QueueStealOldest(TreeQueue_t *queue);
+
+/**
+ * @brief Releases the memory of a queue (the items left in it are not freed).
+ */
+void Tree_QueueFree(TreeQueue_t *queue);
+
+/**
+ * @brief malloc that exits on failure.
+ */
+void *Tree_Malloc(size_t size);
+
+/**
+ * @brief Builds "dir/name" in a new allocation (Tree_Malloc).
+ *
+ * No slash is added after a dir that already ends with one, nor for an empty name, so that
+ * Tree_JoinPath(dir, "") is a copy of dir.
+ */
+char *Tree_JoinPath(const char *dir, const char *name);
+
+#endif
@@ -0,0 +1,347 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        uring.c                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+/* statx() and struct statx are GNU extensions */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include "metadata.h"
+#include "uring.h"
+#include "stats.h"
+
+#if defined(__linux__) && defined(__NR_io_uring_setup) && defined(AT_STATX_SYNC_AS_STAT)
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief Mapped submission and completion rings of one io_uring instance.
+ */
+typedef struct
+{
+    int fd;
+
+    /* Submission ring */
+    void *sq_ring;
+    size_t sq_ring_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    /* Completion ring (shares the submission mapping with IORING_FEAT_SINGLE_MMAP) */
+    void *cq_ring;
+    size_t cq_ring_size;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    unsigned entries;
+} Uring_t;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Unmaps the rings and closes the io_uring descriptor.
+ */
+static void UringClose(Uring_t *ring)
+{
+    if (ring->sqes != MAP_FAILED && ring->sqes != NULL)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring && ring->cq_ring != MAP_FAILED && ring->cq_ring != NULL)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring != MAP_FAILED && ring->sq_ring != NULL)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+
+    close(ring->fd);
+}
+
+/**
+ * @brief Tells whether the kernel implements IORING_OP_STATX.
+ */
+static int UringSupportsStatx(int fd)
+{
+    size_t probe_size = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = calloc(1, probe_size);
+    int supported = 0;
+
+    if (probe == NULL)
+    {
+        return 0;
+    }
+
+    /* Kernels without the probe also predate IORING_OP_STATX */
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+        probe->last_op >= IORING_OP_STATX &&
+        (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED))
+    {
+        supported = 1;
+    }
+
+    free(probe);
+    return supported;
+}
+
+/**
+ * @brief Creates an io_uring instance and maps its rings.
+ *
+ * @return 0 on success, -1 if io_uring cannot be used.
+ */
+static int UringOpen(Uring_t *ring, unsigned entries)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+    {
+        return -1;
+    }
+
+    if (!UringSupportsStatx(ring->fd))
+    {
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        UringClose(ring);
+        return -1;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            UringClose(ring);
+            return -1;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        UringClose(ring);
+        return -1;
+    }
+
+    ring->sq_head = (unsigned *)((char *)ring->sq_ring + params.sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ring + params.sq_off.array);
+
+    ring->cq_head = (unsigned *)((char *)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring + params.cq_off.cqes);
+
+    return 0;
+}
+
+int Uring_StatEntries(const Options_t *options, EntryTable_t *table, int dir_fd, unsigned int mask, const unsigned char *needs_stat)
+{
+    Uring_t ring;
+
+    if (UringOpen(&ring, URING_QUEUE_DEPTH) < 0)
+    {
+        return -1;
+    }
+
+    /* One statx buffer per slot; the slot number travels in user_data */
+    unsigned slots = ring.entries;
+    struct statx *results = malloc(slots * sizeof(struct statx));
+    size_t *slot_entry = malloc(slots * sizeof(size_t));
+    unsigned *free_slots = malloc(slots * sizeof(unsigned));
+
+    if (results == NULL || slot_entry == NULL || free_slots == NULL)
+    {
+        free(results);
+        free(slot_entry);
+        free(free_slots);
+        UringClose(&ring);
+        return -1;
+    }
+
+    unsigned free_count = slots;
+    for (unsigned i = 0; i < slots; i++)
+    {
+        free_slots[i] = i;
+    }
+
+    int flags = Metadata_StatxFlags(options);
+    size_t next = 0;
+    unsigned in_flight = 0;
+
+    for (;;)
+    {
+        /* Queue as many requests as there are free slots */
+        unsigned tail = *ring.sq_tail;
+        unsigned queued = 0;
+
+        while (free_count > 0 && next < table->count)
+        {
+            if (!needs_stat[next])
+            {
+                next++;
+                continue;
+            }
+
+            unsigned slot = free_slots[--free_count];
+            unsigned index = tail & *ring.sq_mask;
+            struct io_uring_sqe *sqe = &ring.sqes[index];
+
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = dir_fd;
+            sqe->addr = (uint64_t)(uintptr_t)table->items[next].name;
+            sqe->len = mask;
+            sqe->off = (uint64_t)(uintptr_t)&results[slot];
+            sqe->statx_flags = flags;
+            sqe->user_data = slot;
+
+            ring.sq_array[index] = index;
+            slot_entry[slot] = next;
+
+            tail++;
+            queued++;
+            next++;
+        }
+
+        if (queued == 0 && in_flight == 0)
+        {
+            break;
+        }
+
+        /* Publish the new tail before the kernel reads the entries */
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+        STATS_COUNT(STATS_STATX, queued);
+        STATS_COUNT(STATS_URING_ENTER, 1);
+
+        if (syscall(__NR_io_uring_enter, ring.fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0)
+        {
+            if (errno == EINTR)
+            {
+                in_flight += queued;
+                continue;
+            }
+
+            /* Requests may already be in flight => the buffers must stay alive until the ring is gone */
+            perror("io_uring_enter");
+            UringClose(&ring);
+
+            /* The caller redoes everything on the synchronous path */
+            for (size_t i = 0; i < table->count; i++)
+            {
+                table->items[i].valid = 1;
+            }
+
+            free(results);
+            free(slot_entry);
+            free(free_slots);
+            return -1;
+        }
+
+        in_flight += queued;
+
+        /* Reap every available completion */
+        unsigned head = *ring.cq_head;
+        unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+
+        while (head != cq_tail)
+        {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned slot = (unsigned)cqe->user_data;
+            FileEntry_t *entry = &table->items[slot_entry[slot]];
+
+            if (cqe->res < 0)
+            {
+                fprintf(stderr, "Error in lstat: %s\n", strerror(-cqe->res));
+                entry->valid = 0;
+            }
+            else
+            {
+                Metadata_StatxToStat(&results[slot], &entry->buf);
+            }
+
+            free_slots[free_count++] = slot;
+            in_flight--;
+            head++;
+        }
+
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    UringClose(&ring);
+    free(results);
+    free(slot_entry);
+    free(free_slots);
+
+    return 0;
+}
+
+#else
+
+int Uring_StatEntries(const Options_t *options, EntryTable_t *table, int dir_fd, unsigned int mask, const unsigned char *needs_stat)
+{
+    /* io_uring is Linux only */
+    (void)options;
+    (void)table;
+    (void)dir_fd;
+    (void)mask;
+    (void)needs_stat;
+
+    return -1;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        uring.h                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include "entries.h"
+#include "options.h"
+
+/* Number of statx requests kept in flight */
+#define URING_QUEUE_DEPTH 1024
+
+/**
+ * @brief Stats entries of a table through io_uring.
+ *
+ * IORING_OP_STATX requests are submitted in large batches against the directory descriptor
+ * and their completions are reaped into the entry table, so thousands of lookups are in flight
+ * from a single thread. Entries whose stat fails are reported and marked invalid.
+ *
+ * @param options The options of the listing (--dont-sync).
+ * @param table The table holding the entries.
+ * @param dir_fd Descriptor of the directory holding the entries.
+ * @param mask The statx fields needed (see Metadata_BuildMask).
+ * @param needs_stat Per-entry flags: only entries with a non-zero flag are stat'ed.
+ *
+ * @return 0 once every requested entry was processed, -1 if io_uring (or its statx operation)
+ *         is not available or failed; the caller then has to use the synchronous path.
+ */
+int Uring_StatEntries(const Options_t *options, EntryTable_t *table, int dir_fd, unsigned int mask, const unsigned char *needs_stat);
+
+#endif
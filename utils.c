@@ -13,112 +13,19 @@
 
 #include "utils.h"
 #include "options.h"
-
-/**************************            GLOBAL VARIABLES           *******************************/
-
-extern int OptionsFlags[9];
+#include "idcache.h"
+#include "outbuf.h"
+#include "colors.h"
+#include "timefmt.h"
+#include "stats.h"
 
 /**********************            FUNCTIONS IMPLEMENTATION            ***************************/
 
-int CompareFileName(const void *p1, const void *p2)
-{
-    /* The actual arguments to this function are "pointers to
-       pointers to char", but strcmp(3) arguments are "pointers
-       to char", hence the following cast plus dereference */
-    return strcasecmp(*(const char **)p1, *(const char **)p2);
-}
-
-int CompareFileModTime(const void *p1, const void *p2)
-{
-    struct stat buf1, buf2;
-
-    /** Cast the arguments back to pointers to char (file names) */
-    const char *file1 = *(const char **)p1;
-    const char *file2 = *(const char **)p2;
-
-    /** Get file stats for each file */
-    if (lstat(file1, &buf1) < 0)
-    {
-        printf("stat error for file1: %s", file1);
-        return 0; /** Error case, treat files as equal */
-    }
-    if (lstat(file2, &buf2) < 0)
-    {
-        perror("stat error for file2");
-        return 0; /** Error case, treat files as equal */
-    }
-
-    /** Compare modification times (st_mtime) */
-    if (buf1.st_mtime > buf2.st_mtime)
-        return -1; /** Sort in descending order (most recent first) */
-    else if (buf1.st_mtime < buf2.st_mtime)
-        return 1; /** Sort in descending order */
-    else
-        return 0; /** Modification times are the same */
-}
-
-int CompareFileAccessTime(const void *p1, const void *p2)
-{
-    struct stat buf1, buf2;
-
-    /** Cast the arguments back to pointers to char (file names) */
-    const char *file1 = *(const char **)p1;
-    const char *file2 = *(const char **)p2;
-
-    /** Get file stats for each file */
-    if (lstat(file1, &buf1) < 0)
-    {
-        perror("stat error for file1");
-        return 0; /** Error case, treat files as equal */
-    }
-    if (lstat(file2, &buf2) < 0)
-    {
-        perror("stat error for file2");
-        return 0; /** Error case, treat files as equal */
-    }
-
-    /** Compare access times (st_atime) */
-    if (buf1.st_atime > buf2.st_atime)
-        return -1; /** Sort in descending order (most recent first) */
-    else if (buf1.st_atime < buf2.st_atime)
-        return 1; /** Sort in descending order */
-    else
-        return 0; /** Access times are the same */
-}
-
-int CompareFileChangeTime(const void *p1, const void *p2)
-{
-    struct stat buf1, buf2;
-
-    /** Cast the arguments back to pointers to char (file names) */
-    const char *file1 = *(const char **)p1;
-    const char *file2 = *(const char **)p2;
-
-    /** Get file stats for each file */
-    if (lstat(file1, &buf1) < 0)
-    {
-        perror("stat error for file1");
-        return 0; /** Error case, treat files as equal */
-    }
-    if (lstat(file2, &buf2) < 0)
-    {
-        perror("stat error for file2");
-        return 0; /** Error case, treat files as equal */
-    }
-
-    /** Compare change times (st_ctime) */
-    if (buf1.st_ctime > buf2.st_ctime)
-        return -1;
-    else if (buf1.st_ctime < buf2.st_ctime)
-        return 1;
-    else
-        return 0; /** Change times are the same */
-}
-
-int CheckSymbolicLinkTarget(const char *path)
+int CheckSymbolicLinkTarget(int dir_fd, const char *name, struct stat *target_buf)
 {
     struct stat buf;
-    if (stat(path, &buf) == -1)
+    STATS_COUNT(STATS_STAT, 1);
+    if (fstatat(dir_fd, name, &buf, 0) == -1)
     {
 
         if (errno == ENOENT)
@@ -130,131 +37,63 @@ int CheckSymbolicLinkTarget(const char *path)
             perror("stat error");
         }
     }
+    else
+    {
+        *target_buf = buf;
+    }
 
     return PROPER_LINK;
 }
 
-void PrintEntry(char *Entry, struct stat buf, char *path, int max_len)
+/**
+ * @brief Prints the name of an entry in its color: padded to max_len in the short formats,
+ *        followed by the target of a symbolic link in the long format.
+ */
+static void PrintColoredName(OutBuf_t *out, const FileEntry_t *entry, int max_len, int long_format)
 {
-    if (buf.st_mode & S_ISUID)
-    {
-        printf(WHITE_TEXT_RED_HIGHLIGHT);
-    }
+    const char *Entry = entry->name;
+    const struct stat *buf = &entry->buf;
 
-    else if (buf.st_mode & S_ISGID)
-    {
-        printf(BLACK_TEXT_YELLOW_HIGHLIGHT);
-    }
+    int entry_len = strlen(Entry); // Get the length of the entry
 
-    /** Check if it's an executable regular file */
-    else if (S_ISREG(buf.st_mode) && (buf.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH)))
-    {
-        /** Executable file */
-        printf(EXECUTABLE_FILE);
-    }
-    /** Check if it's a regular file */
-    else if (S_ISREG(buf.st_mode))
-    {
-        /** Regular file */
-        printf(REGULAR_FILE);
-    }
-    /** Check if it's a directory */
-    else if (S_ISDIR(buf.st_mode))
-    {
-        /** Directory */
-        printf(DIRECTORY);
-    }
-
-    /** Check if it's a character special file */
-    else if (S_ISCHR(buf.st_mode))
-    {
-        /** Character special file (e.g., terminal devices) */
-        printf(CHARACTER_SPECIAL_FILE);
-    }
-    /** Check if it's a block special file */
-    else if (S_ISBLK(buf.st_mode))
-    {
-        /** Block special file (e.g., disk devices) */
-        printf(BLOCK_SPECIAL_FILE);
-    }
-    /** Check if it's a FIFO or named pipe */
-    else if (S_ISFIFO(buf.st_mode))
-    {
-        /** FIFO or named pipe */
-        printf(NAMED_PIPE);
-    }
-    /** Check if it's a socket */
-    else if (S_ISSOCK(buf.st_mode))
-    {
-        /** Socket */
-        printf(SOCKET);
-    }
-
-    /** Check if it's a symbolic link */
-    else if (S_ISLNK(buf.st_mode))
-    {
-        if (CheckSymbolicLinkTarget(path) == BROKEN_LINK)
-        {
-            /** Broken link => color is red */
-            printf(RED_HIGHLIGHT);
-        }
-        else
-        {
-            /** Proper Symbolic link */
-            printf(SOFT_LINK);
-        }
-    }
-
-    /** Default case for unrecognized file type */
-    else
-    {
-        /** Default case (unrecognized file type) */
-        printf(white);
-    }
+    /** One lookup in the precomputed color tables (file type, permission bits, extension) */
+    const ColorSequence_t *color = Colors_ForEntry(entry, entry_len);
+    OutBuf_Write(out, color->seq, color->len);
 
     /** Print the entry name */
-    if (!OptionsFlags[LONG_FORMAT_OPTION_l])
+    if (!long_format)
     {
-        printf("%s", Entry); // Print the entry name
-        printf(reset);       // Reset the color after printing the entry
+        OutBuf_Write(out, Entry, entry_len);                    // Print the entry name
+        OutBuf_Write(out, ColorReset.seq, ColorReset.len);      // Reset the color after printing the entry
 
-        // Manually print spaces to align the output
-        int entry_len = strlen(Entry); // Get the length of the entry
-        for (int i = 0; i < (max_len - entry_len); i++)
-        {
-            printf(" "); // Print space
-        }
-
-        // Print two additional spaces
-        printf("  ");
+        // Pad with spaces to align the output, plus two additional spaces
+        OutBuf_Pad(out, ' ', (entry_len < max_len ? max_len - entry_len : 0) + 2);
     }
 
     else
     {
-        printf("%s", Entry);
+        OutBuf_Write(out, Entry, entry_len);
     }
 
     /** Check if long format option is set and if it's a symbolic link => print the target file */
-    if (OptionsFlags[LONG_FORMAT_OPTION_l] && S_ISLNK(buf.st_mode))
+    if (long_format && S_ISLNK(buf->st_mode))
     {
-        char link_target[MAX_PATH_LENGTH];
-        ssize_t len = readlink(path, link_target, sizeof(link_target) - 1);
-        if (len != -1)
+        /** The target was read during the metadata phase */
+        if (entry->link_target != NULL)
         {
-            /** Null-terminate the string */
-            link_target[len] = '\0';
             /** Print the symbolic link target */
-            printf(" -> %s", link_target);
-        }
-        else
-        {
-            /** Error reading symbolic link */
-            perror("Error reading symbolic link");
+            OutBuf_PutLiteral(out, " -> ");
+            OutBuf_Puts(out, entry->link_target);
         }
     }
 
     /** Reset color to default after printing */
-    printf(reset);
+    OutBuf_Write(out, ColorReset.seq, ColorReset.len);
+}
+
+void PrintEntry(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry, int max_len)
+{
+    PrintColoredName(out, entry, max_len, options->flags[LONG_FORMAT_OPTION_l]);
 }
 
 void GetFilePermessions(char *str, struct stat buf)
@@ -307,57 +146,111 @@ void GetFilePermessions(char *str, struct stat buf)
     str[10] = '\0'; // Null-terminate the string
 }
 
-void PrintEntry_LongFormat(struct stat buf, char *file_name, char *path)
+unsigned long long GetDiskBlocks(const struct stat *buf)
 {
+    return ((unsigned long long)buf->st_blocks + 1) / 2;
+}
 
-    if (OptionsFlags[SHOW_INODE_OPTION_i])
+void PrintBlocks(OutBuf_t *out, const FileEntry_t *entry, int width)
+{
+    OutBuf_PutUInt(out, GetDiskBlocks(&entry->buf), width);
+    OutBuf_Putc(out, ' ');
+}
+
+void FormatEntry_Long(OutBuf_t *out, const FileEntry_t *entry, const LongFormat_t *format)
+{
+    struct stat buf = entry->buf;
+
+    if (format->show_inode)
+    {
+        OutBuf_PutUInt(out, buf.st_ino, 0);
+        OutBuf_PutLiteral(out, "  ");
+    }
+
+    // Allocated size in 1K blocks (right-aligned with a width of 4)
+    if (format->show_blocks)
     {
-        printf("%ld  ", buf.st_ino);
+        PrintBlocks(out, entry, 4);
     }
     char str[11];
     strcpy(str, "----------");
 
     GetFilePermessions(str, buf);
     // Print file permissions
-    printf("%3s ", str);
+    OutBuf_Write(out, str, 10);
+    OutBuf_Putc(out, ' ');
 
     // Number of hard links (right-aligned with a width of 3)
-    printf("%3ld ", buf.st_nlink);
+    OutBuf_PutUInt(out, buf.st_nlink, 3);
+    OutBuf_Putc(out, ' ');
 
-    // Owner name (left-aligned with a width of 8)
-    struct passwd *pwd = getpwuid(buf.st_uid);
-    printf("%-8s ", pwd->pw_name);
+    // Owner name (left-aligned with a width of 8), resolved once per uid
+    OutBuf_PutsPadded(out, (format->ids != NULL) ? IdCache_LookupUser(format->ids, buf.st_uid) :
+                           IdCache_UserName(buf.st_uid), 8);
+    OutBuf_Putc(out, ' ');
 
-    // Group name (left-aligned with a width of 8)
-    struct group *grp = getgrgid(buf.st_gid);
-    printf("%-2s ", grp->gr_name);
+    // Group name (left-aligned with a width of 8), resolved once per gid
+    OutBuf_PutsPadded(out, (format->ids != NULL) ? IdCache_LookupGroup(format->ids, buf.st_gid) :
+                           IdCache_GroupName(buf.st_gid), 2);
+    OutBuf_Putc(out, ' ');
 
     // File size (right-aligned with a width of 8)
-    printf("%8ld ", buf.st_size);
+    OutBuf_PutUInt(out, buf.st_size, 8);
+    OutBuf_Putc(out, ' ');
+
+    /* Time: access time with -u, status change time with -c, modification time otherwise */
+    const struct timespec *time_spec = &buf.st_mtim;
 
-    /* Time */
-    if (OptionsFlags[ACCESS_TIME_OPTION_u])
+    if (format->time_field == LONG_FORMAT_ATIME)
     {
-        char *time_str = ctime(&buf.st_atime);
-        time_str[strlen(time_str) - 1] = '\0'; // Remove the newline
-        printf(" %s ", time_str);
+        time_spec = &buf.st_atim;
     }
 
-    else if (OptionsFlags[CHANGE_TIME_OPTION_c])
+    else if (format->time_field == LONG_FORMAT_CTIME)
     {
-        char *time_str = ctime(&buf.st_atime);
-        time_str[strlen(time_str) - 1] = '\0'; // Remove the newline
-        printf(" %s ", time_str);
+        time_spec = &buf.st_ctim;
     }
 
+    OutBuf_Putc(out, ' ');
+    if (format->time_formatter != NULL)
+    {
+        TimeFmt_WriteWith(format->time_formatter, out, time_spec);
+    }
     else
     {
-        /* Default: Modification time */
-        char *time_str = ctime(&buf.st_mtime);
-        time_str[strlen(time_str) - 1] = '\0'; // Remove the newline
-        printf(" %s ", time_str);
+        TimeFmt_Write(out, format->time_style, time_spec);
     }
+    OutBuf_Putc(out, ' ');
 
     // File name (left-aligned)
-    PrintEntry(file_name, buf, path, 0);
-}
\ No newline at end of file
+    if (format->color)
+    {
+        PrintColoredName(out, entry, 0, 1);
+    }
+    else
+    {
+        OutBuf_Puts(out, entry->name);
+
+        if (S_ISLNK(buf.st_mode) && entry->link_target != NULL)
+        {
+            OutBuf_PutLiteral(out, " -> ");
+            OutBuf_Puts(out, entry->link_target);
+        }
+    }
+}
+
+void PrintEntry_LongFormat(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry)
+{
+    LongFormat_t format;
+
+    format.show_inode = options->flags[SHOW_INODE_OPTION_i];
+    format.show_blocks = options->flags[SHOW_BLOCKS_OPTION_s];
+    format.time_field = options->flags[ACCESS_TIME_OPTION_u] ? LONG_FORMAT_ATIME :
+                        options->flags[CHANGE_TIME_OPTION_c] ? LONG_FORMAT_CTIME : LONG_FORMAT_MTIME;
+    format.color = 1;
+    format.time_style = options->time_style;
+    format.time_formatter = NULL;
+    format.ids = NULL;
+
+    FormatEntry_Long(out, entry, &format);
+}
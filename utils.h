@@ -22,6 +22,14 @@
 #include <pwd.h>
 #include <grp.h>
 #include <time.h>
+#include <fcntl.h>
+#include <limits.h>
+
+#include "entries.h"
+#include "outbuf.h"
+#include "timefmt.h"
+#include "idcache.h"
+#include "options.h"
 
 /* Text Colors */
 #define green "\033[1;32m"                          // For executable files
@@ -50,94 +58,57 @@
 
 #define UNKNOWN_TYPE -1
 
-#define BROKEN_LINK 0
-#define PROPER_LINK 1
-
 #ifndef S_ISVTX
 #define S_ISVTX 01000
 #endif
 
-/**
- * @brief Compares two file names alphabetically.
- *
- * The function is used for sorting file names in lexicographical order.
- *
- * @param p1 Pointer to the first file name (pointer to a pointer to char).
- * @param p2 Pointer to the second file name (pointer to a pointer to char).
- *
- * @return Negative value if the first file name is less than the second.
- *         Zero if the file names are identical.
- *         Positive value if the first file name is greater.
- */
-int CompareFileName(const void *p1, const void *p2);
-
-/**
- * @brief Compares two files based on their modification time.
- *
- * This function retrieves the modification time of each file using `lstat`
- * and compares them to sort files in descending order (most recent first).
- *
- * @param p1 Pointer to the first file name (pointer to a pointer to char).
- * @param p2 Pointer to the second file name (pointer to a pointer to char).
- *
- * @return -1 if the first file is more recently modified.
- *         1 if the second file is more recently modified.
- *         0 if both files have the same modification time or if an error occurs.
- */
-int CompareFileModTime(const void *p1, const void *p2);
+/* Timestamp printed by the long format */
+#define LONG_FORMAT_MTIME 0     /* Modification time (default) */
+#define LONG_FORMAT_ATIME 1     /* Access time (-u) */
+#define LONG_FORMAT_CTIME 2     /* Status change time (-c) */
 
 /**
- * @brief Compares two files based on their access time.
- *
- * Similar to CompareFileModTime, but compares the last access time of the files.
- *
- * @param p1 Pointer to the first file name (pointer to a pointer to char).
- * @param p2 Pointer to the second file name (pointer to a pointer to char).
- *
- * @return -1 if the first file is more recently accessed.
- *         1 if the second file is more recently accessed.
- *         0 if both files have the same access time or if an error occurs.
+ * @brief Fields and style of a long format line, independent of the command line options.
  */
-int CompareFileAccessTime(const void *p1, const void *p2);
-
-/**
- * @brief Compares two files based on their change time.
- *
- * This function compares the last status change time of the files.
- *
- * @param p1 Pointer to the first file name (pointer to a pointer to char).
- * @param p2 Pointer to the second file name (pointer to a pointer to char).
- *
- * @return -1 if the first file has a more recent change time.
- *         1 if the second file has a more recent change time.
- *         0 if both files have the same change time or if an error occurs.
- */
-int CompareFileChangeTime(const void *p1, const void *p2);
+typedef struct
+{
+    int show_inode;     /* Inode number first (-i) */
+    int show_blocks;    /* Allocated 1K blocks (-s) */
+    int time_field;     /* LONG_FORMAT_MTIME, LONG_FORMAT_ATIME or LONG_FORMAT_CTIME */
+    int color;          /* Name in color; 0 => plain name, then " -> target" for a link */
+    int time_style;     /* TIME_STYLE_* of the timestamps, when there is no time_formatter */
+    TimeFormatter_t *time_formatter;    /* NULL => time_style, with the thread's cache */
+    IdCacheSet_t *ids;                  /* NULL => the process-wide user and group caches */
+} LongFormat_t;
 
 /**
  * @brief Checks whether a symbolic link is broken.
  *
  * This function checks if the symbolic link points to a valid target.
  *
- * @param path The file path of the symbolic link.
+ * @param dir_fd Descriptor of the directory holding the link (or AT_FDCWD).
+ * @param name The name of the symbolic link, relative to dir_fd.
+ * @param target_buf Output: status of the final target (left as it is for a broken link).
  *
  * @return BROKEN_LINK if the symbolic link points to a non-existent file.
  *         PROPER_LINK if the link is valid.
  */
-int CheckSymbolicLinkTarget(const char *path);
+int CheckSymbolicLinkTarget(int dir_fd, const char *name, struct stat *target_buf);
 
 /**
  * @brief Prints file entry details with appropriate color formatting based on file type and permissions.
  *
  * This function prints file entries with colors indicating specific file types (e.g., directories, symbolic links).
  * It also handles broken symbolic links and displays symbolic link targets in long format mode.
+ * All the information comes from the entry record: no system call is made besides writing the output.
  *
- * @param Entry The name of the file entry.
- * @param buf A struct containing the file's metadata.
- * @param path The file path of the entry.
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entry The entry record (name, metadata and symbolic link state).
  * @param max_len The length of the largest file name.
  */
-void PrintEntry(char *Entry, struct stat buf, char *path, int max_len);
+void PrintEntry(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry, int max_len);
+
 /**
  * @brief Retrieves and formats the permissions of a file into a string.
  *
@@ -149,15 +120,45 @@ void PrintEntry(char *Entry, struct stat buf, char *path, int max_len);
 void GetFilePermessions(char *str, struct stat buf);
 
 /**
- * @brief Prints detailed file information in long format.
+ * @brief Returns the disk space allocated to a file, in 1024-byte blocks (rounded up).
+ *
+ * @param buf The file's metadata (st_blocks counts 512-byte units).
+ *
+ * @return The number of 1K blocks, as printed by -s and --du.
+ */
+unsigned long long GetDiskBlocks(const struct stat *buf);
+
+/**
+ * @brief Prints the allocated size of an entry (-s) followed by a space.
  *
- * This function prints the file's inode, permissions, number of hard links, owner, group, size, modification time,
+ * @param out The output buffer to append to.
+ * @param entry The entry record.
+ * @param width Minimum width of the number (right-aligned).
+ */
+void PrintBlocks(OutBuf_t *out, const FileEntry_t *entry, int width);
+
+/**
+ * @brief Formats one entry as a long format line, without the line break.
+ *
+ * Only the entry and the format are read, so lines can be formatted from several threads.
+ * Colors need Colors_Init to have run.
+ *
+ * @param out The output buffer to append to.
+ * @param entry The entry record (stat'ed, with its link target read for symbolic links).
+ * @param format The fields and style of the line.
+ */
+void FormatEntry_Long(OutBuf_t *out, const FileEntry_t *entry, const LongFormat_t *format);
+
+/**
+ * @brief Prints detailed file information in long format, as the command line options ask.
+ *
+ * This function prints the file's inode, allocated blocks (-s), permissions, number of hard links, owner, group, size, modification time,
  * and the file name in long format. It also displays the symbolic link target if the file is a symbolic link.
  *
- * @param buf A struct containing the file's metadata.
- * @param file_name The name of the file.
- * @param path The file path.
+ * @param options The options of the listing.
+ * @param out The output buffer to append to.
+ * @param entry The entry record (name, metadata and symbolic link state).
  */
-void PrintEntry_LongFormat(struct stat buf, char *file_name, char *path);
+void PrintEntry_LongFormat(const Options_t *options, OutBuf_t *out, const FileEntry_t *entry);
 
 #endif
\ No newline at end of file
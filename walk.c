@@ -0,0 +1,483 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        walk.c                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "options.h"
+#include "outbuf.h"
+#include "walk.h"
+#include "tree.h"
+#include "stats.h"
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/* States of a directory node */
+#define WALK_PENDING 0  /* Discovered, nobody is listing it yet */
+#define WALK_CLAIMED 1  /* Being listed */
+#define WALK_DONE 2     /* Listed by a walker thread, waiting to be printed */
+
+/**
+ * @brief One directory of the tree being walked.
+ *
+ * A node is referenced by its parent (until the printer leaves it) and by the queue it was
+ * pushed to (until a thread pops it); it is freed when both references are gone.
+ */
+typedef struct WalkNode
+{
+    char *path;                     /* Path of the directory */
+    struct WalkNode *parent;        /* NULL for the root */
+    dev_t dev;                      /* Identity of the directory (cycle detection with -L) */
+    ino_t ino;
+    struct WalkNode **children;     /* Subdirectories, in the order of the sorted listing */
+    size_t child_count;
+    size_t next_child;              /* Next child to print (printer only) */
+    OutBuf_t out;                   /* The formatted listing */
+    atomic_int state;               /* WALK_PENDING, WALK_CLAIMED or WALK_DONE */
+    atomic_int refs;
+} WalkNode_t;
+
+/**
+ * @brief State shared by the printer and the walker threads.
+ */
+typedef struct
+{
+    const Options_t *options;               /* Options of the listings */
+    TreeQueue_t queues[WALK_MAX_JOBS + 1];  /* Queue 0 belongs to the printer */
+    int jobs;                               /* Number of walker threads */
+    int metadata_jobs;                      /* Metadata threads per directory (0: automatic) */
+
+    pthread_mutex_t lock;                   /* Protects the fields below and the DONE transition */
+    pthread_cond_t work_cond;               /* Signaled when nodes are queued or the walk ends */
+    pthread_cond_t done_cond;               /* Signaled when a node becomes DONE */
+    pthread_cond_t space_cond;              /* Signaled when a buffered listing is printed */
+    size_t queued;                          /* Nodes in all the queues */
+    size_t buffered_dirs;                   /* DONE nodes not printed yet */
+    size_t buffered_bytes;                  /* Memory held by their listings */
+    int finished;
+} Walker_t;
+
+/**
+ * @brief Arguments of a walker thread.
+ */
+typedef struct
+{
+    Walker_t *walker;
+    int id;     /* Index of the thread's queue */
+} WalkWorker_t;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Creates a pending node owning path.
+ */
+static WalkNode_t *NewNode(char *path, WalkNode_t *parent, int refs)
+{
+    WalkNode_t *node = Tree_Malloc(sizeof(WalkNode_t));
+
+    node->path = path;
+    node->parent = parent;
+    node->dev = 0;
+    node->ino = 0;
+    node->children = NULL;
+    node->child_count = 0;
+    node->next_child = 0;
+    OutBuf_Init(&node->out, -1, 0);
+    atomic_init(&node->state, WALK_PENDING);
+    atomic_init(&node->refs, refs);
+
+    return node;
+}
+
+/**
+ * @brief Drops one reference to a node, freeing it with the last one.
+ */
+static void ReleaseNode(WalkNode_t *node)
+{
+    if (atomic_fetch_sub(&node->refs, 1) == 1)
+    {
+        OutBuf_Free(&node->out);
+        free(node->children);
+        free(node->path);
+        free(node);
+    }
+}
+
+/**
+ * @brief Tells whether an entry of a listing is a directory to descend into.
+ *
+ * Symbolic links are only followed with -L, and `.` and `..` (listed with -a) are skipped.
+ */
+static int IsSubdirectory(const Options_t *options, const char *dir, const FileEntry_t *entry)
+{
+    const char *name = entry->name;
+
+    if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+    {
+        return 0;
+    }
+
+    /* With -f, entries of file systems without d_type are not stat'ed => check them here */
+    if ((entry->buf.st_mode & S_IFMT) == 0 && entry->d_type == DT_UNKNOWN)
+    {
+        struct stat buf;
+        char *path = Tree_JoinPath(dir, name);
+        STATS_COUNT(STATS_STAT, 1);
+        int found = options->flags[DEREFERENCE_OPTION_L] ? stat(path, &buf) : lstat(path, &buf);
+        int is_dir = (found == 0 && S_ISDIR(buf.st_mode));
+
+        free(path);
+        return is_dir;
+    }
+
+    return S_ISDIR(entry->buf.st_mode);
+}
+
+/**
+ * @brief Tells whether a directory reached through links is one of its own ancestors.
+ *
+ * Only -L follows links into directories, so only -L can make the walk loop.
+ */
+static int IsListedAncestor(const WalkNode_t *parent, const char *path, const FileEntry_t *entry,
+                            dev_t *dev, ino_t *ino)
+{
+    struct stat buf = entry->buf;
+
+    /* Entries that were not stat'ed (only d_type known) have no link count and no device */
+    if (buf.st_nlink == 0 && stat(path, &buf) != 0)
+    {
+        return 0;
+    }
+
+    *dev = buf.st_dev;
+    *ino = buf.st_ino;
+
+    for (const WalkNode_t *ancestor = parent; ancestor != NULL; ancestor = ancestor->parent)
+    {
+        if (ancestor->dev == *dev && ancestor->ino == *ino)
+        {
+            fprintf(stderr, "Not listing already-listed directory: %s\n", path);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Lists one directory into its node's buffer and queues its subdirectories.
+ *
+ * @param walker The walk.
+ * @param node The claimed node.
+ * @param id Index of the calling thread's queue.
+ */
+static void ListNode(Walker_t *walker, WalkNode_t *node, int id)
+{
+    EntryTable_t table;
+
+    /* Every directory below the root gets its own header (records carry their directory) */
+    if (node->parent != NULL && walker->options->output_format == OUTPUT_FORMAT_TEXT)
+    {
+        OutBuf_PutLiteral(&node->out, "\nDirectory listing of ");
+        OutBuf_Puts(&node->out, node->path);
+        OutBuf_PutLiteral(&node->out, ":\n");
+    }
+
+    if (Directory_ls(walker->options, &node->out, node->path, &table, walker->metadata_jobs) == 0)
+    {
+        for (size_t i = 0; i < table.count; i++)
+        {
+            node->child_count += IsSubdirectory(walker->options, node->path, table.sorted[i]);
+        }
+
+        if (node->child_count > 0)
+        {
+            size_t count = 0;
+            node->children = Tree_Malloc(node->child_count * sizeof(WalkNode_t *));
+
+            for (size_t i = 0; i < table.count; i++)
+            {
+                if (IsSubdirectory(walker->options, node->path, table.sorted[i]))
+                {
+                    char *path = Tree_JoinPath(node->path, table.sorted[i]->name);
+                    dev_t dev = 0;
+                    ino_t ino = 0;
+
+                    if (walker->options->flags[DEREFERENCE_OPTION_L] && IsListedAncestor(node, path, table.sorted[i], &dev, &ino))
+                    {
+                        free(path);
+                        continue;
+                    }
+
+                    /* Referenced by this node and by the queue */
+                    node->children[count] = NewNode(path, node, 2);
+                    node->children[count]->dev = dev;
+                    node->children[count]->ino = ino;
+                    count++;
+                }
+            }
+
+            node->child_count = count;
+        }
+    }
+
+    EntryTable_Free(&table);
+
+    if (node->child_count == 0)
+    {
+        return;
+    }
+
+    /* Queue the children last first, so that the owner continues with the first one: the
+       walker then runs ahead of the printer in the same depth-first order */
+    void **reversed = Tree_Malloc(node->child_count * sizeof(void *));
+    for (size_t i = 0; i < node->child_count; i++)
+    {
+        reversed[i] = node->children[node->child_count - 1 - i];
+    }
+
+    Tree_QueuePush(&walker->queues[id], reversed, node->child_count);
+    free(reversed);
+
+    pthread_mutex_lock(&walker->lock);
+    walker->queued += node->child_count;
+    pthread_cond_broadcast(&walker->work_cond);
+    pthread_mutex_unlock(&walker->lock);
+}
+
+/**
+ * @brief Body of a walker thread: lists queued directories until the walk ends.
+ */
+static void *WalkWorker(void *arg)
+{
+    WalkWorker_t *worker = arg;
+    Walker_t *walker = worker->walker;
+    int queue_count = walker->jobs + 1;
+
+    for (;;)
+    {
+        WalkNode_t *node = Tree_QueuePopNewest(&walker->queues[worker->id]);
+
+        /* Own queue is empty => steal from the others, the printer's queue included */
+        for (int i = 1; node == NULL && i < queue_count; i++)
+        {
+            node = Tree_QueueStealOldest(&walker->queues[(worker->id + i) % queue_count]);
+        }
+
+        pthread_mutex_lock(&walker->lock);
+
+        if (node == NULL)
+        {
+            while (!walker->finished && walker->queued == 0)
+            {
+                pthread_cond_wait(&walker->work_cond, &walker->lock);
+            }
+
+            int finished = walker->finished;
+            pthread_mutex_unlock(&walker->lock);
+
+            if (finished)
+            {
+                break;
+            }
+            continue;
+        }
+
+        walker->queued--;
+
+        /* Do not run too far ahead of the printer */
+        while (!walker->finished && atomic_load(&node->state) == WALK_PENDING &&
+               (walker->buffered_dirs >= WALK_MAX_BUFFERED_DIRS || walker->buffered_bytes >= WALK_MAX_BUFFERED_BYTES))
+        {
+            pthread_cond_wait(&walker->space_cond, &walker->lock);
+        }
+
+        pthread_mutex_unlock(&walker->lock);
+
+        /* The printer may have listed the node itself in the meantime */
+        int expected = WALK_PENDING;
+        if (atomic_compare_exchange_strong(&node->state, &expected, WALK_CLAIMED))
+        {
+            ListNode(walker, node, worker->id);
+
+            pthread_mutex_lock(&walker->lock);
+            atomic_store(&node->state, WALK_DONE);
+            walker->buffered_dirs++;
+            walker->buffered_bytes += node->out.capacity;
+            pthread_cond_broadcast(&walker->done_cond);
+            pthread_mutex_unlock(&walker->lock);
+        }
+
+        ReleaseNode(node);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Prints a node's listing, listing the directory first if nobody started it.
+ */
+static void PrintNode(Walker_t *walker, WalkNode_t *node)
+{
+    int expected = WALK_PENDING;
+
+    if (atomic_compare_exchange_strong(&node->state, &expected, WALK_CLAIMED))
+    {
+        ListNode(walker, node, 0);
+    }
+    else
+    {
+        pthread_mutex_lock(&walker->lock);
+        while (atomic_load(&node->state) != WALK_DONE)
+        {
+            pthread_cond_wait(&walker->done_cond, &walker->lock);
+        }
+
+        walker->buffered_dirs--;
+        walker->buffered_bytes -= node->out.capacity;
+        pthread_cond_broadcast(&walker->space_cond);
+        pthread_mutex_unlock(&walker->lock);
+    }
+
+    if (node->out.len > 0)
+    {
+        OutBuf_Write(&Output, node->out.data, node->out.len);
+    }
+    OutBuf_Free(&node->out);
+}
+
+/**
+ * @brief Chooses the number of walker threads.
+ */
+static int JobCount(const Options_t *options)
+{
+    long jobs;
+
+    if (options->jobs > 0)
+    {
+        /* The printer lists directories too */
+        jobs = options->jobs - 1;
+    }
+    else
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        jobs = ((cpus > 0) ? cpus : 1) * WALK_AUTO_JOBS_PER_CPU;
+    }
+
+    if (jobs > WALK_MAX_JOBS)
+        jobs = WALK_MAX_JOBS;
+
+    return (int)jobs;
+}
+
+void Walk_Recursive(const Options_t *options, char *dir)
+{
+    Walker_t *walker = Tree_Malloc(sizeof(Walker_t));
+    WalkWorker_t workers[WALK_MAX_JOBS + 1];
+    pthread_t threads[WALK_MAX_JOBS + 1];
+    int started[WALK_MAX_JOBS + 1];
+
+    walker->options = options;
+    walker->jobs = JobCount(options);
+    walker->queued = 0;
+    walker->buffered_dirs = 0;
+    walker->buffered_bytes = 0;
+    walker->finished = 0;
+    pthread_mutex_init(&walker->lock, NULL);
+    pthread_cond_init(&walker->work_cond, NULL);
+    pthread_cond_init(&walker->done_cond, NULL);
+    pthread_cond_init(&walker->space_cond, NULL);
+
+    for (int i = 0; i <= walker->jobs; i++)
+    {
+        Tree_QueueInit(&walker->queues[i]);
+    }
+
+    /* The walk is the parallel layer: the metadata of a directory is gathered by the thread
+       listing it, with extra threads only for huge directories (automatic rule); an explicit
+       --jobs is spent on the walker threads */
+    walker->metadata_jobs = (options->jobs > 0) ? 1 : 0;
+
+    for (int i = 1; i <= walker->jobs; i++)
+    {
+        workers[i].walker = walker;
+        workers[i].id = i;
+        started[i] = (pthread_create(&threads[i], NULL, WalkWorker, &workers[i]) == 0);
+    }
+
+    /* Reorder stage: print the tree depth first, in the order of the sorted listings */
+    WalkNode_t *node = NewNode(Tree_JoinPath(dir, ""), NULL, 1);
+    struct stat root_buf;
+
+    if (options->flags[DEREFERENCE_OPTION_L] && stat(dir, &root_buf) == 0)
+    {
+        node->dev = root_buf.st_dev;
+        node->ino = root_buf.st_ino;
+    }
+
+    while (node != NULL)
+    {
+        PrintNode(walker, node);
+
+        /* Leave the subtrees that are completely printed */
+        while (node != NULL && node->next_child == node->child_count)
+        {
+            WalkNode_t *parent = node->parent;
+            ReleaseNode(node);
+            node = parent;
+        }
+
+        if (node != NULL)
+        {
+            node = node->children[node->next_child++];
+        }
+    }
+
+    pthread_mutex_lock(&walker->lock);
+    walker->finished = 1;
+    pthread_cond_broadcast(&walker->work_cond);
+    pthread_cond_broadcast(&walker->space_cond);
+    pthread_mutex_unlock(&walker->lock);
+
+    for (int i = 1; i <= walker->jobs; i++)
+    {
+        if (started[i])
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    /* Drop the queue references of the nodes the printer listed itself */
+    for (int i = 0; i <= walker->jobs; i++)
+    {
+        WalkNode_t *queued;
+        while ((queued = Tree_QueuePopNewest(&walker->queues[i])) != NULL)
+        {
+            ReleaseNode(queued);
+        }
+
+        Tree_QueueFree(&walker->queues[i]);
+    }
+
+    pthread_cond_destroy(&walker->space_cond);
+    pthread_cond_destroy(&walker->done_cond);
+    pthread_cond_destroy(&walker->work_cond);
+    pthread_mutex_destroy(&walker->lock);
+    free(walker);
+}
@@ -0,0 +1,51 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        walk.h                 ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _WALK_H_
+#define _WALK_H_
+
+#include "options.h"
+
+/* With an automatic job count, this many walker threads are started per online CPU (reading
+   directories is latency bound, so more threads than CPUs still help) */
+#define WALK_AUTO_JOBS_PER_CPU 4
+
+/* Hard upper bound of the number of walker threads */
+#define WALK_MAX_JOBS 256
+
+/* Upper bounds of the listings that are finished but wait for their turn to be printed; a
+   walker thread reaching one of them waits until the printer catches up */
+#define WALK_MAX_BUFFERED_DIRS 4096
+#define WALK_MAX_BUFFERED_BYTES (64 * 1024 * 1024)
+
+/**
+ * @brief Lists a directory and all its subdirectories (`-R`).
+ *
+ * The output is the same as the serial recursion: the directory itself, then each subdirectory
+ * (symbolic links are not followed) in the order of the sorted listing, depth first, each one
+ * preceded by an empty line and its "Directory listing of" header.
+ *
+ * Subdirectories are read and stat'ed in parallel. Every walker thread keeps a queue of the
+ * directories it discovered, works on the newest one and steals the oldest directories of the
+ * other threads when its own queue is empty. Each listing is formatted into its own memory
+ * buffer; the calling thread prints the buffers in order, and lists a directory itself when no
+ * walker has started it yet, so it never waits for work that is still queued. The number and
+ * size of the finished listings waiting to be printed are bounded (WALK_MAX_BUFFERED_*).
+ *
+ * The number of walker threads is --jobs when given (`--jobs=1` walks serially), otherwise
+ * WALK_AUTO_JOBS_PER_CPU per online CPU.
+ *
+ * @param options The options of the listing.
+ * @param dir The root directory; its header must already be printed.
+ */
+void Walk_Recursive(const Options_t *options, char *dir);
+
+#endif
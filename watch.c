@@ -0,0 +1,902 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        watch.c                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+/******************************            INCLUDES           ***********************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+
+#include "utils.h"
+#include "options.h"
+#include "metadata.h"
+#include "dirread.h"
+#include "lsrread.h"
+#include "sort.h"
+#include "watch.h"
+#include "filter.h"
+
+/* Changes of the entries, and of the watched directory itself */
+#define WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | \
+                      IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK)
+
+/**************************            TYPE DEFINITIONS           *******************************/
+
+/**
+ * @brief One entry of the index, with its own copy of the strings.
+ */
+typedef struct WatchEntry
+{
+    FileEntry_t entry;          /* First member => a WatchEntry_t * is also a FileEntry_t * */
+    uint64_t key;               /* Sort key (see Sort_Key) */
+    uint64_t order;             /* Arrival order, which is the sort order for -f and -U */
+    struct WatchEntry *next;    /* Next entry of the same bucket */
+} WatchEntry_t;
+
+/**
+ * @brief Entries of the watched directory, in sort order and by name.
+ */
+typedef struct
+{
+    FileEntry_t **sorted;       /* Entries in display order */
+    size_t count;               /* Number of entries */
+    size_t capacity;            /* Number of allocated pointers in sorted */
+    WatchEntry_t **buckets;     /* Hash table on the names (chained) */
+    size_t bucket_count;        /* Number of buckets, a power of two */
+    uint64_t next_order;        /* Order given to the next new entry */
+    int mode;                   /* Sort order (SORT_*) */
+    int reverse;                /* 1 for -r */
+} WatchIndex_t;
+
+/**
+ * @brief Names mentioned by the events of one batch.
+ */
+typedef struct
+{
+    char **names;               /* Names, possibly repeated */
+    size_t count;
+    size_t capacity;
+    Arena_t arena;              /* Storage for the names */
+    int rescan;                 /* 1 when every name has to be checked (lost events) */
+} DirtySet_t;
+
+/**
+ * @brief State of a watched listing.
+ */
+typedef struct
+{
+    const Options_t *options;   /* Options of the listing */
+    char *dir;                  /* The watched directory */
+    int dir_fd;                 /* Descriptor the entries are stat'ed from */
+    LinkDir_t link_dir;         /* Its identity for the link cache */
+    int inotify_fd;
+    unsigned int mask;          /* statx fields needed */
+    int gone;                   /* 1 once the directory was removed or moved */
+    WatchIndex_t index;
+    DirtySet_t dirty;
+    int tty;                    /* 1 to redraw a screen, 0 to print the changes */
+    OutBuf_t frame;             /* Screen being drawn ... */
+    size_t *lines;              /* ... and the offsets of its lines (one more for the end) */
+    size_t line_count;
+    OutBuf_t shown;             /* Screen currently on the terminal ... */
+    size_t *shown_lines;        /* ... and its line offsets */
+    size_t shown_count;
+    size_t rows;                /* Terminal height the line arrays are sized for */
+} Watch_t;
+
+/**************************            GLOBAL VARIABLES           *******************************/
+
+/* Set by the signal handler */
+static volatile sig_atomic_t Stopping = 0;
+static volatile sig_atomic_t Resized = 0;
+
+/**********************            FUNCTIONS IMPLEMENTATION            ***************************/
+
+/**
+ * @brief Records an interruption (SIGINT, SIGTERM) or a terminal resize (SIGWINCH).
+ */
+static void OnSignal(int sig)
+{
+    if (sig == SIGWINCH)
+    {
+        Resized = 1;
+    }
+    else
+    {
+        Stopping = 1;
+    }
+}
+
+/**
+ * @brief Allocates memory, exiting on failure.
+ */
+static void *Allocate(void *ptr, size_t size)
+{
+    void *memory = realloc(ptr, size);
+
+    if (memory == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    return memory;
+}
+
+/**
+ * @brief Hashes a name (FNV-1a).
+ */
+static size_t HashName(const char *name)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const unsigned char *c = (const unsigned char *)name; *c != '\0'; c++)
+    {
+        hash = (hash ^ *c) * 1099511628211ULL;
+    }
+
+    return (size_t)hash;
+}
+
+/**
+ * @brief Compares two entries in display order.
+ */
+static int Compare(const WatchIndex_t *index, const WatchEntry_t *e1, const WatchEntry_t *e2)
+{
+    int result;
+
+    if (index->mode == SORT_NONE)
+    {
+        result = (e1->order > e2->order) - (e1->order < e2->order);
+    }
+    else
+    {
+        result = Sort_Compare(&e1->entry, e1->key, &e2->entry, e2->key, index->mode);
+    }
+
+    return index->reverse ? -result : result;
+}
+
+/**
+ * @brief Finds the first position whose entry does not come before a given entry.
+ */
+static size_t FindPosition(const WatchIndex_t *index, const WatchEntry_t *entry)
+{
+    size_t low = 0;
+    size_t high = index->count;
+
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+
+        if (Compare(index, (const WatchEntry_t *)index->sorted[middle], entry) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * @brief Looks an entry up by name.
+ */
+static WatchEntry_t *Index_Find(const WatchIndex_t *index, const char *name)
+{
+    if (index->bucket_count == 0)
+    {
+        return NULL;
+    }
+
+    WatchEntry_t *entry = index->buckets[HashName(name) & (index->bucket_count - 1)];
+
+    while (entry != NULL && strcmp(entry->entry.name, name) != 0)
+    {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Doubles the buckets once there are more entries than buckets.
+ */
+static void Index_ReserveBuckets(WatchIndex_t *index)
+{
+    if (index->buckets != NULL && index->count < index->bucket_count)
+    {
+        return;
+    }
+
+    size_t bucket_count = (index->buckets == NULL) ? WATCH_INITIAL_BUCKETS : index->bucket_count * 2;
+    WatchEntry_t **buckets = calloc(bucket_count, sizeof(WatchEntry_t *));
+
+    if (buckets == NULL)
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < index->bucket_count; i++)
+    {
+        WatchEntry_t *entry = index->buckets[i];
+
+        while (entry != NULL)
+        {
+            WatchEntry_t *next = entry->next;
+            size_t bucket = HashName(entry->entry.name) & (bucket_count - 1);
+
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    free(index->buckets);
+    index->buckets = buckets;
+    index->bucket_count = bucket_count;
+}
+
+/**
+ * @brief Adds an entry to the index, at its place in display order.
+ */
+static void Index_Insert(WatchIndex_t *index, WatchEntry_t *entry)
+{
+    Index_ReserveBuckets(index);
+
+    size_t bucket = HashName(entry->entry.name) & (index->bucket_count - 1);
+    entry->next = index->buckets[bucket];
+    index->buckets[bucket] = entry;
+
+    if (index->count == index->capacity)
+    {
+        index->capacity = (index->capacity == 0) ? ENTRY_TABLE_INITIAL_CAPACITY : index->capacity * 2;
+        index->sorted = Allocate(index->sorted, index->capacity * sizeof(FileEntry_t *));
+    }
+
+    size_t position = FindPosition(index, entry);
+    memmove(&index->sorted[position + 1], &index->sorted[position],
+            (index->count - position) * sizeof(FileEntry_t *));
+    index->sorted[position] = &entry->entry;
+    index->count++;
+}
+
+/**
+ * @brief Takes an entry out of the index (the entry itself is not freed).
+ */
+static void Index_Remove(WatchIndex_t *index, WatchEntry_t *entry)
+{
+    WatchEntry_t **link = &index->buckets[HashName(entry->entry.name) & (index->bucket_count - 1)];
+
+    while (*link != entry)
+    {
+        link = &(*link)->next;
+    }
+    *link = entry->next;
+
+    /* The order is total (ties are broken by name) => the position is the entry's own */
+    size_t position = FindPosition(index, entry);
+    memmove(&index->sorted[position], &index->sorted[position + 1],
+            (index->count - position - 1) * sizeof(FileEntry_t *));
+    index->count--;
+}
+
+/**
+ * @brief Creates an index entry from a record, copying its strings.
+ */
+static WatchEntry_t *NewEntry(const WatchIndex_t *index, const FileEntry_t *record, uint64_t order)
+{
+    WatchEntry_t *entry = Allocate(NULL, sizeof(WatchEntry_t));
+
+    entry->entry = *record;
+    entry->entry.name = strdup(record->name);
+    entry->entry.link_target = (record->link_target != NULL) ? strdup(record->link_target) : NULL;
+    entry->key = (index->mode != SORT_NONE) ? Sort_Key(&entry->entry, index->mode) : 0;
+    entry->order = order;
+    entry->next = NULL;
+
+    if (entry->entry.name == NULL || (record->link_target != NULL && entry->entry.link_target == NULL))
+    {
+        perror("Memory allocation failed");
+        exit(1);
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Frees an index entry.
+ */
+static void FreeEntry(WatchEntry_t *entry)
+{
+    free(entry->entry.name);
+    free(entry->entry.link_target);
+    free(entry);
+}
+
+/**
+ * @brief Frees every entry of the index.
+ */
+static void Index_Free(WatchIndex_t *index)
+{
+    for (size_t i = 0; i < index->count; i++)
+    {
+        FreeEntry((WatchEntry_t *)index->sorted[i]);
+    }
+
+    free(index->sorted);
+    free(index->buckets);
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * @brief Tells whether an entry is listed (hidden entries need -a, and the patterns apply).
+ */
+static int IsListed(const Watch_t *watch, const char *name)
+{
+    return Options_Accept(watch->options, name, strlen(name));
+}
+
+/**
+ * @brief Reads the whole directory into the index.
+ *
+ * @return 0 on success, -1 if the directory cannot be read.
+ */
+static int LoadDirectory(Watch_t *watch)
+{
+    LsrReader_t reader;
+    EntryTable_t table;
+
+    EntryTable_Init(&table);
+
+    if (LsrReader_Open(&reader, watch->dir, watch->options, &table) < 0)
+    {
+        EntryTable_Free(&table);
+        return -1;
+    }
+
+    if (LsrReader_ReadAll(&reader) < 0)
+    {
+        perror("Error reading directory");
+    }
+
+    Metadata_Gather(watch->options, &table, reader.reader.fd, watch->mask, watch->options->jobs);
+    LsrReader_Close(&reader);
+
+    /* Sort once, then append in that order (the directory order is the arrival order) */
+    Sort_Entries(&table, watch->index.mode, watch->index.reverse);
+
+    for (size_t i = 0; i < table.count; i++)
+    {
+        Index_Insert(&watch->index, NewEntry(&watch->index, table.sorted[i], table.sorted[i] - table.items));
+    }
+
+    watch->index.next_order = table.count;
+    EntryTable_Free(&table);
+
+    return 0;
+}
+
+/**
+ * @brief Adds a name to the batch being collected.
+ */
+static void Dirty_Add(DirtySet_t *dirty, const char *name)
+{
+    if (dirty->count == dirty->capacity)
+    {
+        dirty->capacity = (dirty->capacity == 0) ? ENTRY_TABLE_INITIAL_CAPACITY : dirty->capacity * 2;
+        dirty->names = Allocate(dirty->names, dirty->capacity * sizeof(char *));
+    }
+
+    dirty->names[dirty->count++] = Arena_StrDup(&dirty->arena, name, strlen(name));
+}
+
+/**
+ * @brief Empties a batch.
+ */
+static void Dirty_Clear(DirtySet_t *dirty)
+{
+    Arena_Release(&dirty->arena);
+    dirty->count = 0;
+    dirty->rescan = 0;
+}
+
+/**
+ * @brief Reads every pending event and notes the names they mention.
+ */
+static void ReadEvents(Watch_t *watch)
+{
+    char buffer[WATCH_EVENT_BUFFER_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        ssize_t len = read(watch->inotify_fd, buffer, sizeof(buffer));
+
+        if (len < 0)
+        {
+            if (errno == EINTR && !Stopping)
+            {
+                continue;
+            }
+
+            if (errno != EAGAIN && errno != EINTR)
+            {
+                perror("Error reading events");
+                watch->gone = 1;
+            }
+            return;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *)ptr)->len)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+
+            /* The kernel queue overflowed => events were lost */
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                watch->dirty.rescan = 1;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT))
+            {
+                watch->gone = 1;
+            }
+
+            if (event->len == 0 || watch->dirty.rescan || !IsListed(watch, event->name))
+            {
+                continue;
+            }
+
+            /* Too many names to check one by one => check all of them once */
+            if (watch->dirty.count >= WATCH_RESCAN_THRESHOLD)
+            {
+                watch->dirty.rescan = 1;
+                continue;
+            }
+
+            Dirty_Add(&watch->dirty, event->name);
+        }
+    }
+}
+
+/**
+ * @brief Returns a monotonic time in milliseconds.
+ */
+static int64_t NowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Waits for events, then keeps collecting them until the directory is quiet for
+ *        WATCH_COALESCE_MS or WATCH_MAX_DELAY_MS have passed (or a signal arrives).
+ */
+static void CollectBatch(Watch_t *watch)
+{
+    struct pollfd pfd = { watch->inotify_fd, POLLIN, 0 };
+
+    if (poll(&pfd, 1, -1) <= 0)
+    {
+        return;
+    }
+
+    int64_t start = NowMs();
+    ReadEvents(watch);
+
+    while (!Stopping && !watch->gone)
+    {
+        int64_t left = WATCH_MAX_DELAY_MS - (NowMs() - start);
+        if (left <= 0)
+        {
+            break;
+        }
+
+        if (poll(&pfd, 1, (left < WATCH_COALESCE_MS) ? (int)left : WATCH_COALESCE_MS) <= 0)
+        {
+            break;
+        }
+
+        ReadEvents(watch);
+    }
+}
+
+/**
+ * @brief Tells whether the metadata of an entry changed.
+ */
+static int HasChanged(const FileEntry_t *old, const FileEntry_t *fresh)
+{
+    const struct stat *b1 = &old->buf;
+    const struct stat *b2 = &fresh->buf;
+
+    if (b1->st_ino != b2->st_ino || b1->st_mode != b2->st_mode || b1->st_nlink != b2->st_nlink ||
+        b1->st_uid != b2->st_uid || b1->st_gid != b2->st_gid || b1->st_size != b2->st_size ||
+        b1->st_blocks != b2->st_blocks || b1->st_rdev != b2->st_rdev || old->link_status != fresh->link_status ||
+        b1->st_mtim.tv_sec != b2->st_mtim.tv_sec || b1->st_mtim.tv_nsec != b2->st_mtim.tv_nsec ||
+        b1->st_ctim.tv_sec != b2->st_ctim.tv_sec || b1->st_ctim.tv_nsec != b2->st_ctim.tv_nsec)
+    {
+        return 1;
+    }
+
+    if (old->link_target == NULL || fresh->link_target == NULL)
+    {
+        return old->link_target != fresh->link_target;
+    }
+
+    return strcmp(old->link_target, fresh->link_target) != 0;
+}
+
+/**
+ * @brief Stats one name again and updates the index (printing the change without a terminal).
+ */
+static void Refresh(Watch_t *watch, const char *name)
+{
+    WatchEntry_t *old = Index_Find(&watch->index, name);
+    FileEntry_t fresh;
+    Arena_t arena = { NULL };
+
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.name = (char *)name;
+    fresh.valid = 1;
+
+    if (Metadata_Fetch(watch->options, watch->dir_fd, name, watch->mask, &fresh.buf) < 0)
+    {
+        if (errno != ENOENT)
+        {
+            perror("Error in lstat");
+            return;
+        }
+
+        /* Deleted or renamed away */
+        if (old != NULL)
+        {
+            if (!watch->tty)
+            {
+                PrintChange(watch->options, &Output, '-', &old->entry);
+            }
+
+            Index_Remove(&watch->index, old);
+            FreeEntry(old);
+        }
+        return;
+    }
+
+    fresh.d_type = IFTODT(fresh.buf.st_mode);
+    fresh.d_ino = fresh.buf.st_ino;
+    Metadata_ResolveLink(watch->options, &fresh, watch->dir_fd, &watch->link_dir, &arena);
+
+    if (old == NULL || HasChanged(&old->entry, &fresh))
+    {
+        /* A modified entry keeps its place in the directory order */
+        WatchEntry_t *entry = NewEntry(&watch->index, &fresh, (old != NULL) ? old->order : watch->index.next_order++);
+
+        if (old != NULL)
+        {
+            Index_Remove(&watch->index, old);
+            FreeEntry(old);
+        }
+
+        Index_Insert(&watch->index, entry);
+
+        if (!watch->tty)
+        {
+            PrintChange(watch->options, &Output, (old != NULL) ? 'M' : '+', &entry->entry);
+        }
+    }
+
+    Arena_Release(&arena);
+}
+
+/**
+ * @brief Orders names (qsort callback).
+ */
+static int CompareNames(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Applies a batch: every name it mentions is checked once.
+ */
+static void ApplyBatch(Watch_t *watch)
+{
+    DirtySet_t *dirty = &watch->dirty;
+
+    /* Lost or too many events => every known name and every name in the directory */
+    if (dirty->rescan)
+    {
+        DirReader_t reader;
+        DirRecord_t record;
+
+        Dirty_Clear(dirty);
+
+        for (size_t i = 0; i < watch->index.count; i++)
+        {
+            Dirty_Add(dirty, watch->index.sorted[i]->name);
+        }
+
+        if (DirReader_Open(&reader, watch->dir, watch->options->dir_buffer_size) == 0)
+        {
+            while (DirReader_Next(&reader, &record) > 0)
+            {
+                if (IsListed(watch, record.name))
+                {
+                    Dirty_Add(dirty, record.name);
+                }
+            }
+
+            DirReader_Close(&reader);
+        }
+    }
+
+    qsort(dirty->names, dirty->count, sizeof(char *), CompareNames);
+
+    for (size_t i = 0; i < dirty->count; i++)
+    {
+        if (i == 0 || strcmp(dirty->names[i], dirty->names[i - 1]) != 0)
+        {
+            Refresh(watch, dirty->names[i]);
+        }
+    }
+
+    Dirty_Clear(dirty);
+}
+
+/**
+ * @brief Returns the terminal height.
+ */
+static size_t TerminalRows(void)
+{
+    struct winsize w;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_row > 2)
+    {
+        return w.ws_row;
+    }
+
+    return WATCH_DEFAULT_ROWS;
+}
+
+/**
+ * @brief Draws the screen in memory: a status line, then the first entries, one per line.
+ */
+static void RenderFrame(Watch_t *watch)
+{
+    size_t rows = TerminalRows();
+    time_t now = time(NULL);
+    char clock[16];
+
+    if (rows != watch->rows)
+    {
+        watch->rows = rows;
+        watch->lines = Allocate(watch->lines, (rows + 1) * sizeof(size_t));
+        watch->shown_lines = Allocate(watch->shown_lines, (rows + 1) * sizeof(size_t));
+        watch->shown_count = 0;
+    }
+
+    watch->frame.len = 0;
+    watch->line_count = 0;
+
+    strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+    watch->lines[watch->line_count++] = watch->frame.len;
+    OutBuf_Puts(&watch->frame, watch->dir);
+    OutBuf_PutLiteral(&watch->frame, ": ");
+    OutBuf_PutUInt(&watch->frame, watch->index.count, 0);
+    OutBuf_PutLiteral(&watch->frame, " entries, updated ");
+    OutBuf_Puts(&watch->frame, clock);
+
+    /* The last row is left for the cursor, so that the screen never scrolls */
+    for (size_t i = 0; i < watch->index.count && watch->line_count < rows - 1; i++)
+    {
+        watch->lines[watch->line_count++] = watch->frame.len;
+        PrintLine(watch->options, &watch->frame, watch->index.sorted[i]);
+    }
+
+    watch->lines[watch->line_count] = watch->frame.len;
+}
+
+/**
+ * @brief Moves the terminal cursor to the start of a line (counted from 0).
+ */
+static void MoveToLine(size_t line)
+{
+    OutBuf_PutLiteral(&Output, "\033[");
+    OutBuf_PutUInt(&Output, line + 1, 0);
+    OutBuf_PutLiteral(&Output, ";1H");
+}
+
+/**
+ * @brief Redraws the lines of the screen that changed since it was last drawn.
+ *
+ * @param watch The watched listing.
+ * @param full 1 to clear the terminal and draw every line.
+ */
+static void Redraw(Watch_t *watch, int full)
+{
+    RenderFrame(watch);
+
+    if (full)
+    {
+        OutBuf_PutLiteral(&Output, "\033[H\033[2J");
+        watch->shown_count = 0;
+    }
+
+    for (size_t i = 0; i < watch->line_count; i++)
+    {
+        const char *line = watch->frame.data + watch->lines[i];
+        size_t len = watch->lines[i + 1] - watch->lines[i];
+
+        if (i < watch->shown_count && len == watch->shown_lines[i + 1] - watch->shown_lines[i] &&
+            memcmp(line, watch->shown.data + watch->shown_lines[i], len) == 0)
+        {
+            continue;
+        }
+
+        MoveToLine(i);
+        OutBuf_Write(&Output, line, len);
+        OutBuf_PutLiteral(&Output, "\033[K");
+    }
+
+    /* Fewer lines than before => clear the rest of the screen */
+    if (watch->line_count < watch->shown_count)
+    {
+        MoveToLine(watch->line_count);
+        OutBuf_PutLiteral(&Output, "\033[J");
+    }
+
+    MoveToLine(watch->rows - 1);
+
+    /* The new screen becomes the shown one */
+    OutBuf_t frame = watch->shown;
+    size_t *lines = watch->shown_lines;
+
+    watch->shown = watch->frame;
+    watch->shown_lines = watch->lines;
+    watch->shown_count = watch->line_count;
+    watch->frame = frame;
+    watch->lines = lines;
+}
+
+int Watch_Run(const Options_t *options, char *dir)
+{
+    Watch_t watch;
+    struct sigaction action;
+
+    memset(&watch, 0, sizeof(watch));
+    watch.options = options;
+    watch.dir = dir;
+    watch.tty = isatty(STDOUT_FILENO);
+    watch.mask = Metadata_BuildMask(options);
+    watch.index.mode = Sort_SelectMode(options);
+    watch.index.reverse = options->flags[REVERSE_OPTION_r] && (watch.index.mode != SORT_NONE);
+
+    watch.dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (watch.dir_fd < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", dir);
+        return -1;
+    }
+
+    struct stat dir_buf;
+    if (fstat(watch.dir_fd, &dir_buf) == 0)
+    {
+        watch.link_dir.dev = dir_buf.st_dev;
+        watch.link_dir.ino = dir_buf.st_ino;
+    }
+
+    /* Subscribe before the first listing => no change can fall between the two */
+    watch.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch.inotify_fd < 0 || inotify_add_watch(watch.inotify_fd, dir, WATCH_EVENTS) < 0)
+    {
+        fprintf(stderr, "Cannot watch directory %s: %s\n", dir, strerror(errno));
+        close(watch.dir_fd);
+        return -1;
+    }
+
+    if (LoadDirectory(&watch) < 0)
+    {
+        fprintf(stderr, "Cannot open directory: %s\n", dir);
+        close(watch.inotify_fd);
+        close(watch.dir_fd);
+        return -1;
+    }
+
+    /* No SA_RESTART => poll returns on a signal */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = OnSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGWINCH, &action, NULL);
+
+    OutBuf_Init(&watch.frame, -1, 0);
+    OutBuf_Init(&watch.shown, -1, 0);
+
+    if (watch.tty)
+    {
+        /* Long lines are cut instead of wrapped, so that every entry stays on its row */
+        OutBuf_PutLiteral(&Output, "\033[?7l");
+        Redraw(&watch, 1);
+    }
+    else
+    {
+        PrintSorted(options, &Output, watch.index.sorted, watch.index.count, dir);
+    }
+
+    OutBuf_Flush(&Output);
+
+    while (!Stopping && !watch.gone)
+    {
+        if (Resized)
+        {
+            Resized = 0;
+            if (watch.tty)
+            {
+                Redraw(&watch, 1);
+            }
+        }
+
+        CollectBatch(&watch);
+
+        if (watch.dirty.count > 0 || watch.dirty.rescan)
+        {
+            ApplyBatch(&watch);
+
+            if (watch.tty)
+            {
+                Redraw(&watch, 0);
+            }
+        }
+
+        OutBuf_Flush(&Output);
+    }
+
+    if (watch.tty)
+    {
+        /* Give the terminal back below the screen, with wrapping enabled again */
+        MoveToLine(watch.shown_count);
+        OutBuf_PutLiteral(&Output, "\033[J\033[?7h");
+        OutBuf_Flush(&Output);
+    }
+
+    if (watch.gone)
+    {
+        fprintf(stderr, "The directory %s was removed or moved\n", dir);
+    }
+
+    Dirty_Clear(&watch.dirty);
+    free(watch.dirty.names);
+    Index_Free(&watch.index);
+    OutBuf_Free(&watch.frame);
+    OutBuf_Free(&watch.shown);
+    free(watch.lines);
+    free(watch.shown_lines);
+    close(watch.inotify_fd);
+    close(watch.dir_fd);
+
+    return 0;
+}
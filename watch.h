@@ -0,0 +1,54 @@
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/**************************      @SWC:        watch.h                ****************************/
+/**************************      @author:     Abdelrahman Sabry      ****************************/
+/**************************      @date:       11 Sept                ****************************/
+/**************************      @version:    1                      ****************************/
+/************************************************************************************************/
+/************************************************************************************************/
+/************************************************************************************************/
+
+#ifndef _WATCH_H_
+#define _WATCH_H_
+
+#include "options.h"
+
+/* Events are applied once the directory has been quiet for this long (milliseconds) ... */
+#define WATCH_COALESCE_MS 50
+
+/* ... or at the latest this long after the first one, under a steady stream of events */
+#define WATCH_MAX_DELAY_MS 500
+
+/* More changed names than this in one batch => rescan the whole directory instead */
+#define WATCH_RESCAN_THRESHOLD 65536
+
+/* Size of the buffer inotify events are read into */
+#define WATCH_EVENT_BUFFER_SIZE (64 * 1024)
+
+/* Initial number of buckets of the name index (a power of two) */
+#define WATCH_INITIAL_BUCKETS 1024
+
+/* Lines used when the terminal height is unknown */
+#define WATCH_DEFAULT_ROWS 24
+
+/**
+ * @brief Lists a directory, then keeps the listing up to date until interrupted (--watch).
+ *
+ * After one full listing, inotify reports the names that were created, deleted, modified or
+ * renamed. Events are coalesced (see WATCH_COALESCE_MS) and only the names they mention are
+ * stat'ed again; the entries are kept in sort order in memory, so the cost of a change does
+ * not depend on the size of the directory.
+ *
+ * On a terminal, the first screen of the listing is shown (one entry per line) and only the
+ * lines that changed are redrawn. Otherwise every batch of changes is printed as lines marked
+ * '+' (added), '-' (removed) and 'M' (modified), as with --diff-against.
+ *
+ * @param options The options of the listing.
+ * @param dir The directory to watch.
+ *
+ * @return 0 once interrupted, -1 if the directory cannot be listed or watched.
+ */
+int Watch_Run(const Options_t *options, char *dir);
+
+#endif